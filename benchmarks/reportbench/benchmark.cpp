@@ -0,0 +1,235 @@
+/*
+ * Copyright 2010 and beyond, Juan Luis Paz
+ *
+ * This file is part of Script Report.
+ *
+ * Script Report is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Script Report is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with Script Report.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "benchmark.h"
+
+#include <QtCore/QBuffer>
+#include <QtCore/QElapsedTimer>
+#include <QtCore/QFile>
+#include <QtCore/QTextStream>
+#include <QtCore/QVector>
+#include <QtGui/QPdfWriter>
+
+#include <algorithm>
+
+#include <ScriptReport/ScriptReport>
+#include <ScriptReport/ScriptReportEnginePool>
+#include <ScriptReport/ScriptReportStats>
+#include <ScriptReport/SourceTransformer>
+
+BenchmarkResult::BenchmarkResult() :
+    iterations(0),
+    median(0),
+    minimum(0),
+    throughput(0),
+    pageCount(-1)
+{
+}
+
+// The times are written in milliseconds
+QJsonObject BenchmarkResult::toJson() const {
+    QJsonObject result;
+    if (!errorMessage.isEmpty()) {
+        result.insert(QLatin1String("error"), errorMessage);
+        return result;
+    }
+    result.insert(QLatin1String("iterations"), iterations);
+    result.insert(QLatin1String("median"), median / 1000000.0);
+    result.insert(QLatin1String("min"), minimum / 1000000.0);
+    if (throughput > 0) {
+        result.insert(QLatin1String("mbPerSecond"), throughput);
+    }
+    if (pageCount >= 0) {
+        result.insert(QLatin1String("pageCount"), pageCount);
+    }
+    return result;
+}
+
+Benchmark::Benchmark(const QString &name) :
+    m_name(name)
+{
+}
+
+Benchmark::~Benchmark() {
+}
+
+QString Benchmark::name() const {
+    return m_name;
+}
+
+// Repeat the iterations until both minimums are reached, the median is used as the result
+// because it is not affected by the slow iterations of a busy machine
+BenchmarkResult Benchmark::measure(qint64 minimumTime, int minimumIterations) {
+    BenchmarkResult result;
+    result.name = m_name;
+
+    if (!init(&result.errorMessage) || !iterate(&result.errorMessage)) {
+        return result;
+    }
+
+    QVector<qint64> times;
+    qint64 total = 0;
+    QElapsedTimer timer;
+    while ((total < minimumTime || times.size() < minimumIterations) && times.size() < 100000) {
+        timer.start();
+        if (!iterate(&result.errorMessage)) {
+            return result;
+        }
+        qint64 elapsed = timer.nsecsElapsed();
+        times.append(elapsed);
+        total += elapsed;
+    }
+
+    std::sort(times.begin(), times.end());
+    result.iterations = times.size();
+    result.median = times.at(times.size() / 2);
+    result.minimum = times.first();
+    if (bytes() > 0 && result.median > 0) {
+        result.throughput = bytes() / 1e6 / (result.median / 1e9);
+    }
+    result.pageCount = pageCount();
+    return result;
+}
+
+bool Benchmark::init(QString *errorMessage) {
+    Q_UNUSED(errorMessage);
+    return true;
+}
+
+qint64 Benchmark::bytes() const {
+    return 0;
+}
+
+int Benchmark::pageCount() const {
+    return -1;
+}
+
+static bool readFile(const QString &fileName, QString *content, QString *errorMessage) {
+    QFile file(fileName);
+    if (!file.open(QIODevice::ReadOnly)) {
+        *errorMessage = QString::fromLatin1("Unable to read the file %1: %2").arg(fileName, file.errorString());
+        return false;
+    }
+    QTextStream in(&file);
+    *content = in.readAll();
+    return true;
+}
+
+TransformBenchmark::TransformBenchmark(const QString &name, const QString &fileName) :
+    Benchmark(name),
+    m_fileName(fileName)
+{
+}
+
+bool TransformBenchmark::init(QString *errorMessage) {
+    return readFile(m_fileName, &m_source, errorMessage);
+}
+
+bool TransformBenchmark::iterate(QString *errorMessage) {
+    QString input = m_source;
+    QString output;
+    QTextStream in(&input, QIODevice::ReadOnly);
+    QTextStream out(&output, QIODevice::WriteOnly);
+    SourceTransformer transformer(&in, &out);
+    if (!transformer.transform()) {
+        *errorMessage = QString::fromLatin1("The transformation of %1 failed").arg(m_fileName);
+        return false;
+    }
+    return true;
+}
+
+qint64 TransformBenchmark::bytes() const {
+    return m_source.size() * qint64(sizeof(QChar));
+}
+
+RunBenchmark::RunBenchmark(const QString &name, const QString &fileName) :
+    Benchmark(name),
+    m_report(new ScriptReport(fileName))
+{
+}
+
+RunBenchmark::~RunBenchmark() {
+    delete m_report;
+}
+
+bool RunBenchmark::init(QString *errorMessage) {
+    m_report->run();
+    if (m_report->hasUncaughtException()) {
+        *errorMessage = m_report->errorMessage();
+        return false;
+    }
+    return true;
+}
+
+bool RunBenchmark::iterate(QString *errorMessage) {
+    m_report->rerun(QStringList());
+    if (m_report->hasUncaughtException()) {
+        *errorMessage = m_report->errorMessage();
+        return false;
+    }
+    return true;
+}
+
+RenderBenchmark::RenderBenchmark(const QString &name, const QString &fileName) :
+    RunBenchmark(name, fileName)
+{
+}
+
+// The pages are painted again in each iteration, the page cache is cleared
+bool RenderBenchmark::iterate(QString *errorMessage) {
+    Q_UNUSED(errorMessage);
+    QByteArray pdf;
+    QBuffer buffer(&pdf);
+    buffer.open(QIODevice::WriteOnly);
+    QPdfWriter writer(&buffer);
+    m_report->clearPageCache();
+    m_report->render(&writer);
+    return true;
+}
+
+int RenderBenchmark::pageCount() const {
+    return m_report->stats().pageCount;
+}
+
+PoolBenchmark::PoolBenchmark(const QString &name, const QString &fileName) :
+    Benchmark(name),
+    m_fileName(fileName),
+    m_pool(new ScriptReportEnginePool(1, QStringList() << QString::fromLatin1("srsql")))
+{
+}
+
+PoolBenchmark::~PoolBenchmark() {
+    delete m_pool;
+}
+
+bool PoolBenchmark::iterate(QString *errorMessage) {
+    ScriptReport *report = m_pool->acquire(m_fileName);
+    report->run();
+    if (report->hasUncaughtException()) {
+        *errorMessage = report->errorMessage();
+        m_pool->release(report);
+        return false;
+    }
+    m_pool->release(report);
+    if (m_pool->idleCount() != 1) {
+        *errorMessage = QString::fromLatin1("The engine of %1 was not recycled by the pool.").arg(m_fileName);
+        return false;
+    }
+    return true;
+}
@@ -0,0 +1,125 @@
+/*
+ * Copyright 2010 and beyond, Juan Luis Paz
+ *
+ * This file is part of Script Report.
+ *
+ * Script Report is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Script Report is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with Script Report.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef BENCHMARK_H
+#define BENCHMARK_H
+
+#include <QtCore/QJsonObject>
+#include <QtCore/QString>
+
+class ScriptReport;
+class ScriptReportEnginePool;
+
+struct BenchmarkResult
+{
+    BenchmarkResult();
+
+    QJsonObject toJson() const;
+
+    QString name;
+    QString errorMessage;
+    int iterations;
+    // Times in nanoseconds
+    qint64 median;
+    qint64 minimum;
+    // Throughput in MB per second, or 0 if the benchmark doesn't measure bytes
+    double throughput;
+    int pageCount;
+};
+
+// A benchmark measures the time of the iterations of an operation, the first iteration is a
+// warm up and it is not measured
+class Benchmark
+{
+public:
+    explicit Benchmark(const QString &name);
+    virtual ~Benchmark();
+
+    QString name() const;
+    BenchmarkResult measure(qint64 minimumTime, int minimumIterations);
+
+protected:
+    virtual bool init(QString *errorMessage);
+    virtual bool iterate(QString *errorMessage) = 0;
+    virtual qint64 bytes() const;
+    virtual int pageCount() const;
+
+private:
+    QString m_name;
+};
+
+// SourceTransformer throughput
+class TransformBenchmark : public Benchmark
+{
+public:
+    TransformBenchmark(const QString &name, const QString &fileName);
+
+protected:
+    bool init(QString *errorMessage);
+    bool iterate(QString *errorMessage);
+    qint64 bytes() const;
+
+private:
+    QString m_fileName;
+    QString m_source;
+};
+
+// ScriptReport::run of a report reused with ScriptReport::rerun
+class RunBenchmark : public Benchmark
+{
+public:
+    RunBenchmark(const QString &name, const QString &fileName);
+    ~RunBenchmark();
+
+protected:
+    bool init(QString *errorMessage);
+    bool iterate(QString *errorMessage);
+
+    ScriptReport *m_report;
+};
+
+// ScriptReport::render of a report already run to a PDF device in memory
+class RenderBenchmark : public RunBenchmark
+{
+public:
+    RenderBenchmark(const QString &name, const QString &fileName);
+
+protected:
+    bool iterate(QString *errorMessage);
+    int pageCount() const;
+};
+
+// ScriptReport::run of a report acquired from a ScriptReportEnginePool, each iteration fails if
+// the engine is not given back to the pool, so it also checks that a transformed report can be
+// recycled
+class PoolBenchmark : public Benchmark
+{
+public:
+    PoolBenchmark(const QString &name, const QString &fileName);
+    ~PoolBenchmark();
+
+protected:
+    bool iterate(QString *errorMessage);
+
+private:
+    QString m_fileName;
+    ScriptReportEnginePool *m_pool;
+};
+
+#endif // BENCHMARK_H
@@ -0,0 +1,339 @@
+/*
+ * Copyright 2010 and beyond, Juan Luis Paz
+ *
+ * This file is part of Script Report.
+ *
+ * Script Report is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Script Report is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with Script Report.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "corpusgenerator.h"
+
+#include <QtCore/QDir>
+#include <QtCore/QFile>
+#include <QtCore/QTextStream>
+#include <QtCore/QVariant>
+#include <QtGui/QColor>
+#include <QtGui/QImage>
+#include <QtGui/QPainter>
+#include <QtSql/QSqlDatabase>
+#include <QtSql/QSqlError>
+#include <QtSql/QSqlQuery>
+
+// The script that opens data.db, the connection is reused when the report is run again
+static QString databaseScript() {
+    return QString::fromLatin1(
+            "<!--@\n"
+            "sr.engine.importExtension(\"srsql\");\n"
+            "var db;\n"
+            "if (sr.sql.contains(\"%1\")) {\n"
+            "    db = sr.sql.database(\"%1\");\n"
+            "} else {\n"
+            "    db = sr.sql.addDatabase(\"QSQLITE\", \"%1\");\n"
+            "    db.databaseName = \"data.db\";\n"
+            "    db.open();\n"
+            "}\n"
+            "-->\n").arg(CorpusGenerator::connectionName());
+}
+
+CorpusGenerator::CorpusGenerator() :
+    m_rows(10000),
+    m_sections(10),
+    m_images(4),
+    m_pageNumbers(true)
+{
+}
+
+int CorpusGenerator::rows() const {
+    return m_rows;
+}
+
+void CorpusGenerator::setRows(int rows) {
+    m_rows = qMax(1, rows);
+}
+
+int CorpusGenerator::sections() const {
+    return m_sections;
+}
+
+void CorpusGenerator::setSections(int sections) {
+    m_sections = qMax(1, sections);
+}
+
+int CorpusGenerator::images() const {
+    return m_images;
+}
+
+void CorpusGenerator::setImages(int images) {
+    m_images = qMax(0, images);
+}
+
+bool CorpusGenerator::isPageNumbersEnabled() const {
+    return m_pageNumbers;
+}
+
+void CorpusGenerator::setPageNumbersEnabled(bool isPageNumbersEnabled) {
+    m_pageNumbers = isPageNumbersEnabled;
+}
+
+QString CorpusGenerator::connectionName() {
+    return QString::fromLatin1("reportbench");
+}
+
+QString CorpusGenerator::errorMessage() const {
+    return m_errorMessage;
+}
+
+bool CorpusGenerator::generate(const QString &directory) {
+    QDir dir(directory);
+    if (!dir.mkpath(QString::fromLatin1("."))) {
+        m_errorMessage = QString::fromLatin1("Unable to create the directory %1").arg(directory);
+        return false;
+    }
+
+    if (!writeFile(dir.filePath(QString::fromLatin1("report.srt")), reportTemplate())
+            || !writeFile(dir.filePath(QString::fromLatin1("write.srt")), writeTemplate())
+            || !writeFile(dir.filePath(QString::fromLatin1("sql.srt")), sqlTemplate())
+            || !writeFile(dir.filePath(QString::fromLatin1("fetch.srt")), fetchTemplate())
+            || !writeFile(dir.filePath(QString::fromLatin1("table.srt")), renderTemplate())
+            || !writeFile(dir.filePath(QString::fromLatin1("cached.srt")), cachedTemplate())
+            || !writeFile(dir.filePath(QString::fromLatin1("async.srt")), asyncTemplate())
+            || !writeFile(dir.filePath(QString::fromLatin1("i18n.srt")), i18nTemplate())
+            || !writeDatabase(dir.filePath(QString::fromLatin1("data.db")))) {
+        return false;
+    }
+    for (int i = 0; i < m_images; i++) {
+        if (!writeImage(dir.filePath(QString::fromLatin1("image%1.png").arg(i)), i)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// The rows are shared between the sections, each section has a table with its part of the rows
+QString CorpusGenerator::reportTemplate() const {
+    QString result = databaseScript();
+    result.append(QString::fromLatin1(
+            "<!--:header-->\n"
+            "<table width=\"100%\" style=\"border-bottom: 1px solid black\">\n"
+            "    <tr><td><b>Benchmark report</b></td><td align=\"right\">%1 rows</td></tr>\n"
+            "</table>\n").arg(m_rows));
+    if (m_pageNumbers) {
+        result.append(QString::fromLatin1(
+                "<!--:footer-->\n"
+                "<center>${sr.report.page}/${sr.report.pageCount}</center>\n"));
+    }
+    result.append(QString::fromLatin1("<!--:content-->\n"));
+
+    const int sectionRows = qMax(1, m_rows / m_sections);
+    for (int section = 0; section < m_sections; section++) {
+        result.append(QString::fromLatin1("<h2>Section %1</h2>\n").arg(section + 1));
+        if (m_images > 0) {
+            result.append(QString::fromLatin1("<p><img src=\"image%1.png\"></p>\n").arg(section % m_images));
+        }
+        result.append(QString::fromLatin1(
+                "<!--@\n"
+                "var query = db.query(\"SELECT artist, title, length, year FROM songs LIMIT %1 OFFSET %2\");\n"
+                "-->\n"
+                "<table width=\"100%\" cellspacing=\"-1\" cellpadding=\"2\" border=\"1\">\n"
+                "    <thead>\n"
+                "        <tr><td><b>Artist</b></td><td><b>Title</b></td><td><b>Length</b></td><td><b>Year</b></td></tr>\n"
+                "    </thead>\n"
+                "    <tbody>\n"
+                "    <!--@ while (query.next()) { -->\n"
+                "        <tr>\n"
+                "            <td>${query.value(0)}</td>\n"
+                "            <td>${query.value(1)}</td>\n"
+                "            <td align=\"right\">${query.value(2)}</td>\n"
+                "            <td align=\"right\">${query.value(3)}</td>\n"
+                "        </tr>\n"
+                "    <!--@ } -->\n"
+                "    </tbody>\n"
+                "</table>\n")
+                .arg(sectionRows).arg(section * sectionRows));
+        if (m_pageNumbers) {
+            result.append(QString::fromLatin1("<p>Page ##page## of ##pageCount##</p>\n"));
+        }
+    }
+    return result;
+}
+
+QString CorpusGenerator::writeTemplate() const {
+    return QString::fromLatin1(
+            "<!--:content-->\n"
+            "<table width=\"100%\">\n"
+            "<!--@ for (var i = 0; i < %1; i++) { -->\n"
+            "    <tr>\n"
+            "        <td align=\"right\">${i}</td>\n"
+            "        <td>Lorem ipsum dolor sit amet, consectetur adipiscing elit</td>\n"
+            "        <td align=\"right\">${(i * 37) % 300}</td>\n"
+            "        <td>${i % 2 == 0 ? \"even\" : \"odd\"}</td>\n"
+            "    </tr>\n"
+            "<!--@ } -->\n"
+            "</table>\n").arg(m_rows);
+}
+
+QString CorpusGenerator::sqlTemplate() const {
+    return databaseScript() + QString::fromLatin1(
+            "<!--@\n"
+            "var query = db.query(\"SELECT artist, title, length, year FROM songs\");\n"
+            "var total = 0;\n"
+            "while (query.next()) {\n"
+            "    total += query.value(2);\n"
+            "}\n"
+            "-->\n"
+            "<!--:content-->\n"
+            "${total}\n");
+}
+
+QString CorpusGenerator::fetchTemplate() const {
+    return databaseScript() + QString::fromLatin1(
+            "<!--@\n"
+            "var query = db.query(\"SELECT artist, title, length, year FROM songs\");\n"
+            "var total = 0;\n"
+            "var rows;\n"
+            "while ((rows = query.fetchRows(1000)).length > 0) {\n"
+            "    for (var i = 0; i < rows.length; i++) {\n"
+            "        total += rows[i][2];\n"
+            "    }\n"
+            "}\n"
+            "-->\n"
+            "<!--:content-->\n"
+            "${total}\n");
+}
+
+QString CorpusGenerator::renderTemplate() const {
+    return databaseScript() + QString::fromLatin1(
+            "<!--:content-->\n"
+            "<!--@\n"
+            "var query = db.query(\"SELECT artist, title, length, year FROM songs\");\n"
+            "-->\n"
+            "<table width=\"100%\">\n"
+            "<!--@\n"
+            "query.renderRows(\"<tr><td>{artist|escape}</td><td>{title|escape}</td>\"\n"
+            "                 + \"<td align=\\\"right\\\">{length|number}</td><td align=\\\"right\\\">{year}</td></tr>\\n\");\n"
+            "-->\n"
+            "</table>\n");
+}
+
+QString CorpusGenerator::cachedTemplate() const {
+    return databaseScript() + QString::fromLatin1(
+            "<!--@\n"
+            "var rows = db.cachedQuery(\"SELECT artist, title, length, year FROM songs WHERE year >= ?\", [0], -1);\n"
+            "var total = 0;\n"
+            "for (var i = 0; i < rows.length; i++) {\n"
+            "    total += rows[i][2];\n"
+            "}\n"
+            "-->\n"
+            "<!--:content-->\n"
+            "${total}\n");
+}
+
+QString CorpusGenerator::asyncTemplate() const {
+    return databaseScript() + QString::fromLatin1(
+            "<!--@\n"
+            "var query = db.queryAsync(\"SELECT artist, title, length, year FROM songs\");\n"
+            "var total = 0;\n"
+            "var rows;\n"
+            "while ((rows = query.fetchRows(1000)).length > 0) {\n"
+            "    for (var i = 0; i < rows.length; i++) {\n"
+            "        total += rows[i][2];\n"
+            "    }\n"
+            "}\n"
+            "-->\n"
+            "<!--:content-->\n"
+            "${total}\n");
+}
+
+QString CorpusGenerator::i18nTemplate() const {
+    return QString::fromLatin1(
+            "<!--@\n"
+            "sr.engine.importExtension(\"sri18n\");\n"
+            "sr.i18n.installTranslatorFunctions();\n"
+            "var count = 0;\n"
+            "for (var i = 0; i < %1; i++) {\n"
+            "    count += qsTr(\"Music Report\").length;\n"
+            "    count += qsTranslate(\"reportbench\", \"Artist\").length;\n"
+            "}\n"
+            "-->\n"
+            "<!--:content-->\n"
+            "${count}\n").arg(m_rows);
+}
+
+/*
+ * Private members
+ */
+
+bool CorpusGenerator::writeFile(const QString &fileName, const QString &content) {
+    QFile file(fileName);
+    if (!file.open(QIODevice::WriteOnly)) {
+        m_errorMessage = QString::fromLatin1("Unable to write the file %1: %2").arg(fileName, file.errorString());
+        return false;
+    }
+    QTextStream out(&file);
+    out.setCodec("UTF-8");
+    out << content;
+    return true;
+}
+
+// The table has the shape of the songs table of examples/music/music.db
+bool CorpusGenerator::writeDatabase(const QString &fileName) {
+    QFile::remove(fileName);
+    const QString name = QString::fromLatin1("corpusgenerator");
+    bool result = false;
+    {
+        QSqlDatabase db = QSqlDatabase::addDatabase(QString::fromLatin1("QSQLITE"), name);
+        db.setDatabaseName(fileName);
+        if (db.open()) {
+            QSqlQuery query(db);
+            result = query.exec(QString::fromLatin1(
+                    "CREATE TABLE songs (artist TEXT, length NUMERIC, title TEXT, year NUMERIC)"));
+            result = result && db.transaction();
+            result = result && query.prepare(QString::fromLatin1(
+                    "INSERT INTO songs (artist, length, title, year) VALUES (?, ?, ?, ?)"));
+            for (int i = 0; result && i < m_rows; i++) {
+                query.addBindValue(QString::fromLatin1("Artist %1").arg(i / 10 + 1));
+                query.addBindValue(120 + (i * 37) % 300);
+                query.addBindValue(QString::fromLatin1("Song title number %1").arg(i + 1));
+                query.addBindValue(50 + i % 50);
+                result = query.exec();
+            }
+            result = result && db.commit();
+            if (!result) {
+                m_errorMessage = QString::fromLatin1("Unable to write the database %1: %2")
+                        .arg(fileName, query.lastError().text());
+            }
+        } else {
+            m_errorMessage = QString::fromLatin1("Unable to create the database %1: %2")
+                    .arg(fileName, db.lastError().text());
+        }
+        db.close();
+    }
+    QSqlDatabase::removeDatabase(name);
+    return result;
+}
+
+bool CorpusGenerator::writeImage(const QString &fileName, int index) {
+    QImage image(320, 160, QImage::Format_RGB32);
+    image.fill(QColor::fromHsv((index * 47) % 360, 60, 240));
+    QPainter painter(&image);
+    for (int i = 0; i < 8; i++) {
+        painter.fillRect(20 + i * 36, 140 - i * 15, 28, i * 15, QColor::fromHsv((index * 47 + i * 20) % 360, 200, 180));
+    }
+    painter.end();
+    if (!image.save(fileName, "PNG")) {
+        m_errorMessage = QString::fromLatin1("Unable to write the image %1").arg(fileName);
+        return false;
+    }
+    return true;
+}
@@ -0,0 +1,76 @@
+/*
+ * Copyright 2010 and beyond, Juan Luis Paz
+ *
+ * This file is part of Script Report.
+ *
+ * Script Report is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Script Report is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with Script Report.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef CORPUSGENERATOR_H
+#define CORPUSGENERATOR_H
+
+#include <QtCore/QString>
+
+// Generates the synthetic reports and the data used by the benchmarks:
+//   report.srt  sections of tables read from data.db, with images and page numbers
+//   write.srt   a report that only writes content from javascript
+//   sql.srt     a report that only iterates the rows of data.db
+//   fetch.srt   a report that only reads the rows of data.db with fetchRows()
+//   table.srt   a report with a table of the rows of data.db written with renderRows()
+//   cached.srt  a report that only reads the rows of data.db with cachedQuery()
+//   async.srt   a report that only reads the rows of data.db with queryAsync()
+//   i18n.srt    a report that only translates texts
+//   data.db     a SQLite database with the songs table of examples/music/music.db
+//   image*.png  the images of report.srt
+class CorpusGenerator
+{
+public:
+    CorpusGenerator();
+
+    int rows() const;
+    void setRows(int rows);
+    int sections() const;
+    void setSections(int sections);
+    int images() const;
+    void setImages(int images);
+    bool isPageNumbersEnabled() const;
+    void setPageNumbersEnabled(bool isPageNumbersEnabled);
+
+    bool generate(const QString &directory);
+    QString errorMessage() const;
+
+    QString reportTemplate() const;
+    QString writeTemplate() const;
+    QString sqlTemplate() const;
+    QString fetchTemplate() const;
+    QString renderTemplate() const;
+    QString cachedTemplate() const;
+    QString asyncTemplate() const;
+    QString i18nTemplate() const;
+
+    static QString connectionName();
+
+private:
+    bool writeFile(const QString &fileName, const QString &content);
+    bool writeDatabase(const QString &fileName);
+    bool writeImage(const QString &fileName, int index);
+
+    int m_rows;
+    int m_sections;
+    int m_images;
+    bool m_pageNumbers;
+    QString m_errorMessage;
+};
+
+#endif // CORPUSGENERATOR_H
@@ -0,0 +1,299 @@
+/*
+ * Copyright 2010 and beyond, Juan Luis Paz
+ *
+ * This file is part of Script Report.
+ *
+ * Script Report is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Script Report is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with Script Report.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <QtCore/QDateTime>
+#include <QtCore/QDir>
+#include <QtCore/QFile>
+#include <QtCore/QFileInfo>
+#include <QtCore/QJsonDocument>
+#include <QtCore/QJsonObject>
+#include <QtCore/QList>
+#include <QtCore/QStringList>
+#include <QtCore/QTemporaryDir>
+#include <QtCore/QTextStream>
+#include <QtGui/QGuiApplication>
+
+#include "benchmark.h"
+#include "corpusgenerator.h"
+
+static void printHelp(QTextStream &out) {
+    out << QString::fromLatin1(
+            "Usage:\n"
+            "    reportbench [options] [BENCHMARK...]\n"
+            "    reportbench -generate DIR [options]\n"
+            "\n"
+            "Description:\n"
+            "    Measure the time of the phases of the script reports with a generated\n"
+            "    corpus: the transformation of a report (transform), the run of a report\n"
+            "    that writes a lot of content (run_write), the iteration of the rows of a\n"
+            "    SQLite database with sr.sql row by row (sql_rows) and in blocks of rows\n"
+            "    (sql_fetch), a table written with renderRows (sql_render), the rows\n"
+            "    read from the result cache of cachedQuery (sql_cached), the rows\n"
+            "    read in other thread with queryAsync (sql_async), the rows read by a\n"
+            "    report acquired from an engine pool, that fails if the engine is not\n"
+            "    reused (pool_sql), the translations with sr.i18n (i18n) and the\n"
+            "    render of a report with\n"
+            "    sections, images and page numbers to PDF (render_pdf). When BENCHMARK\n"
+            "    names are given only they are run.\n"
+            "    The results can be written to a JSON baseline and compared with the\n"
+            "    baseline of another build.\n"
+            "\n"
+            "Options:\n"
+            "    -baseline FILE   compare the results with the baseline FILE.\n"
+            "    -corpus DIR      use the corpus generated in DIR instead of generate it.\n"
+            "    -generate DIR    only generate the corpus in DIR.\n"
+            "    -images N        the number of images of the report (4).\n"
+            "    -no-page-numbers don't use page numbers in the report.\n"
+            "    -output FILE     write the results to the JSON baseline FILE.\n"
+            "    -rows N          the number of rows of the database and the loops (10000).\n"
+            "    -sections N      the number of sections of the report (10).\n"
+            "    -time MS         the minimum time of each benchmark (1000).\n");
+}
+
+static bool readNumber(const QStringList &arguments, int &i, int minimum, int *value, QTextStream &err) {
+    i++;
+    bool ok = false;
+    if (i < arguments.size()) {
+        *value = arguments.at(i).toInt(&ok);
+    }
+    if (!ok || *value < minimum) {
+        err << QString::fromLatin1("The value of %1 must be a number not less than %2.\n")
+               .arg(arguments.at(i - 1)).arg(minimum);
+        return false;
+    }
+    return true;
+}
+
+static bool readValue(const QStringList &arguments, int &i, QString *value, QTextStream &err) {
+    i++;
+    if (i >= arguments.size()) {
+        err << QString::fromLatin1("Missing the value of %1.\n").arg(arguments.at(i - 1));
+        return false;
+    }
+    *value = arguments.at(i);
+    return true;
+}
+
+static void printComparison(const QList<BenchmarkResult> &results, const QJsonObject &baseline, QTextStream &out) {
+    const QJsonObject benchmarks = baseline.value(QLatin1String("benchmarks")).toObject();
+    out << QString::fromLatin1("\nCompared with the baseline of %1 (version %2):\n")
+           .arg(baseline.value(QLatin1String("date")).toString(),
+                baseline.value(QLatin1String("version")).toString());
+    foreach (const BenchmarkResult &result, results) {
+        const QJsonObject old = benchmarks.value(result.name).toObject();
+        const double oldMedian = old.value(QLatin1String("median")).toDouble();
+        if (!result.errorMessage.isEmpty() || oldMedian <= 0) {
+            out << QString::fromLatin1("    %1 not comparable\n").arg(result.name, -12);
+            continue;
+        }
+        const double median = result.median / 1000000.0;
+        out << QString::fromLatin1("    %1 %2 ms -> %3 ms (%4%5%)\n")
+               .arg(result.name, -12)
+               .arg(oldMedian, 10, 'f', 3)
+               .arg(median, 10, 'f', 3)
+               .arg(median >= oldMedian ? QLatin1String("+") : QLatin1String(""))
+               .arg((median - oldMedian) * 100 / oldMedian, 0, 'f', 1);
+    }
+}
+
+int main(int argc, char *argv[])
+{
+    // The render doesn't use widgets, it can run without a display
+    if (qgetenv("QT_QPA_PLATFORM").isEmpty()) {
+        qputenv("QT_QPA_PLATFORM", "offscreen");
+    }
+    QGuiApplication a(argc, argv);
+    // The script extensions are in the script directory next to the application
+    QCoreApplication::addLibraryPath(QCoreApplication::applicationDirPath());
+    QTextStream out(stdout);
+    QTextStream err(stderr);
+
+    CorpusGenerator generator;
+    QString generateDirectory;
+    QString corpusDirectory;
+    QString outputFileName;
+    QString baselineFileName;
+    int minimumTime = 1000;
+    QStringList selected;
+
+    QStringList arguments = a.arguments();
+    for (int i = 1; i < arguments.size(); i++) {
+        QString arg = arguments.at(i);
+        if (arg.startsWith(QLatin1String("--"))) {
+            arg.remove(0, 1);
+        }
+        int number;
+        if (arg == QLatin1String("-h") || arg == QLatin1String("-help")) {
+            printHelp(out);
+            return 0;
+        } else if (arg == QLatin1String("-rows")) {
+            if (!readNumber(arguments, i, 1, &number, err)) {
+                return 1;
+            }
+            generator.setRows(number);
+        } else if (arg == QLatin1String("-sections")) {
+            if (!readNumber(arguments, i, 1, &number, err)) {
+                return 1;
+            }
+            generator.setSections(number);
+        } else if (arg == QLatin1String("-images")) {
+            if (!readNumber(arguments, i, 0, &number, err)) {
+                return 1;
+            }
+            generator.setImages(number);
+        } else if (arg == QLatin1String("-no-page-numbers")) {
+            generator.setPageNumbersEnabled(false);
+        } else if (arg == QLatin1String("-time")) {
+            if (!readNumber(arguments, i, 0, &minimumTime, err)) {
+                return 1;
+            }
+        } else if (arg == QLatin1String("-generate")) {
+            if (!readValue(arguments, i, &generateDirectory, err)) {
+                return 1;
+            }
+        } else if (arg == QLatin1String("-corpus")) {
+            if (!readValue(arguments, i, &corpusDirectory, err)) {
+                return 1;
+            }
+        } else if (arg == QLatin1String("-output")) {
+            if (!readValue(arguments, i, &outputFileName, err)) {
+                return 1;
+            }
+        } else if (arg == QLatin1String("-baseline")) {
+            if (!readValue(arguments, i, &baselineFileName, err)) {
+                return 1;
+            }
+        } else if (arg.startsWith(QLatin1Char('-'))) {
+            err << QString::fromLatin1("Unrecognized option '%1'.\n").arg(arguments.at(i));
+            return 1;
+        } else {
+            selected << arg;
+        }
+    }
+
+    if (!generateDirectory.isEmpty()) {
+        if (!generator.generate(generateDirectory)) {
+            err << generator.errorMessage() << QLatin1Char('\n');
+            return 2;
+        }
+        return 0;
+    }
+
+    QJsonObject baseline;
+    if (!baselineFileName.isEmpty()) {
+        QFile baselineFile(baselineFileName);
+        if (!baselineFile.open(QIODevice::ReadOnly)) {
+            err << QString::fromLatin1("Unable to read the baseline %1.\n").arg(baselineFileName);
+            return 2;
+        }
+        baseline = QJsonDocument::fromJson(baselineFile.readAll()).object();
+    }
+
+    QTemporaryDir temporaryDirectory;
+    if (corpusDirectory.isEmpty()) {
+        corpusDirectory = temporaryDirectory.path();
+        if (!temporaryDirectory.isValid() || !generator.generate(corpusDirectory)) {
+            err << QString::fromLatin1("Unable to generate the corpus: %1\n").arg(generator.errorMessage());
+            return 2;
+        }
+    }
+    QDir corpus(corpusDirectory);
+    corpusDirectory = corpus.absolutePath();
+    if (!outputFileName.isEmpty()) {
+        outputFileName = QFileInfo(outputFileName).absoluteFilePath();
+    }
+    // The reports open data.db and the images with relative paths
+    QDir::setCurrent(corpusDirectory);
+
+    QList<Benchmark*> benchmarks;
+    benchmarks << new TransformBenchmark(QString::fromLatin1("transform"), corpus.filePath(QString::fromLatin1("report.srt")))
+               << new RunBenchmark(QString::fromLatin1("run_write"), corpus.filePath(QString::fromLatin1("write.srt")))
+               << new RunBenchmark(QString::fromLatin1("sql_rows"), corpus.filePath(QString::fromLatin1("sql.srt")))
+               << new RunBenchmark(QString::fromLatin1("sql_fetch"), corpus.filePath(QString::fromLatin1("fetch.srt")))
+               << new RunBenchmark(QString::fromLatin1("sql_render"), corpus.filePath(QString::fromLatin1("table.srt")))
+               << new RunBenchmark(QString::fromLatin1("sql_cached"), corpus.filePath(QString::fromLatin1("cached.srt")))
+               << new RunBenchmark(QString::fromLatin1("sql_async"), corpus.filePath(QString::fromLatin1("async.srt")))
+               << new PoolBenchmark(QString::fromLatin1("pool_sql"), corpus.filePath(QString::fromLatin1("sql.srt")))
+               << new RunBenchmark(QString::fromLatin1("i18n"), corpus.filePath(QString::fromLatin1("i18n.srt")))
+               << new RenderBenchmark(QString::fromLatin1("render_pdf"), corpus.filePath(QString::fromLatin1("report.srt")));
+
+    out << QString::fromLatin1("Corpus %1 (%2 rows, %3 sections, %4 images, page numbers %5)\n")
+           .arg(corpusDirectory).arg(generator.rows()).arg(generator.sections()).arg(generator.images())
+           .arg(generator.isPageNumbersEnabled() ? QLatin1String("on") : QLatin1String("off"));
+    out.flush();
+
+    QList<BenchmarkResult> results;
+    QJsonObject resultsJson;
+    bool hasError = false;
+    foreach (Benchmark *benchmark, benchmarks) {
+        if (!selected.isEmpty() && !selected.contains(benchmark->name())) {
+            continue;
+        }
+        BenchmarkResult result = benchmark->measure(minimumTime * qint64(1000000), 5);
+        if (result.errorMessage.isEmpty()) {
+            QString line = QString::fromLatin1("    %1 %2 ms median, %3 ms min, %4 iterations")
+                    .arg(result.name, -12)
+                    .arg(result.median / 1000000.0, 10, 'f', 3)
+                    .arg(result.minimum / 1000000.0, 10, 'f', 3)
+                    .arg(result.iterations);
+            if (result.throughput > 0) {
+                line.append(QString::fromLatin1(", %1 MB/s").arg(result.throughput, 0, 'f', 1));
+            }
+            if (result.pageCount >= 0) {
+                line.append(QString::fromLatin1(", %1 pages").arg(result.pageCount));
+            }
+            out << line << QLatin1Char('\n');
+        } else {
+            hasError = true;
+            out << QString::fromLatin1("    %1 error: %2\n").arg(result.name, -12).arg(result.errorMessage);
+        }
+        out.flush();
+        results << result;
+        resultsJson.insert(result.name, result.toJson());
+    }
+    qDeleteAll(benchmarks);
+
+    if (!baseline.isEmpty()) {
+        printComparison(results, baseline, out);
+    }
+
+    if (!outputFileName.isEmpty()) {
+        QJsonObject scale;
+        scale.insert(QLatin1String("rows"), generator.rows());
+        scale.insert(QLatin1String("sections"), generator.sections());
+        scale.insert(QLatin1String("images"), generator.images());
+        scale.insert(QLatin1String("pageNumbers"), generator.isPageNumbersEnabled());
+
+        QJsonObject json;
+        json.insert(QLatin1String("version"), QString::fromLatin1(APP_VERSION));
+        json.insert(QLatin1String("qtVersion"), QString::fromLatin1(qVersion()));
+        json.insert(QLatin1String("date"), QDateTime::currentDateTime().toString(Qt::ISODate));
+        json.insert(QLatin1String("scale"), scale);
+        json.insert(QLatin1String("benchmarks"), resultsJson);
+
+        QFile outputFile(outputFileName);
+        if (!outputFile.open(QIODevice::WriteOnly)) {
+            err << QString::fromLatin1("Unable to write the file %1.\n").arg(outputFileName);
+            return 3;
+        }
+        outputFile.write(QJsonDocument(json).toJson());
+    }
+
+    return hasError ? 6 : 0;
+}
@@ -0,0 +1,264 @@
+/*
+ * Copyright 2010 and beyond, Juan Luis Paz
+ *
+ * This file is part of Script Report.
+ *
+ * Script Report is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Script Report is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with Script Report.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <QtCore/QCoreApplication>
+#include <QtCore/QElapsedTimer>
+#include <QtCore/QFile>
+#include <QtCore/QStringList>
+#include <QtCore/QTextStream>
+
+#include <ScriptReport/SourceScanner>
+#include <ScriptReport/SourceTransformer>
+
+static QString instructionSetName(SourceScanner::InstructionSet instructionSet) {
+    switch (instructionSet) {
+    case SourceScanner::Avx2:
+        return QString::fromLatin1("avx2");
+    case SourceScanner::Sse2:
+        return QString::fromLatin1("sse2");
+    default:
+        return QString::fromLatin1("scalar");
+    }
+}
+
+// A small xorshift generator, the self check uses the same inputs in every run
+static quint32 nextRandom(quint32 &state) {
+    state ^= state << 13;
+    state ^= state >> 17;
+    state ^= state << 5;
+    return state;
+}
+
+// The reference for the scanner, the first index from from of any of the characters, or size
+static int referenceIndexOf(const QChar *data, int from, int size, const QChar *characters, int count) {
+    for (int i = from; i < size; i++) {
+        for (int j = 0; j < count; j++) {
+            if (data[i] == characters[j]) {
+                return i;
+            }
+        }
+    }
+    return size;
+}
+
+static int scannerIndexOf(const QChar *data, int from, int size, const QChar *characters, int count) {
+    switch (count) {
+    case 1:
+        return SourceScanner::indexOf(data, from, size, characters[0]);
+    case 2:
+        return SourceScanner::indexOfAny(data, from, size, characters[0], characters[1]);
+    case 3:
+        return SourceScanner::indexOfAny(data, from, size, characters[0], characters[1], characters[2]);
+    default:
+        return SourceScanner::indexOfAny(data, from, size, characters[0], characters[1], characters[2], characters[3]);
+    }
+}
+
+// Compare the results of indexOf() and indexOfAny() with the instruction set selected in
+// SourceScanner against the reference, over random inputs and over inputs with a single match at
+// each position around the vector boundaries. The inputs are taken at every alignment, and use
+// characters that only differ from the searched ones in the high byte. Returns the number of
+// mismatches, writing the first ones to err
+static int selfCheck(QTextStream &err) {
+    const QChar characters[4] = { QLatin1Char('<'), QLatin1Char('$'), QLatin1Char('-'), QLatin1Char('>') };
+    // The alphabet of the random inputs: the searched characters, others with the same low byte
+    // and a few common ones
+    const QChar alphabet[] = {
+        QLatin1Char('<'), QLatin1Char('$'), QLatin1Char('-'), QLatin1Char('>'),
+        QChar(0x013C), QChar(0x0124), QChar(0x2D2D), QChar(0x3E00),
+        QLatin1Char('a'), QLatin1Char(' '), QLatin1Char('\n'), QChar(0xFFFF), QChar(0)
+    };
+    const int alphabetSize = int(sizeof(alphabet) / sizeof(alphabet[0]));
+    const int maximumSize = 200;
+    const int padding = 32;
+    QChar buffer[maximumSize + padding];
+    quint32 state = 2463534242u;
+    int mismatches = 0;
+
+    for (int round = 0; round < 20000; round++) {
+        const int offset = round % padding;
+        const int size = int(nextRandom(state) % maximumSize);
+        QChar *data = buffer + offset;
+        const bool isBoundary = (round % 2) == 0;
+        const int filler = 4 + int(nextRandom(state) % (alphabetSize - 4));
+        for (int i = 0; i < size; i++) {
+            data[i] = isBoundary ? alphabet[filler] : alphabet[nextRandom(state) % alphabetSize];
+        }
+        const int count = 1 + int(nextRandom(state) % 4);
+        if (isBoundary && size > 0) {
+            // A single match at a position near a multiple of 8 or 16 characters
+            const int base = int(nextRandom(state) % (size / 8 + 1)) * 8;
+            const int position = qBound(0, base + int(nextRandom(state) % 3) - 1, size - 1);
+            data[position] = characters[nextRandom(state) % count];
+        }
+        const int from = size > 0 ? int(nextRandom(state) % (size + 1)) : 0;
+
+        const int expected = referenceIndexOf(data, from, size, characters, count);
+        const int result = scannerIndexOf(data, from, size, characters, count);
+        if (result != expected) {
+            if (mismatches < 10) {
+                err << QString::fromLatin1("    mismatch: size %1, offset %2, from %3, %4 characters: %5 instead of %6\n")
+                       .arg(size).arg(offset).arg(from).arg(count).arg(result).arg(expected);
+            }
+            mismatches++;
+        }
+    }
+    return mismatches;
+}
+
+// Generate a html heavy template, a table with long rows of html and a few scripts
+static QString generateTemplate(int size) {
+    const QString head = QString::fromLatin1(
+            "<!--:header-->\n"
+            "<table width=\"100%\" style=\"border: 1px solid black; font-family: 'Sans Serif'\">\n"
+            "    <tr><td align=\"center\"><b>Benchmark report, page ##page## of ##pageCount##</b></td></tr>\n"
+            "</table>\n"
+            "<!--:content-->\n"
+            "<table width=\"100%\" cellspacing=\"0\" cellpadding=\"2\" style=\"border-collapse: collapse\">\n");
+    const QString row = QString::fromLatin1(
+            "<!--@ for (var i = 0; i < 10; i++) { -->\n"
+            "    <tr style=\"background-color: #f0f0f0; border-bottom: 1px solid #c0c0c0\">\n"
+            "        <td width=\"10%\" align=\"right\" style=\"color: #404040\">${i}</td>\n"
+            "        <td width=\"60%\" style=\"font-weight: bold\">Lorem ipsum dolor sit amet, consectetur "
+            "adipiscing elit, sed do eiusmod tempor incididunt ut labore et dolore magna aliqua</td>\n"
+            "        <td width=\"30%\" align=\"right\">${i % 2 == 0 ? \"even\" : \"odd\"}</td>\n"
+            "    </tr>\n"
+            "<!--@ } -->\n");
+    const QString tail = QString::fromLatin1("</table>\n");
+
+    QString result;
+    result.reserve(size + row.size() + tail.size());
+    result.append(head);
+    while (result.size() < size) {
+        result.append(row);
+    }
+    result.append(tail);
+    return result;
+}
+
+// Returns the MB per second of UTF-16 input transformed
+static double transform(const QString &source, int iterations, int &outputSize) {
+    QElapsedTimer timer;
+    qint64 elapsed = 0;
+    for (int i = 0; i < iterations; i++) {
+        QString input = source;
+        QString output;
+        QTextStream in(&input, QIODevice::ReadOnly);
+        QTextStream out(&output, QIODevice::WriteOnly);
+        SourceTransformer transformer(&in, &out);
+
+        timer.start();
+        transformer.transform();
+        elapsed += timer.nsecsElapsed();
+        outputSize = output.size();
+    }
+    const double bytes = double(source.size()) * sizeof(QChar) * iterations;
+    return bytes / 1e6 / (double(elapsed) / 1e9);
+}
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication a(argc, argv);
+    QTextStream out(stdout);
+    QTextStream err(stderr);
+
+    QStringList arguments = a.arguments();
+    arguments.removeFirst();
+    if (arguments.contains(QString::fromLatin1("-h"))) {
+        out << QString::fromLatin1(
+                "Usage:\n"
+                "    transformerbench [FILE...]\n"
+                "\n"
+                "Description:\n"
+                "    Measure the speed of the transformation of script reports to javascript,\n"
+                "    in MB/s of UTF-16 input, with each instruction set supported by the\n"
+                "    processor. When no FILE is given a html heavy template of 8M characters is\n"
+                "    generated.\n"
+                "    The baseline is the current buffer based SourceTransformer with the scalar\n"
+                "    scanner, so the ratios only measure the SIMD scanner; the old per\n"
+                "    character transformer is not part of the tree and is not measured.\n"
+                "    Before the measures the results of the scanner with each instruction set\n"
+                "    are checked against a reference over random and boundary inputs, the\n"
+                "    benchmark fails if they differ.\n");
+        return 0;
+    }
+
+    QStringList names;
+    QStringList sources;
+    if (arguments.isEmpty()) {
+        names << QString::fromLatin1("generated");
+        sources << generateTemplate(8 * 1024 * 1024);
+    }
+    foreach (const QString &fileName, arguments) {
+        QFile file(fileName);
+        if (!file.open(QIODevice::ReadOnly)) {
+            err << QString::fromLatin1("Unable to open the file %1: %2\n").arg(fileName, file.errorString());
+            return 1;
+        }
+        QTextStream in(&file);
+        names << fileName;
+        sources << in.readAll();
+    }
+
+    const SourceScanner::InstructionSet supported = SourceScanner::supportedInstructionSet();
+    out << QString::fromLatin1("Supported instruction set: %1\n").arg(instructionSetName(supported));
+    out.flush();
+    bool isCorrect = true;
+    for (int set = SourceScanner::Scalar; set <= supported; set++) {
+        SourceScanner::setInstructionSet(SourceScanner::InstructionSet(set));
+        const int mismatches = selfCheck(err);
+        err.flush();
+        out << QString::fromLatin1("Self check %1: %2\n")
+               .arg(instructionSetName(SourceScanner::InstructionSet(set)), 8)
+               .arg(mismatches == 0 ? QString::fromLatin1("ok") : QString::fromLatin1("%1 mismatches").arg(mismatches));
+        isCorrect = isCorrect && mismatches == 0;
+    }
+    SourceScanner::setInstructionSet(supported);
+    if (!isCorrect) {
+        return 2;
+    }
+
+    for (int i = 0; i < sources.size(); i++) {
+        const QString &source = sources.at(i);
+        // At least 64M characters transformed for each instruction set
+        const int iterations = qMax(3, int(64 * 1024 * 1024 / qMax(1, source.size())));
+        out << QString::fromLatin1("%1 (%2 characters, %3 iterations)\n")
+               .arg(names.at(i)).arg(source.size()).arg(iterations);
+
+        double scalarSpeed = 0;
+        for (int set = SourceScanner::Scalar; set <= supported; set++) {
+            SourceScanner::setInstructionSet(SourceScanner::InstructionSet(set));
+            int outputSize = 0;
+            // Warm up
+            transform(source, 1, outputSize);
+            const double speed = transform(source, iterations, outputSize);
+            if (set == SourceScanner::Scalar) {
+                scalarSpeed = speed;
+            }
+            out << QString::fromLatin1("    %1 %2 MB/s (x%3 of scalar scanner), %4 characters generated\n")
+                   .arg(instructionSetName(SourceScanner::InstructionSet(set)), 8)
+                   .arg(speed, 10, 'f', 1)
+                   .arg(speed / scalarSpeed, 0, 'f', 2)
+                   .arg(outputSize);
+        }
+    }
+    SourceScanner::setInstructionSet(supported);
+
+    return 0;
+}
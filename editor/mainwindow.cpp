@@ -31,6 +31,7 @@
 #include <QtScriptTools/QScriptEngineDebugger>
 
 #include <ScriptReport/ScriptReport>
+#include <ScriptReport/ScriptReportProfiler>
 #include <ScriptReport/TextStreamObject>
 #include <ScriptReport/SourceTransformer>
 
@@ -262,6 +263,10 @@ void MainWindow::run() {
     QString source = ui->sourcePlainTextEdit->toPlainText();
     scriptReport = new ScriptReport(source, currentShownName);
     scriptReport->setEditing(true);
+    if (ui->actionProfile->isChecked()) {
+        scriptReport->setProfilingEnabled(true);
+        scriptReport->profiler()->setSourceLines(currentShownName, source.split(QLatin1Char('\n')));
+    }
 
     scriptReport->updateIntermediateCode();
     QString generatedCode = scriptReport->intermediateCode();
@@ -305,6 +310,12 @@ void MainWindow::run() {
         isRunResultValid = true;
     }
 
+    if (scriptReport->profiler()) {
+        message.append(tr("\n\nThe slowest lines of the report:\n\n"));
+        message.append(scriptReport->profiler()->hotLines());
+        showReportResult();
+    }
+
     ui->reportResultTextEdit->setPlainText(message);
 
     QString header = scriptReport->outputHeader()->text();
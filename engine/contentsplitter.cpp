@@ -0,0 +1,160 @@
+/*
+ * Copyright 2010 and beyond, Juan Luis Paz
+ *
+ * This file is part of Script Report.
+ *
+ * Script Report is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Script Report is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with Script Report.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "contentsplitter.h"
+
+#include <QStringList>
+
+/*!
+    \internal
+    \class ContentSplitter
+    \brief Splits the HTML of the content section in chunks that can be laid out alone.
+
+    The text is appended as it is generated and it is cut in chunks of at least \a chunkSize characters at
+    safe boundaries: after a top level table or before a top level element with a \c page-break-before
+    style. Elements are top level when they are not inside a table, list, div, blockquote, center or pre
+    element. The document head, up to the \c body tag, is returned by \c prefix() for be repeated in every
+    chunk, so the style sheets apply to all of them.
+*/
+
+ContentSplitter::ContentSplitter(int chunkSize) :
+        m_chunkSize(chunkSize),
+        m_position(0),
+        m_depth(0),
+        m_isPageBreak(false),
+        m_hasCut(false),
+        m_isFinished(false)
+{
+}
+
+void ContentSplitter::append(const QString &text) {
+    if (m_isFinished) {
+        return;
+    }
+    m_buffer.append(text);
+    scan();
+}
+
+bool ContentSplitter::hasChunk() const {
+    return !m_chunks.isEmpty();
+}
+
+ContentSplitter::Chunk ContentSplitter::takeChunk() {
+    return m_chunks.takeFirst();
+}
+
+/*!
+    \internal
+    Returns the rest of the text as the last chunk.
+*/
+ContentSplitter::Chunk ContentSplitter::finish() {
+    Chunk chunk;
+    chunk.html = m_buffer;
+    chunk.isPageBreak = m_isPageBreak;
+    m_buffer.clear();
+    m_position = 0;
+    m_isFinished = true;
+    return chunk;
+}
+
+QString ContentSplitter::prefix() const {
+    return m_prefix;
+}
+
+/*
+ * Private members
+ */
+
+void ContentSplitter::scan() {
+    static QStringList containers = QStringList()
+            << QString::fromLatin1("table") << QString::fromLatin1("div") << QString::fromLatin1("ul")
+            << QString::fromLatin1("ol") << QString::fromLatin1("dl") << QString::fromLatin1("blockquote")
+            << QString::fromLatin1("center") << QString::fromLatin1("pre");
+
+    const QLatin1String pageBreak("page-break-before");
+
+    forever {
+        int i = m_buffer.indexOf(QLatin1Char('<'), m_position);
+        if (i < 0) {
+            m_position = m_buffer.size();
+            return;
+        }
+        if (m_buffer.midRef(i, 4) == QLatin1String("<!--")) {
+            int commentEnd = m_buffer.indexOf(QLatin1String("-->"), i + 4);
+            if (commentEnd < 0) {
+                m_position = i;
+                return;
+            }
+            m_position = commentEnd + 3;
+            continue;
+        }
+        int tagEnd = m_buffer.indexOf(QLatin1Char('>'), i);
+        if (tagEnd < 0) {
+            // The tag is not complete, it is scanned again with the next text
+            m_position = i;
+            return;
+        }
+
+        bool isClosing = m_buffer.at(i + 1) == QLatin1Char('/');
+        int nameStart = isClosing ? i + 2 : i + 1;
+        int nameEnd = nameStart;
+        while (nameEnd < tagEnd && m_buffer.at(nameEnd).isLetterOrNumber()) {
+            nameEnd++;
+        }
+        QString name = m_buffer.mid(nameStart, nameEnd - nameStart).toLower();
+        m_position = tagEnd + 1;
+
+        if (isClosing) {
+            if (m_depth == 0 && name == QLatin1String("body")) {
+                m_buffer.truncate(i);
+                m_isFinished = true;
+                return;
+            }
+            if (containers.contains(name)) {
+                m_depth = qMax(0, m_depth - 1);
+                if (m_depth == 0 && name == QLatin1String("table") && tagEnd + 1 >= m_chunkSize) {
+                    cut(tagEnd + 1, false);
+                }
+            }
+        } else if (!m_hasCut && name == QLatin1String("body")) {
+            // The document head, with the style sheets, is repeated in every chunk
+            m_prefix = m_buffer.left(tagEnd + 1);
+            m_buffer.remove(0, tagEnd + 1);
+            m_position = 0;
+        } else if (m_depth == 0 && i >= m_chunkSize
+                   && m_buffer.midRef(i, tagEnd - i).contains(pageBreak, Qt::CaseInsensitive)) {
+            // The tag is scanned again as the begin of the next chunk
+            cut(i, true);
+        } else if (containers.contains(name) && m_buffer.at(tagEnd - 1) != QLatin1Char('/')) {
+            m_depth++;
+        }
+    }
+}
+
+void ContentSplitter::cut(int position, bool isPageBreak) {
+    Chunk chunk;
+    chunk.html = m_buffer.left(position);
+    chunk.isPageBreak = m_isPageBreak;
+    m_chunks.append(chunk);
+
+    m_buffer.remove(0, position);
+    m_position = 0;
+    m_isPageBreak = isPageBreak;
+    m_hasCut = true;
+}
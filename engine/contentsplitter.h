@@ -0,0 +1,60 @@
+/*
+ * Copyright 2010 and beyond, Juan Luis Paz
+ *
+ * This file is part of Script Report.
+ *
+ * Script Report is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Script Report is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with Script Report.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef CONTENTSPLITTER_H
+#define CONTENTSPLITTER_H
+
+#include <QList>
+#include <QString>
+
+class ContentSplitter
+{
+public:
+    struct Chunk {
+        Chunk() : isPageBreak(false) {}
+
+        QString html;
+        bool isPageBreak;
+    };
+
+    explicit ContentSplitter(int chunkSize);
+
+    void append(const QString &text);
+    bool hasChunk() const;
+    Chunk takeChunk();
+    Chunk finish();
+
+    QString prefix() const;
+
+private:
+    void scan();
+    void cut(int position, bool isPageBreak);
+
+    int m_chunkSize;
+    QString m_buffer;
+    QString m_prefix;
+    QList<Chunk> m_chunks;
+    int m_position;
+    int m_depth;
+    bool m_isPageBreak;
+    bool m_hasCut;
+    bool m_isFinished;
+};
+
+#endif // CONTENTSPLITTER_H
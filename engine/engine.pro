@@ -19,20 +19,44 @@
 
 include(../scriptreport.pri)
 include(scriptable/scriptable.pri)
-QT += script widgets printsupport
+QT += script widgets printsupport concurrent
 TARGET = scriptreportengine
 TEMPLATE = lib
 DESTDIR = ../compiled
 DEFINES += SCRIPTREPORTENGINE_LIBRARY
 SOURCES += scriptreport.cpp \
+    contentsplitter.cpp \
+    pagenumberobject.cpp \
+    scriptreportcache.cpp \
+    scriptreportenginepool.cpp \
+    scriptreportjobrunner.cpp \
+    scriptreportprogramcache.cpp \
     scriptreportengine.cpp \
+    scriptreportpagelayout.cpp \
+    scriptreportpipeline.cpp \
+    scriptreportprofiler.cpp \
+    scriptreportstats.cpp \
+    scriptreporttracer.cpp \
     sourcetransformer.cpp \
+    sourcescanner.cpp \
     textstreamobject.cpp \
     shell.cpp
 HEADERS += scriptreport.h \
+    contentsplitter.h \
+    pagenumberobject.h \
+    scriptreportcache.h \
+    scriptreportenginepool.h \
+    scriptreportjobrunner.h \
+    scriptreportprogramcache.h \
     scriptreportengine.h \
     scriptreportengine_global.h \
+    scriptreportpagelayout.h \
+    scriptreportpipeline.h \
+    scriptreportprofiler.h \
+    scriptreportstats.h \
+    scriptreporttracer.h \
     sourcetransformer.h \
+    sourcescanner.h \
     textstreamobject.h \
     shell.h
 
@@ -0,0 +1,215 @@
+/*
+ * Copyright 2010 and beyond, Juan Luis Paz
+ *
+ * This file is part of Script Report.
+ *
+ * Script Report is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Script Report is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with Script Report.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "pagenumberobject.h"
+
+#include <QTextDocument>
+#include <QTextCursor>
+#include <QAbstractTextDocumentLayout>
+#include <QFontMetricsF>
+#include <QPainter>
+
+/*!
+    \internal
+    \class PageNumberObject
+    \brief Inline text object that paints the current page number or the page count.
+
+    The \c ##page## and \c ##pageCount## markers of a document are replaced by this object once, after the document
+    is parsed. The numbers are read at paint time, so a document is not parsed again for each printed page.
+
+    When \a reserveWidth is true the page number takes the width of the page count at layout time, so the layout
+    of the document remains valid for every page. Otherwise the document must be marked as dirty when the page
+    changes.
+
+    When the page count is deferred, because it is not known when the document is painted, the page count is
+    not painted but its position is saved, and it is painted later with \c paintDeferredNumbers().
+
+    Only the markers in the text of a document can be replaced by the object, the markers inside a tag, like in
+    the \c href, \c src, \c title or \c style attributes, are not part of the text. The headers and footers
+    with such markers are parsed again for each page with the markers replaced in the html, see
+    \c hasMarkerInTag() and \c replaceMarkers(). The content, or each chunk of a chunked content, with such
+    markers is parsed again for each page too. The page count marker inside a tag is kept as it is while the
+    page count is not known, like in a streamed layout.
+*/
+
+PageNumberObject::PageNumberObject(bool reserveWidth, QObject *parent) :
+        QObject(parent), m_reserveWidth(reserveWidth), m_pageCountDeferred(false), m_page(0), m_pageCount(0)
+{
+}
+
+int PageNumberObject::page() const {
+    return m_page;
+}
+
+void PageNumberObject::setPage(int page) {
+    m_page = page;
+}
+
+int PageNumberObject::pageCount() const {
+    return m_pageCount;
+}
+
+void PageNumberObject::setPageCount(int pageCount) {
+    m_pageCount = pageCount;
+}
+
+bool PageNumberObject::isPageCountDeferred() const {
+    return m_pageCountDeferred;
+}
+
+void PageNumberObject::setPageCountDeferred(bool deferred) {
+    m_pageCountDeferred = deferred;
+}
+
+/*!
+    \internal
+    Returns the page counts not painted since the last call, in the coordinates of the painter
+    used for paint the document.
+*/
+QList<PageNumberObject::DeferredNumber> PageNumberObject::takeDeferredNumbers() {
+    QList<DeferredNumber> numbers = m_deferredNumbers;
+    m_deferredNumbers.clear();
+    return numbers;
+}
+
+void PageNumberObject::paintDeferredNumbers(QPainter *painter, const QList<DeferredNumber> &numbers, int pageCount) {
+    if (numbers.isEmpty()) {
+        return;
+    }
+    QString text = QString::number(pageCount);
+    painter->save();
+    foreach (const DeferredNumber &number, numbers) {
+        painter->setFont(number.font);
+        if (number.color.isValid()) {
+            painter->setPen(number.color);
+        }
+        painter->drawText(number.position, text);
+    }
+    painter->restore();
+}
+
+/*!
+    \internal
+    Registers this object in the layout of \a document and replaces the page markers of the document by it.
+    Returns true if any marker was found.
+*/
+bool PageNumberObject::install(QTextDocument *document) {
+    document->documentLayout()->registerHandler(PageNumberFormat, this);
+    document->setUndoRedoEnabled(false);
+
+    QString markers[] = { QString::fromLatin1("##page##"), QString::fromLatin1("##pageCount##") };
+    int kinds[] = { Page, PageCount };
+    QString replacement(QChar::ObjectReplacementCharacter);
+    bool found = false;
+
+    for (int i = 0; i < 2; i++) {
+        QTextCursor cursor = document->find(markers[i], 0, QTextDocument::FindCaseSensitively);
+        while (!cursor.isNull()) {
+            QTextCharFormat format = cursor.charFormat();
+            format.setObjectType(PageNumberFormat);
+            format.setProperty(KindProperty, kinds[i]);
+            cursor.insertText(replacement, format);
+            found = true;
+            cursor = document->find(markers[i], cursor, QTextDocument::FindCaseSensitively);
+        }
+    }
+    return found;
+}
+
+/*!
+    \internal
+    Returns true if \a html has a page marker inside a tag, where \c install() can't replace it.
+*/
+bool PageNumberObject::hasMarkerInTag(const QString &html) {
+    QString markers[] = { QString::fromLatin1("##page##"), QString::fromLatin1("##pageCount##") };
+    for (int i = 0; i < 2; i++) {
+        int index = html.indexOf(markers[i]);
+        while (index >= 0) {
+            int tagStart = html.lastIndexOf(QLatin1Char('<'), index);
+            if (tagStart >= 0 && tagStart > html.lastIndexOf(QLatin1Char('>'), index)) {
+                return true;
+            }
+            index = html.indexOf(markers[i], index + markers[i].size());
+        }
+    }
+    return false;
+}
+
+/*!
+    \internal
+    Returns \a html with the page markers replaced by \a page and \a pageCount, the page count marker is
+    kept if \a pageCount is negative.
+*/
+QString PageNumberObject::replaceMarkers(const QString &html, int page, int pageCount) {
+    QString result = html;
+    if (pageCount >= 0) {
+        result.replace(QString::fromLatin1("##pageCount##"), QString::number(pageCount));
+    }
+    result.replace(QString::fromLatin1("##page##"), QString::number(page));
+    return result;
+}
+
+QSizeF PageNumberObject::intrinsicSize(QTextDocument *document, int posInDocument, const QTextFormat &format) {
+    Q_UNUSED(document)
+    Q_UNUSED(posInDocument)
+
+    // The object is placed over the baseline, the descent is taken from the surrounding text
+    QFontMetricsF metrics(format.toCharFormat().font());
+    return QSizeF(metrics.width(text(format, true)), metrics.ascent());
+}
+
+void PageNumberObject::drawObject(QPainter *painter, const QRectF &rect, QTextDocument *document, int posInDocument, const QTextFormat &format) {
+    Q_UNUSED(document)
+    Q_UNUSED(posInDocument)
+
+    QTextCharFormat charFormat = format.toCharFormat();
+    if (m_pageCountDeferred && format.intProperty(KindProperty) == PageCount) {
+        DeferredNumber number;
+        number.position = painter->worldTransform().map(QPointF(rect.left(), rect.bottom()));
+        number.font = charFormat.font();
+        if (charFormat.hasProperty(QTextFormat::ForegroundBrush)) {
+            number.color = charFormat.foreground().color();
+        }
+        m_deferredNumbers.append(number);
+        return;
+    }
+
+    painter->save();
+    painter->setFont(charFormat.font());
+    if (charFormat.hasProperty(QTextFormat::ForegroundBrush)) {
+        painter->setPen(charFormat.foreground().color());
+    }
+    painter->drawText(QPointF(rect.left(), rect.bottom()), text(format, false));
+    painter->restore();
+}
+
+/*
+ * Private members
+ */
+
+QString PageNumberObject::text(const QTextFormat &format, bool sizing) const {
+    if (format.intProperty(KindProperty) == PageCount) {
+        // A deferred page count reserves the width of four digits
+        return QString::number(m_pageCountDeferred ? qMax(m_pageCount, 1000) : m_pageCount);
+    }
+    if (sizing && m_reserveWidth) {
+        return QString::number(qMax(m_page, m_pageCount));
+    }
+    return QString::number(m_page);
+}
@@ -0,0 +1,82 @@
+/*
+ * Copyright 2010 and beyond, Juan Luis Paz
+ *
+ * This file is part of Script Report.
+ *
+ * Script Report is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Script Report is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with Script Report.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef PAGENUMBEROBJECT_H
+#define PAGENUMBEROBJECT_H
+
+#include <QObject>
+#include <QList>
+#include <QFont>
+#include <QColor>
+#include <QPointF>
+#include <QTextObjectInterface>
+
+class QTextDocument;
+
+class PageNumberObject : public QObject, public QTextObjectInterface
+{
+Q_OBJECT
+Q_INTERFACES(QTextObjectInterface)
+public:
+    enum ObjectType {
+        PageNumberFormat = QTextFormat::UserObject + 1
+    };
+    enum Property {
+        KindProperty = QTextFormat::UserProperty + 1
+    };
+    enum Kind {
+        Page,
+        PageCount
+    };
+
+    struct DeferredNumber {
+        QPointF position;
+        QFont font;
+        QColor color;
+    };
+
+    explicit PageNumberObject(bool reserveWidth, QObject *parent = 0);
+
+    int page() const;
+    void setPage(int page);
+    int pageCount() const;
+    void setPageCount(int pageCount);
+    bool isPageCountDeferred() const;
+    void setPageCountDeferred(bool deferred);
+    QList<DeferredNumber> takeDeferredNumbers();
+    static void paintDeferredNumbers(QPainter *painter, const QList<DeferredNumber> &numbers, int pageCount);
+
+    bool install(QTextDocument *document);
+    static bool hasMarkerInTag(const QString &html);
+    static QString replaceMarkers(const QString &html, int page, int pageCount);
+
+    QSizeF intrinsicSize(QTextDocument *document, int posInDocument, const QTextFormat &format);
+    void drawObject(QPainter *painter, const QRectF &rect, QTextDocument *document, int posInDocument, const QTextFormat &format);
+
+private:
+    QString text(const QTextFormat &format, bool sizing) const;
+
+    bool m_reserveWidth;
+    bool m_pageCountDeferred;
+    int m_page;
+    int m_pageCount;
+    QList<DeferredNumber> m_deferredNumbers;
+};
+
+#endif // PAGENUMBEROBJECT_H
@@ -25,6 +25,9 @@
 #include <QtScript/QScriptEngine>
 #include <QtScript/QScriptValueIterator>
 
+#include "scriptreportprogramcache.h"
+#include "scriptreporttracer.h"
+
 ScriptableEngine::ScriptableEngine(QObject *parent) :
     QObject(parent), QScriptable()
 {
@@ -62,6 +65,8 @@ Q_INVOKABLE void ScriptableEngine::importExtension() {
     if (argumentCount > 0) {
         for (int i = 0; i < argumentCount; i++) {
             QString name = ctx->argument(i).toString();
+            ScriptReportTraceSpan span("extension", "importExtension");
+            span.setArgument(QString::fromLatin1("name"), name);
             eng->importExtension(name);
             if (eng->hasUncaughtException()) {
                 return;
@@ -97,7 +102,7 @@ void ScriptableEngine::load() {
         QTextStream stream(&scriptFile);
         QString contents = stream.readAll();
 
-        eng->evaluate(contents, fileName);
+        ScriptReportProgramCache::evaluate(eng, contents, fileName);
         if (eng->hasUncaughtException()) {
             return;
         }
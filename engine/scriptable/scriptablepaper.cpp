@@ -21,6 +21,7 @@
 
 #include <QtCore/QMetaEnum>
 #include <QPrinter>
+#include <QtGui/QPagedPaintDevice>
 #include <QtScript/QScriptEngine>
 
 /*
@@ -133,6 +134,18 @@ void ScriptablePaper::applyConfigurationTo(QPrinter &printer) {
     m_margins->applyConfigurationTo(printer);
 }
 
+void ScriptablePaper::applyConfigurationTo(QPagedPaintDevice &device) {
+    if (m_isOrientationChanged) {
+        if (m_orientation == Landscape) {
+            device.setPageOrientation(QPageLayout::Landscape);
+        } else {
+            device.setPageOrientation(QPageLayout::Portrait);
+        }
+    }
+    m_size->applyConfigurationTo(device);
+    m_margins->applyConfigurationTo(device);
+}
+
 void ScriptablePaper::initEngine(QScriptEngine &engine) {
     qScriptRegisterMetaType(&engine, paperSizeToScriptValue, paperSizeFromScriptValue);
     qScriptRegisterMetaType(&engine, paperMarginsToScriptValue, paperMarginsFromScriptValue);
@@ -28,6 +28,7 @@
 #include "scriptablepapermargins.h"
 
 class QPrinter;
+class QPagedPaintDevice;
 class QScriptEngine;
 
 class ScriptablePaper : public QObject, public QScriptable
@@ -55,6 +56,7 @@ public:
 
     void loadConfigurationFrom(QPrinter &printer);
     void applyConfigurationTo(QPrinter &printer);
+    void applyConfigurationTo(QPagedPaintDevice &device);
     void initEngine(QScriptEngine &engine);
 
 private:
@@ -20,7 +20,9 @@
 #include "scriptablepapermargins.h"
 
 #include <QtCore/QMetaEnum>
+#include <QtCore/QMarginsF>
 #include <QPrinter>
+#include <QtGui/QPagedPaintDevice>
 #include <QtScript/QScriptContext>
 #include <QtScript/QScriptValue>
 
@@ -205,3 +207,16 @@ void ScriptablePaperMargins::applyConfigurationTo(QPrinter &printer) {
         }
     }
 }
+
+void ScriptablePaperMargins::applyConfigurationTo(QPagedPaintDevice &device) {
+    // The QPrinter units have the same values that the QPageLayout ones
+    if (m_isMarginsChanged) {
+        if (m_unit == Centimeter) {
+            QMarginsF margins(m_left * 10, m_top * 10, m_right * 10, m_bottom * 10);
+            device.setPageMargins(margins, QPageLayout::Millimeter);
+        } else {
+            QMarginsF margins(m_left, m_top, m_right, m_bottom);
+            device.setPageMargins(margins, QPageLayout::Unit(toQPrinter(m_unit)));
+        }
+    }
+}
@@ -25,6 +25,7 @@
 #include <QtScript/QScriptable>
 
 class QPrinter;
+class QPagedPaintDevice;
 
 class ScriptablePaperMargins : public QObject, public QScriptable
 {
@@ -78,6 +79,7 @@ public:
 
     void loadConfigurationFrom(QPrinter &printer);
     void applyConfigurationTo(QPrinter &printer);
+    void applyConfigurationTo(QPagedPaintDevice &device);
 
 private:
     qreal m_top;
@@ -21,6 +21,8 @@
 
 #include <QMetaEnum>
 #include <QPrinter>
+#include <QPageSize>
+#include <QPagedPaintDevice>
 #include <QScriptContext>
 #include <QScriptValue>
 
@@ -372,6 +374,23 @@ void ScriptablePaperSize::applyConfigurationTo(QPrinter &printer) {
     }
 }
 
+void ScriptablePaperSize::applyConfigurationTo(QPagedPaintDevice &device) {
+    // The QPrinter paper sizes and units have the same values that the QPageSize ones
+    if (m_isSizeChanged) {
+        if (m_size == Custom) {
+            if (m_unit == Centimeter) {
+                QSizeF sizef(m_width * 10, m_height * 10);
+                device.setPageSize(QPageSize(sizef, QPageSize::Millimeter));
+            } else {
+                QSizeF sizef(m_width, m_height);
+                device.setPageSize(QPageSize(sizef, QPageSize::Unit(toQPrinter(m_unit))));
+            }
+        } else {
+            device.setPageSize(QPageSize(QPageSize::PageSizeId(toQPrinter(m_size))));
+        }
+    }
+}
+
 void ScriptablePaperSize::updateHeightAndWidth() {
     QPrinter printer;
     printer.setPaperSize(toQPrinter(m_size));
@@ -25,6 +25,7 @@
 #include <QtScript/QScriptable>
 
 class QPrinter;
+class QPagedPaintDevice;
 
 class ScriptablePaperSize : public QObject, public QScriptable
 {
@@ -83,6 +84,7 @@ public:
 
     void loadConfigurationFrom(QPrinter &printer);
     void applyConfigurationTo(QPrinter &printer);
+    void applyConfigurationTo(QPagedPaintDevice &device);
 
 private:
     void updateHeightAndWidth();
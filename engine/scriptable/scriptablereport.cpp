@@ -19,9 +19,13 @@
 
 #include "scriptablereport.h"
 
+#include <QtCore/QCoreApplication>
 #include <QtCore/QTextStream>
+#include <QtCore/QThread>
 #include <QPrinter>
+#include <QPdfWriter>
 #include <QWidget>
+#include <QtGui/QImage>
 #include <QtGui/QPainter>
 #include <QtGui/QPicture>
 #include <QtGui/QTextDocument>
@@ -34,6 +38,32 @@
  * Statics
  */
 
+static bool isGuiThread() {
+    QCoreApplication *application = QCoreApplication::instance();
+    return application && QThread::currentThread() == application->thread();
+}
+
+// Pixmaps can only be used in the application thread, in other threads (like the workers of
+// ScriptReportJobRunner) the picture is played into an image
+static QVariant pictureToImage(const QPicture &picture) {
+    QPainter p;
+    if (isGuiThread()) {
+        QPixmap image(picture.width(), picture.height());
+        image.fill(QColor(0,0,0,0));
+        p.begin(&image);
+        picture.play(&p);
+        p.end();
+        return QVariant(image);
+    } else {
+        QImage image(picture.width(), picture.height(), QImage::Format_ARGB32_Premultiplied);
+        image.fill(Qt::transparent);
+        p.begin(&image);
+        picture.play(&p);
+        p.end();
+        return QVariant(image);
+    }
+}
+
 static QScriptValue paperToScriptValue(QScriptEngine *engine, ScriptablePaper* const &in) {
     return engine->newQObject(in, QScriptEngine::QtOwnership, QScriptEngine::ExcludeChildObjects | QScriptEngine::ExcludeSuperClassContents | QScriptEngine::ExcludeDeleteLater);
 }
@@ -140,6 +170,7 @@ void ScriptableReport::writeContent() {
     } else {
         writeResult(m_sre->outputContent());
     }
+    m_sre->contentWritten();
 }
 
 void ScriptableReport::writeFooter() {
@@ -180,6 +211,14 @@ void ScriptableReport::applyConfigurationTo(QPrinter &printer) {
     m_scriptablePaper->applyConfigurationTo(printer);
 }
 
+void ScriptableReport::applyConfigurationTo(QPagedPaintDevice &device) {
+    QPdfWriter *pdfWriter = dynamic_cast<QPdfWriter*>(&device);
+    if (pdfWriter) {
+        pdfWriter->setTitle(m_title);
+    }
+    m_scriptablePaper->applyConfigurationTo(device);
+}
+
 void ScriptableReport::initEngine(QScriptEngine &engine) {
     qScriptRegisterMetaType(&engine, paperToScriptValue, paperFromScriptValue);
 
@@ -249,20 +288,23 @@ QString ScriptableReport::addImageResource(QScriptValue value, QString url) {
         if (file.isNull()) {
             return result;
         }
-        QPixmap pixmap;
-        if (pixmap.load(file)) {
-            result = m_sre->addResource(QTextDocument::ImageResource, QVariant(pixmap), url);
-            return result;
+        if (isGuiThread()) {
+            QPixmap pixmap;
+            if (pixmap.load(file)) {
+                result = m_sre->addResource(QTextDocument::ImageResource, QVariant(pixmap), url);
+                return result;
+            }
+        } else {
+            QImage image;
+            if (image.load(file)) {
+                result = m_sre->addResource(QTextDocument::ImageResource, QVariant(image), url);
+                return result;
+            }
         }
         if (file.endsWith(QString::fromLatin1(".pic")) || file.endsWith(QString::fromLatin1(".PIC"))) {
             QPicture picture;
             if (picture.load(file)) {
-                QPixmap image(picture.width(), picture.height());
-                QPainter p;
-                p.begin(&image);
-                picture.play(&p);
-                p.end();
-                result = m_sre->addResource(QTextDocument::ImageResource, QVariant(image), url);
+                result = m_sre->addResource(QTextDocument::ImageResource, pictureToImage(picture), url);
                 return result;
             }
         }
@@ -277,6 +319,12 @@ QString ScriptableReport::insertImageResource(QScriptValue value, QString url) {
     if (value.isQObject()) {
         QObject *object = value.toQObject();
         if (QWidget *w = qobject_cast<QWidget*>(object)) {
+            if (!isGuiThread()) {
+                if (context()) {
+                    context()->throwError(tr("Widgets can only be rendered in the application thread, use an image instead"));
+                }
+                return QString();
+            }
             { // fixme: need a previous render for get the real image size
                 QPixmap image(w->size());
                 QPainter p;
@@ -307,13 +355,7 @@ QString ScriptableReport::insertImageResource(QScriptValue value, QString url) {
             return fileName;
         } else if (variant.canConvert<QPicture>()) {
             QPicture picture = variant.value<QPicture>();
-            QPixmap image(picture.width(), picture.height());
-            image.fill(QColor(0,0,0,0));
-            QPainter p;
-            p.begin(&image);
-            picture.play(&p);
-            p.end();
-            QString fileName = m_sre->addResource(QTextDocument::ImageResource, QVariant(image), url);
+            QString fileName = m_sre->addResource(QTextDocument::ImageResource, pictureToImage(picture), url);
             return fileName;
         }
     }
@@ -29,6 +29,7 @@
 
 class QScriptEngine;
 class QPrinter;
+class QPagedPaintDevice;
 
 class ScriptReport;
 class TextStreamObject;
@@ -67,6 +68,7 @@ public:
 
     void loadConfigurationFrom(QPrinter &printer);
     void applyConfigurationTo(QPrinter &printer);
+    void applyConfigurationTo(QPagedPaintDevice &device);
     void initEngine(QScriptEngine &engine);
 
     Q_INVOKABLE QString addImageResource(QScriptValue value, QString url = QString());
@@ -25,6 +25,8 @@
 #include <QtScript/QScriptEngine>
 #include <QtScript/QScriptValueIterator>
 
+#include "scriptreporttracer.h"
+
 ScriptableShellEngine::ScriptableShellEngine(Shell *shell, QObject *parent) :
     /*ScriptableEngine(parent),*/
     QObject(parent), QScriptable(),
@@ -126,6 +128,8 @@ Q_INVOKABLE void ScriptableShellEngine::importExtension() {
     if (argumentCount > 0) {
         for (int i = 0; i < argumentCount; i++) {
             QString name = ctx->argument(i).toString();
+            ScriptReportTraceSpan span("extension", "importExtension");
+            span.setArgument(QString::fromLatin1("name"), name);
             eng->importExtension(name);
             if (eng->hasUncaughtException()) {
                 return;
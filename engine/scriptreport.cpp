@@ -23,7 +23,15 @@
 #include <QFile>
 #include <QTextDocument>
 #include <QPainter>
+#include <QPicture>
+#include <QCache>
+#include <QElapsedTimer>
+#include <QImage>
+#include <QPixmap>
+#include <QtNumeric>
+#include <QPointer>
 #include <QScriptEngine>
+#include <QScriptValueIterator>
 
 #if QT_VERSION >= 0x050000
 #include <QtPrintSupport/QPrinter>
@@ -32,12 +40,42 @@
 #endif
 
 #include "sourcetransformer.h"
+#include "scriptreportcache.h"
+#include "scriptreportprogramcache.h"
+#include "scriptreportpipeline.h"
+#include "scriptreportprofiler.h"
+#include "scriptreporttracer.h"
 #include "textstreamobject.h"
 #include "scriptable/scriptablereport.h"
 #include "scriptable/scriptableengine.h"
 
 #include "scriptreportengine.h"
 
+typedef QPair<QScriptValue, QScriptValue::PropertyFlags> ScriptReportProperty;
+typedef QHash<QString, ScriptReportProperty> ScriptReportProperties;
+
+// The methods called when the report of an engine is recycled, it is a child of the engine, so it
+// is only used in the engine's thread and it is destroyed with the engine
+class EngineRecycleHandlers : public QObject {
+public:
+    explicit EngineRecycleHandlers(QScriptEngine *engine) :
+            QObject(engine)
+    {
+        setObjectName(name());
+    }
+
+    static QString name() {
+        return QString::fromLatin1("ScriptReportRecycleHandlers");
+    }
+
+    static EngineRecycleHandlers *find(QScriptEngine *engine) {
+        return static_cast<EngineRecycleHandlers*>(
+                engine->findChild<QObject*>(name(), Qt::FindDirectChildrenOnly));
+    }
+
+    QList<QPair<QPointer<QObject>, QByteArray> > handlers;
+};
+
 class ScriptReportPrivate {
 public:
 
@@ -50,11 +88,19 @@ public:
             isInDebuggingMode(false),
             name(reportName),
             isWriteWithPrintFunctionTooEnabled(false),
+            layoutChunkSize(0),
+            isPipelineEnabled(false),
             scriptableReport(0),
             scriptableEngine(0),
             scriptReportEngine(0),
             inFile(0),
-            lastResourceIndex(0)
+            lastResourceIndex(0),
+            pageCache(32 * 1024 * 1024),
+            pageCachePageCount(-1),
+            pipeline(0),
+            isContentTaken(false),
+            takenContentSize(0),
+            profiler(0)
     {
         construct();
     }
@@ -112,6 +158,126 @@ public:
         scriptReportEngine = new ScriptReportEngine();
     }
 
+    void resetOutput() {
+        outHeaderStreamObject->reset();
+        outHeaderFirstStreamObject->reset();
+        outHeaderLastStreamObject->reset();
+        outStreamObject->reset();
+        outFooterStreamObject->reset();
+        outFooterFirstStreamObject->reset();
+        outFooterLastStreamObject->reset();
+        resources.clear();
+        lastResourceIndex = 0;
+        isContentTaken = false;
+        clearPageCache();
+    }
+
+    void clearPageCache() {
+        pageCache.clear();
+        pageCachePageCount = -1;
+    }
+
+    static qint64 sectionSize(const TextStreamObject *section) {
+        return section->text().size() * qint64(sizeof(QChar));
+    }
+
+    void updateOutputStats() {
+        stats.headerSize = sectionSize(outHeaderStreamObject);
+        stats.headerFirstSize = sectionSize(outHeaderFirstStreamObject);
+        stats.headerLastSize = sectionSize(outHeaderLastStreamObject);
+        stats.contentSize = sectionSize(outStreamObject) + takenContentSize;
+        stats.footerSize = sectionSize(outFooterStreamObject);
+        stats.footerFirstSize = sectionSize(outFooterFirstStreamObject);
+        stats.footerLastSize = sectionSize(outFooterLastStreamObject);
+
+        // The content taken by the pipeline is not kept, its peak is the biggest taken chunk
+        qint64 sizes[] = { stats.headerSize, stats.headerFirstSize, stats.headerLastSize,
+                           stats.contentSize - takenContentSize, stats.footerSize,
+                           stats.footerFirstSize, stats.footerLastSize };
+        for (unsigned i = 0; i < sizeof(sizes) / sizeof(sizes[0]); i++) {
+            stats.peakSectionSize = qMax(stats.peakSectionSize, sizes[i]);
+        }
+
+        stats.resourceCount = resources.size();
+        stats.resourceSize = 0;
+        foreach (const ScriptReportResourcePair &resource, resources) {
+            const QVariant &value = resource.second;
+            switch (value.type()) {
+            case QVariant::Image:
+                stats.resourceSize += qvariant_cast<QImage>(value).byteCount();
+                break;
+            case QVariant::Pixmap: {
+                QPixmap pixmap = qvariant_cast<QPixmap>(value);
+                stats.resourceSize += qint64(pixmap.width()) * pixmap.height() * pixmap.depth() / 8;
+                break;
+            }
+            case QVariant::ByteArray:
+                stats.resourceSize += value.toByteArray().size();
+                break;
+            case QVariant::String:
+                stats.resourceSize += value.toString().size() * qint64(sizeof(QChar));
+                break;
+            default:
+                break;
+            }
+        }
+    }
+
+    void usePageCacheSize(const QSize &pageSize) {
+        if (pageCacheSize != pageSize) {
+            clearPageCache();
+            pageCacheSize = pageSize;
+        }
+    }
+
+    static void saveProperties(const QScriptValue &object, ScriptReportProperties &properties) {
+        properties.clear();
+        QScriptValueIterator it(object);
+        while (it.hasNext()) {
+            it.next();
+            properties.insert(it.name(), ScriptReportProperty(it.value(), it.flags()));
+        }
+    }
+
+    // Like strictlyEquals() but NaN is equal to itself, the global NaN is never changed
+    static bool isSameValue(const QScriptValue &a, const QScriptValue &b) {
+        if (a.isNumber() && b.isNumber() && qIsNaN(a.toNumber()) && qIsNaN(b.toNumber())) {
+            return true;
+        }
+        return a.strictlyEquals(b);
+    }
+
+    // Removes the properties added to the object and restores the changed ones. The top-level var
+    // and function declarations of a report are not deletable in QtScript, they are set to undefined
+    // and kept in properties for the next reports. Returns false if a property could not be restored.
+    static bool restoreProperties(QScriptValue object, ScriptReportProperties &properties) {
+        QStringList added;
+        QScriptValueIterator it(object);
+        while (it.hasNext()) {
+            it.next();
+            if (!properties.contains(it.name())) {
+                added << it.name();
+            }
+        }
+        foreach (const QString &name, added) {
+            object.setProperty(name, QScriptValue());
+            if (object.property(name).isValid()) {
+                properties.insert(name, ScriptReportProperty(object.engine()->undefinedValue(), QScriptValue::KeepExistingFlags));
+            }
+        }
+
+        ScriptReportProperties::const_iterator i = properties.constBegin();
+        for (; i != properties.constEnd(); ++i) {
+            if (!isSameValue(object.property(i.key()), i.value().first)) {
+                object.setProperty(i.key(), i.value().first, i.value().second);
+                if (!isSameValue(object.property(i.key()), i.value().first)) {
+                    return false;
+                }
+            }
+        }
+        return true;
+    }
+
     bool isPrintErrorEnabled;
 
     bool isRunRequired;
@@ -125,6 +291,8 @@ public:
     QString name;
     QString type;
     bool isWriteWithPrintFunctionTooEnabled;
+    int layoutChunkSize;
+    bool isPipelineEnabled;
     QScriptEngine *engine;
     QString intermediate;
 
@@ -147,6 +315,29 @@ public:
 
     ScriptReportResources resources;
     int lastResourceIndex;
+
+    // The global scope after the engine initialization, used by the ScriptReportEnginePool
+    ScriptReportProperties globalProperties;
+    ScriptReportProperties srProperties;
+    QStringList importedExtensions;
+
+    // The recorded pages of the last output, for the page size pageCacheSize; the cost is in bytes
+    QCache<int, QPicture> pageCache;
+    QSize pageCacheSize;
+    int pageCachePageCount;
+
+    // The pipeline that consumes the content while the report is run
+    ScriptReportPipeline *pipeline;
+    // The content was consumed by a chunked layout
+    bool isContentTaken;
+
+    // The statistics of the last transformation, run and render; the size of the content consumed
+    // by the pipeline is kept apart
+    ScriptReportStats stats;
+    qint64 takenContentSize;
+
+    // The profiler of the scripts, it is owned by the engine
+    ScriptReportProfiler *profiler;
 };
 
 /*!
@@ -205,6 +396,7 @@ ScriptReport::ScriptReport(QObject *parent) :
         QObject(parent),
         d(new ScriptReportPrivate())
 {
+    connect(d->inStreamObject, SIGNAL(changed()), this, SLOT(inputChanged()));
 }
 
 /*!
@@ -215,14 +407,8 @@ ScriptReport::ScriptReport(QString reportName, QObject *parent) :
         QObject(parent),
         d(new ScriptReportPrivate(reportName))
 {
-    d->inFile = new QFile(reportName);
-    if (d->inFile->open( QIODevice::ReadOnly)) {
-        QTextStream *in  = new QTextStream(d->inFile);
-        d->inStreamObject->setStream(in);
-    } else {
-        QString error = QString::fromLatin1("<!--@ throw \"Unable to read the file '%1'\"; -->").arg(reportName);
-        d->inStreamObject->setText(error);
-    }
+    openInputFile(reportName);
+    connect(d->inStreamObject, SIGNAL(changed()), this, SLOT(inputChanged()));
 }
 
 /*!
@@ -235,6 +421,7 @@ ScriptReport::ScriptReport(QTextStream *inputStream, QString reportName, QObject
         d(new ScriptReportPrivate(reportName))
 {
     d->inStreamObject->setStream(inputStream);
+    connect(d->inStreamObject, SIGNAL(changed()), this, SLOT(inputChanged()));
 }
 
 /*!
@@ -247,6 +434,7 @@ ScriptReport::ScriptReport(QString input, QString reportName, QObject *parent) :
         d(new ScriptReportPrivate(reportName))
 {
     d->inStreamObject->setText(input);
+    connect(d->inStreamObject, SIGNAL(changed()), this, SLOT(inputChanged()));
 }
 
 /*!
@@ -323,7 +511,7 @@ void ScriptReport::setPrintErrorEnabled(bool isPrintErrorEnabled) {
     This is avaiable in the script with \c sr.engine.arguments
 */
 QStringList ScriptReport::arguments() const {
-    if (!d->scriptableEngine) {
+    if (d->scriptableEngine) {
         return d->scriptableEngine->arguments();
     } else {
         return QStringList();
@@ -376,6 +564,89 @@ void ScriptReport::setWriteWithPrintFunctionTooEnabled(bool isWriteWithPrintFunc
     d->isWriteWithPrintFunctionTooEnabled = isWriteWithPrintFunctionTooEnabled;
 }
 
+/*!
+    \property ScriptReport::layoutChunkSize
+    \brief The size, in characters, of the chunks in which the content is laid out.
+
+    When the content is bigger it is split at top level tables and at elements with a
+    \c page-break-before style, and each chunk is laid out and painted before the next one is
+    parsed. This keeps the memory used for print a big report proportional to a few pages.
+    The default value is 0, the whole content is laid out at once.
+
+    The chunked layout takes the content from the report, so \c outputContent() is empty after
+    print and the report is reset and run again when its pages must be laid out again, like
+    for print them with another page size.
+
+    \sa reset()
+*/
+int ScriptReport::layoutChunkSize() const {
+    return d->layoutChunkSize;
+}
+
+void ScriptReport::setLayoutChunkSize(int layoutChunkSize) {
+    if (d->layoutChunkSize != layoutChunkSize) {
+        d->layoutChunkSize = layoutChunkSize;
+        d->clearPageCache();
+    }
+}
+
+/*!
+    \property ScriptReport::isPipelineEnabled
+    \brief Specifies if the report is printed while it is generated.
+
+    When it is enabled and the report must be run, \c print() and \c render() run the report
+    while another thread lays out the content and prints the pages as they are complete. The
+    content is split in chunks of \l layoutChunkSize characters, or 64K if it is 0, like in
+    the chunked layout. The time to the first page is not the time of run the whole report and
+    lay out the whole content.
+
+    The print configuration and the header and footer sections must be written before the
+    content. When a section uses the page count the pages are printed at the end. The printers
+    with a page range, the reverse order or uncollated copies are not printed while the report
+    is generated. The output sections are cleared after print, so the report is run again the
+    next time that it is printed.
+*/
+bool ScriptReport::isPipelineEnabled() const {
+    return d->isPipelineEnabled;
+}
+
+void ScriptReport::setPipelineEnabled(bool isPipelineEnabled) {
+    d->isPipelineEnabled = isPipelineEnabled;
+}
+
+/*!
+    \property ScriptReport::isProfilingEnabled
+    \brief Specifies if the scripts are measured by a ScriptReportProfiler when the report is run.
+
+    The measures of the last run are available in \l profiler(). The profiler replaces the
+    debugger while the report is run. The scripts are not taken from or stored in the
+    ScriptReportProgramCache while they are profiled.
+*/
+bool ScriptReport::isProfilingEnabled() const {
+    return d->profiler != 0;
+}
+
+void ScriptReport::setProfilingEnabled(bool isProfilingEnabled) {
+    if (isProfilingEnabled == (d->profiler != 0)) {
+        return;
+    }
+    if (isProfilingEnabled) {
+        d->profiler = new ScriptReportProfiler(d->engine);
+    } else {
+        delete d->profiler;
+        d->profiler = 0;
+    }
+}
+
+/*!
+    \fn ScriptReportProfiler* ScriptReport::profiler() const
+    Returns the profiler with the measures of the last run, or 0 if the profiling is not enabled.
+    \sa isProfilingEnabled
+*/
+ScriptReportProfiler* ScriptReport::profiler() const {
+    return d->profiler;
+}
+
 /*!
     \fn TextStreamObject* ScriptReport::input() const
     Return the \c TextStreamObject that handle the input stream.
@@ -530,14 +801,38 @@ QString ScriptReport::errorMessage() const {
 /*!
     \fn void ScriptReport::updateIntermediateCode()
     Transform the report to javascript.
+
+    If the report was transformed before it is loaded from the ScriptReportCache and the
+    transformation is skipped.
     \sa ScriptReport::intermediateCode
 */
 void ScriptReport::updateIntermediateCode() {
+    QElapsedTimer timer;
+    timer.start();
     d->intermediate.clear();
-    QTextStream intermediateStream(&d->intermediate, QIODevice::WriteOnly);
 
-    SourceTransformer st(d->inStreamObject->stream(), &intermediateStream);
-    st.transform();
+    QString source = d->inStreamObject->stream()->readAll();
+    const bool isCacheEnabled = ScriptReportCache::isEnabled();
+    QString key;
+    if (isCacheEnabled) {
+        key = ScriptReportCache::key(source);
+    }
+    ScriptReportTraceSpan span("transform", "ScriptReport::updateIntermediateCode");
+    d->stats.isTransformCached = isCacheEnabled && ScriptReportCache::find(key, d->intermediate);
+    span.setArgument(QString::fromLatin1("cached"), d->stats.isTransformCached);
+    if (!d->stats.isTransformCached) {
+        QTextStream sourceStream(&source, QIODevice::ReadOnly);
+        QTextStream intermediateStream(&d->intermediate, QIODevice::WriteOnly);
+
+        SourceTransformer st(&sourceStream, &intermediateStream);
+        st.transform();
+        if (isCacheEnabled) {
+            ScriptReportCache::insert(key, d->intermediate);
+        }
+    }
+    d->stats.inputSize = source.size() * qint64(sizeof(QChar));
+    d->stats.intermediateSize = d->intermediate.size() * qint64(sizeof(QChar));
+    d->stats.transformTime = timer.nsecsElapsed();
     d->isUpdateIntermediateCodeRequired = false;
     d->isRunRequired = true;
 }
@@ -546,6 +841,9 @@ void ScriptReport::updateIntermediateCode() {
     \fn void ScriptReport::run()
     \brief Run the intermedial javascript for generate HTML sections code.
 
+    The scripts are evaluated with the ScriptReportProgramCache, so they are parsed only the
+    first time they are run in the engine.
+
     \bold Note: If \c updateIntermediateCode() or \c initEngine() is not runned they will be run.
 */
 void ScriptReport::run() {
@@ -558,19 +856,80 @@ void ScriptReport::run() {
         updateIntermediateCode();
     }
 
+    d->clearPageCache();
+    d->stats.clearOutput();
+    d->takenContentSize = 0;
+    if (d->profiler) {
+        d->profiler->clear();
+        d->profiler->start();
+    }
+    QElapsedTimer timer;
+    timer.start();
+    ScriptReportTraceSpan span("script", "ScriptReport::run");
+    span.setArgument(QString::fromLatin1("report"), d->name);
     if (!d->previousScript.isEmpty()) {
-        d->engine->evaluate(d->previousScript, QString::fromLatin1("previousScript"));
+        ScriptReportProgramCache::evaluate(d->engine, d->previousScript, QString::fromLatin1("previousScript"));
+    }
+    ScriptReportProgramCache::evaluate(d->engine, d->intermediate, d->name);
+    if (d->profiler) {
+        d->profiler->stop();
     }
-    d->engine->evaluate(d->intermediate, d->name);
 
+    // All the sections are flushed, so their sizes in the statistics are complete
     d->outHeaderStreamObject->stream()->flush();
+    d->outHeaderFirstStreamObject->stream()->flush();
+    d->outHeaderLastStreamObject->stream()->flush();
     d->outStreamObject->stream()->flush();
     d->outFooterStreamObject->stream()->flush();
+    d->outFooterFirstStreamObject->stream()->flush();
+    d->outFooterLastStreamObject->stream()->flush();
     d->printStreamObject->stream()->flush();
+    d->stats.runTime = timer.nsecsElapsed();
+    d->updateOutputStats();
 
     d->isRunRequired = false;
 }
 
+/*!
+    \fn void ScriptReport::reset()
+    \brief Clear the result of the last run, for run the report again.
+
+    The output sections, the \c print output and the resources are cleared. The script engine,
+    with its global variables and imported extensions, and the intermediate code are kept, so
+    the report is not transformed or parsed again.
+
+    \sa rerun()
+*/
+void ScriptReport::reset() {
+    d->resetOutput();
+    d->printStreamObject->reset();
+    d->engine->clearExceptions();
+    d->isRunRequired = true;
+}
+
+/*!
+    \fn void ScriptReport::rerun(QStringList arguments)
+    \brief Reset the report and run it again with the script arguments \a arguments.
+
+    This is useful for generate the same report many times with different data, like in a
+    mail merge:
+
+    \code
+    ScriptReport sr("letter.srt");
+    foreach (QString customer, customers) {
+        sr.rerun(QStringList() << customer);
+        sr.print(&printer);
+    }
+    \endcode
+
+    \sa reset() run()
+*/
+void ScriptReport::rerun(QStringList arguments) {
+    reset();
+    setArguments(arguments);
+    run();
+}
+
 /*!
     \fn void ScriptReport::print(QPrinter *printer)
     \brief Print the report with the \a printer.
@@ -587,13 +946,49 @@ void ScriptReport::print(QPrinter *printer) {
         if (!d->scriptableReport) {
             loadPrintConfiguration(printer);
         }
+        if (d->isPipelineEnabled && ScriptReportPipeline::canPrint(printer)) {
+            printPipelined(printer, printer);
+            return;
+        }
         run();
     }
 
-    d->scriptableReport->applyConfigurationTo(*printer);
+    applyConfiguration(printer, printer);
     d->scriptReportEngine->print(this, printer);
 }
 
+/*!
+    \fn void ScriptReport::render(QPagedPaintDevice *device)
+    \brief Render the report in the paged paint \a device, like a QPdfWriter.
+
+    The paper configuration of the report is applied to the \a device before render it. This
+    doesn't use widgets, it can be used with QGuiApplication and the offscreen platform:
+
+    \code
+    QPdfWriter writer("myReport.pdf");
+    ScriptReport sr("myReport.srt");
+    sr.render(&writer);
+    \endcode
+
+    \bold Note: If \c run() is not runned it will be run.
+*/
+void ScriptReport::render(QPagedPaintDevice *device) {
+    if (!device) {
+        return;
+    }
+
+    if (d->isRunRequired) {
+        if (d->isPipelineEnabled) {
+            printPipelined(device, 0);
+            return;
+        }
+        run();
+    }
+
+    applyConfiguration(device, 0);
+    d->scriptReportEngine->render(this, device);
+}
+
 /*!
     \fn void ScriptReport::loadPrintConfiguration(QPrinter *printer)
     Load the print configuration from \a printer, this configurations will be available in the \c sr.report
@@ -639,9 +1034,130 @@ void ScriptReport::initEngine() {
     QScriptValue engine = d->engine->newQObject(d->scriptableEngine, QScriptEngine::QtOwnership, QScriptEngine::ExcludeChildObjects | QScriptEngine::ExcludeSuperClassContents | QScriptEngine::ExcludeDeleteLater);
     sr.setProperty(QString::fromLatin1("engine"), engine, QScriptValue::Undeletable);
 
+    // The globals declared by the intermediate code exist before the global scope is saved for
+    // reuse the engine, so they are deletable and restored like the other globals
+    d->engine->globalObject().setProperty(QString::fromLatin1("_"), report.property(QString::fromLatin1("writeContent")));
+    d->engine->globalObject().setProperty(QString::fromLatin1("_f"), report.property(QString::fromLatin1("isFinal")));
+
     d->scriptReportEngine->initEngine(this, d->engine);
 }
 
+void ScriptReport::openInputFile(QString reportName) {
+    QFile *oldFile = d->inFile;
+    d->inFile = new QFile(reportName);
+    if (d->inFile->open( QIODevice::ReadOnly)) {
+        QTextStream *in  = new QTextStream(d->inFile);
+        d->inStreamObject->setStream(in, true);
+    } else {
+        QString error = QString::fromLatin1("<!--@ throw \"Unable to read the file '%1'\"; -->").arg(reportName);
+        d->inStreamObject->setStream(0);
+        d->inStreamObject->reset();
+        d->inStreamObject->setText(error);
+    }
+    delete oldFile;
+}
+
+void ScriptReport::saveGlobalScope() {
+    QScriptValue global = d->engine->globalObject();
+    ScriptReportPrivate::saveProperties(global, d->globalProperties);
+    ScriptReportPrivate::saveProperties(global.property(QString::fromLatin1("sr")), d->srProperties);
+    d->importedExtensions = d->engine->importedExtensions();
+}
+
+bool ScriptReport::recycle() {
+    if (d->engine->isEvaluating()) {
+        return false;
+    }
+    // The extensions imported by the report can not be imported again
+    if (d->engine->importedExtensions() != d->importedExtensions) {
+        return false;
+    }
+
+    // An engine whose scope can not be cleaned is not reused, the report is destroyed
+    QScriptValue global = d->engine->globalObject();
+    if (!ScriptReportPrivate::restoreProperties(global, d->globalProperties)
+            || !ScriptReportPrivate::restoreProperties(global.property(QString::fromLatin1("sr")), d->srProperties)) {
+        return false;
+    }
+
+    // The extensions release what the last report took from them
+    EngineRecycleHandlers *recycleHandlers = EngineRecycleHandlers::find(d->engine);
+    if (recycleHandlers) {
+        for (int i = 0; i < recycleHandlers->handlers.size(); i++) {
+            QObject *receiver = recycleHandlers->handlers.at(i).first;
+            if (receiver) {
+                QMetaObject::invokeMethod(receiver, recycleHandlers->handlers.at(i).second.constData(), Qt::DirectConnection);
+            }
+        }
+    }
+
+    d->printStreamObject->setStream(0);
+    reset();
+    if (d->scriptableEngine) {
+        d->scriptableEngine->setArguments(QStringList());
+    }
+
+    d->isPrintErrorEnabled = true;
+    d->isInEditingMode = false;
+    d->isInDebuggingMode = false;
+    d->isWriteWithPrintFunctionTooEnabled = false;
+    setProfilingEnabled(false);
+    d->previousScript.clear();
+    d->intermediate.clear();
+    d->isUpdateIntermediateCodeRequired = true;
+    return true;
+}
+
+void ScriptReport::applyConfiguration(QPagedPaintDevice *device, QPrinter *printer) {
+    if (printer) {
+        d->scriptableReport->applyConfigurationTo(*printer);
+    } else {
+        d->scriptableReport->applyConfigurationTo(*device);
+    }
+}
+
+void ScriptReport::printPipelined(QPagedPaintDevice *device, QPrinter *printer) {
+    int chunkSize = d->layoutChunkSize > 0 ? d->layoutChunkSize : int(ScriptReportPipeline::DefaultChunkSize);
+    ScriptReportTraceSpan span("paint", "ScriptReport::printPipelined");
+    span.setArgument(QString::fromLatin1("report"), d->name);
+    ScriptReportPipeline pipeline(this, device, printer, chunkSize);
+    d->pipeline = &pipeline;
+    run();
+    contentWritten();
+    d->pipeline = 0;
+    d->updateOutputStats();
+    pipeline.finish();
+    setRenderStats(pipeline.parseTime(), pipeline.layoutTime(), pipeline.paintTime(), pipeline.pageCount());
+
+    // The content was consumed by the pipeline
+    d->resetOutput();
+    d->isRunRequired = true;
+}
+
+void ScriptReport::contentWritten() {
+    if (d->pipeline) {
+        QString text = d->outStreamObject->takeText();
+        qint64 size = text.size() * qint64(sizeof(QChar));
+        d->takenContentSize += size;
+        d->stats.peakSectionSize = qMax(d->stats.peakSectionSize, size);
+        d->pipeline->append(text);
+    }
+}
+
+QString ScriptReport::takeContent() {
+    d->isContentTaken = true;
+    return d->outStreamObject->takeText();
+}
+
+bool ScriptReport::isContentTaken() const {
+    return d->isContentTaken;
+}
+
+void ScriptReport::inputChanged() {
+    d->isUpdateIntermediateCodeRequired = true;
+    d->isRunRequired = true;
+}
+
 /*!
     \fn void ScriptReport::addResource(int type, const QVariant & resource, const QUrl & url)
 
@@ -664,6 +1180,7 @@ void ScriptReport::initEngine() {
 */
 void ScriptReport::addResource(int type, const QVariant & resource, const QUrl & url) {
     d->resources.insert(url, ScriptReportResourcePair(type, resource));
+    d->clearPageCache();
 }
 
 /*!
@@ -695,6 +1212,7 @@ QString ScriptReport::addResource(int type, const QVariant &resource, QString ur
         name = QString::fromLatin1("scriptreport://%1").arg(d->lastResourceIndex);
     }
     d->resources.insert(QUrl(name), ScriptReportResourcePair(type,resource));
+    d->clearPageCache();
     return name;
 }
 
@@ -729,3 +1247,109 @@ QString ScriptReport::addResource(int type, const QVariant &resource, QString ur
 ScriptReportResources ScriptReport::resources() const {
     return d->resources;
 }
+
+/*!
+    \fn int ScriptReport::pageCacheMaximumSize() const
+    Returns the maximum size, in bytes, of the recorded pages kept by the report. The default
+    size is 32 MB.
+
+    \sa setPageCacheMaximumSize() clearPageCache()
+*/
+int ScriptReport::pageCacheMaximumSize() const {
+    return d->pageCache.maxCost();
+}
+
+/*!
+    \fn void ScriptReport::setPageCacheMaximumSize(int maximumSize)
+    Set the maximum size, in bytes, of the recorded pages kept by the report to \a maximumSize.
+
+    Each page is recorded in a QPicture the first time it is printed, the copies, the print
+    preview and the next prints of the same output replay the recording instead of lay out the
+    HTML again. A \a maximumSize of 0 disables the cache.
+
+    \sa pageCacheMaximumSize() clearPageCache()
+*/
+void ScriptReport::setPageCacheMaximumSize(int maximumSize) {
+    d->pageCache.setMaxCost(maximumSize);
+}
+
+/*!
+    \fn void ScriptReport::clearPageCache()
+    Remove the recorded pages. The cache is cleared when the report is run or reset.
+
+    \sa setPageCacheMaximumSize()
+*/
+void ScriptReport::clearPageCache() {
+    d->clearPageCache();
+}
+
+/*!
+    \fn ScriptReportStats ScriptReport::stats() const
+    Returns the timings and the sizes of the last transformation, run and render of the report.
+    The render statistics are cleared when the report is run; a render that replays the pages
+    from the page cache has no parse and layout time.
+
+    \sa ScriptReportStats
+*/
+ScriptReportStats ScriptReport::stats() const {
+    return d->stats;
+}
+
+/*!
+    \fn void ScriptReport::addRecycleHandler(QScriptEngine *engine, QObject *receiver, const char *member)
+    Registers the method \a member of \a receiver, a slot or an invokable method without arguments,
+    to be called when the report that runs in \a engine is recycled by the ScriptReportEnginePool,
+    before the engine is used by other report. The extensions use it for release the resources taken
+    by the last report, like the pooled connections of \c srsql. The method is not called after
+    \a receiver is destroyed. This function must be called from the thread of \a engine.
+
+    \code
+    ScriptReport::addRecycleHandler(engine, myExtensionObject, "release");
+    \endcode
+*/
+void ScriptReport::addRecycleHandler(QScriptEngine *engine, QObject *receiver, const char *member) {
+    EngineRecycleHandlers *recycleHandlers = EngineRecycleHandlers::find(engine);
+    if (!recycleHandlers) {
+        recycleHandlers = new EngineRecycleHandlers(engine);
+    }
+    recycleHandlers->handlers.append(qMakePair(QPointer<QObject>(receiver), QByteArray(member)));
+}
+
+/*
+ * Private members
+ */
+
+int ScriptReport::cachedPageCount(const QSize &pageSize) const {
+    if (d->pageCacheSize != pageSize || d->pageCache.maxCost() <= 0) {
+        return -1;
+    }
+    return d->pageCachePageCount;
+}
+
+void ScriptReport::setCachedPageCount(const QSize &pageSize, int pageCount) {
+    d->usePageCacheSize(pageSize);
+    d->pageCachePageCount = pageCount;
+}
+
+QPicture ScriptReport::cachedPage(int page, const QSize &pageSize) const {
+    if (d->pageCacheSize != pageSize) {
+        return QPicture();
+    }
+    QPicture *picture = d->pageCache.object(page);
+    if (!picture) {
+        return QPicture();
+    }
+    return *picture;
+}
+
+void ScriptReport::insertCachedPage(int page, const QSize &pageSize, const QPicture &picture) {
+    d->usePageCacheSize(pageSize);
+    d->pageCache.insert(page, new QPicture(picture), picture.size());
+}
+
+void ScriptReport::setRenderStats(qint64 parseTime, qint64 layoutTime, qint64 paintTime, int pageCount) {
+    d->stats.parseTime = parseTime;
+    d->stats.layoutTime = layoutTime;
+    d->stats.paintTime = paintTime;
+    d->stats.pageCount = pageCount;
+}
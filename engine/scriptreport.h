@@ -21,6 +21,7 @@
 #define SCRIPTREPORT_H
 
 #include "scriptreportengine_global.h"
+#include "scriptreportstats.h"
 
 #include <QObject>
 #include <QStringList>
@@ -29,13 +30,17 @@
 #include <QVariant>
 
 class QPrinter;
+class QPagedPaintDevice;
 class QScriptEngine;
 class QTextStream;
 
 class TextStreamObject;
 class ScriptReportEngine;
+class ScriptReportProfiler;
 
 class QPixmap;
+class QPicture;
+class QSize;
 
 class ScriptReportPrivate;
 
@@ -56,6 +61,9 @@ class SCRIPTREPORTENGINE_EXPORT ScriptReport : public QObject
     Q_PROPERTY(QString previousScript READ previousScript WRITE setPreviousScript)
     Q_PROPERTY(QString reportName READ reportName WRITE setReportName)
     Q_PROPERTY(bool isWriteWithPrintFunctionTooEnabled READ isWriteWithPrintFunctionTooEnabled WRITE setWriteWithPrintFunctionTooEnabled)
+    Q_PROPERTY(int layoutChunkSize READ layoutChunkSize WRITE setLayoutChunkSize)
+    Q_PROPERTY(bool isPipelineEnabled READ isPipelineEnabled WRITE setPipelineEnabled)
+    Q_PROPERTY(bool isProfilingEnabled READ isProfilingEnabled WRITE setProfilingEnabled)
 
     Q_PROPERTY(QString intermediateCode READ intermediateCode)
     Q_PROPERTY(bool hasUncaughtException READ hasUncaughtException)
@@ -90,6 +98,14 @@ public:
     bool isWriteWithPrintFunctionTooEnabled() const;
     void setWriteWithPrintFunctionTooEnabled(bool isWriteWithPrintFunctionTooEnabled);
 
+    int layoutChunkSize() const;
+    void setLayoutChunkSize(int layoutChunkSize);
+    bool isPipelineEnabled() const;
+    void setPipelineEnabled(bool isPipelineEnabled);
+    bool isProfilingEnabled() const;
+    void setProfilingEnabled(bool isProfilingEnabled);
+    ScriptReportProfiler* profiler() const;
+
     TextStreamObject* input() const;
     const TextStreamObject* outputHeader() const;
     const TextStreamObject* outputHeaderFirst() const;
@@ -115,14 +131,50 @@ public:
     void addResource(int type, const QVariant & resource, const QUrl & url);
     ScriptReportResources resources() const;
 
+    int pageCacheMaximumSize() const;
+    void setPageCacheMaximumSize(int maximumSize);
+    void clearPageCache();
+
+    ScriptReportStats stats() const;
+
+    static void addRecycleHandler(QScriptEngine *engine, QObject *receiver, const char *member);
+
 public slots:
     void updateIntermediateCode();
     void run();
+    void reset();
+    void rerun(QStringList arguments);
     void print(QPrinter *printer);
+    void render(QPagedPaintDevice *device);
 
 protected:
     void initEngine();
 
+private slots:
+    void inputChanged();
+
+private:
+    friend class ScriptReportEnginePool;
+    friend class ScriptReportEnginePrivate;
+    friend class ScriptReportPageLayout;
+    friend class ScriptReportPipeline;
+    friend class ScriptableReport;
+    void openInputFile(QString reportName);
+    void saveGlobalScope();
+    bool recycle();
+
+    int cachedPageCount(const QSize &pageSize) const;
+    void setCachedPageCount(const QSize &pageSize, int pageCount);
+    QPicture cachedPage(int page, const QSize &pageSize) const;
+    void insertCachedPage(int page, const QSize &pageSize, const QPicture &picture);
+    void setRenderStats(qint64 parseTime, qint64 layoutTime, qint64 paintTime, int pageCount);
+
+    void applyConfiguration(QPagedPaintDevice *device, QPrinter *printer);
+    void printPipelined(QPagedPaintDevice *device, QPrinter *printer);
+    void contentWritten();
+    QString takeContent();
+    bool isContentTaken() const;
+
 private:
     ScriptReportPrivate *d;
 };
@@ -0,0 +1,301 @@
+/*
+ * Copyright 2010 and beyond, Juan Luis Paz
+ *
+ * This file is part of Script Report.
+ *
+ * Script Report is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Script Report is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with Script Report.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "scriptreportcache.h"
+
+#include <algorithm>
+
+#include <QAtomicInt>
+#include <QCryptographicHash>
+#include <QDateTime>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QMutex>
+#include <QMutexLocker>
+#include <QSaveFile>
+#include <QStandardPaths>
+
+#include "sourcetransformer.h"
+
+class ScriptReportCachePrivate {
+public:
+    ScriptReportCachePrivate() :
+            isEnabled(false),
+            maximumSize(64 * 1024 * 1024),
+            size(-1)
+    {
+        directory = QStandardPaths::writableLocation(QStandardPaths::CacheLocation);
+        if (directory.isEmpty()) {
+            directory = QDir::tempPath() + QString::fromLatin1("/scriptreport");
+        }
+        directory.append(QString::fromLatin1("/intermediate"));
+    }
+
+    QString fileName(const QString &key) const {
+        return directory + QLatin1Char('/') + key + QString::fromLatin1(".js");
+    }
+
+    qint64 scan(QFileInfoList &files) const;
+    void evict();
+
+    QMutex mutex;
+    bool isEnabled;
+    QString directory;
+    qint64 maximumSize;
+    // The size of the files in the directory, -1 until it is scanned
+    qint64 size;
+
+    QAtomicInt hits;
+    QAtomicInt misses;
+};
+
+Q_GLOBAL_STATIC(ScriptReportCachePrivate, cache)
+
+static bool olderFirst(const QFileInfo &a, const QFileInfo &b) {
+    return a.lastModified() < b.lastModified();
+}
+
+qint64 ScriptReportCachePrivate::scan(QFileInfoList &files) const {
+    files = QDir(directory).entryInfoList(QStringList(QString::fromLatin1("*.js")), QDir::Files);
+    qint64 result = 0;
+    foreach (const QFileInfo &file, files) {
+        result += file.size();
+    }
+    return result;
+}
+
+void ScriptReportCachePrivate::evict() {
+    // The directory is only listed when the size kept in memory is over the maximum, the files
+    // written by other processes are counted then
+    if (size >= 0 && size <= maximumSize) {
+        return;
+    }
+    QFileInfoList files;
+    size = scan(files);
+    if (size <= maximumSize) {
+        return;
+    }
+
+    // Remove the oldest files until the cache is under its maximum size
+    QDir dir(directory);
+    std::sort(files.begin(), files.end(), olderFirst);
+    foreach (const QFileInfo &file, files) {
+        if (size <= maximumSize) {
+            break;
+        }
+        if (dir.remove(file.fileName())) {
+            size -= file.size();
+        }
+    }
+}
+
+/*!
+    \class ScriptReportCache
+    \brief Class for cache the reports transformed to javascript.
+
+    The ScriptReportCache class keep on disk the intermediate javascript code generated by the
+    SourceTransformer, ScriptReport::updateIntermediateCode() use it for skip the transformation
+    when the same report was transformed before, even by other process.
+
+    Each intermediate code is stored in its own file in the cache directory, the file name is
+    the key of the report, a hash of the report source and the SourceTransformer::version(). The
+    files are written atomically, and the oldest files are removed when the size of the cache
+    is greater than maximumSize().
+
+    The cache is shared by all the reports in the process, all the functions are thread-safe.
+    It is disabled by default, so the reports don't write in the cache directory of the user
+    unless the application asks for it; scriptreporttool, scriptreportd and the
+    ScriptReportEnginePool enable it.
+
+    The size of the cache is kept in memory, the directory is only listed the first time and
+    when the size is over maximumSize().
+*/
+
+/*!
+    \fn bool ScriptReportCache::isEnabled()
+    Returns true if the cache is used by the reports. The cache is disabled by default.
+*/
+bool ScriptReportCache::isEnabled() {
+    QMutexLocker locker(&cache()->mutex);
+    return cache()->isEnabled;
+}
+
+/*!
+    \fn void ScriptReportCache::setEnabled(bool enabled)
+    Enable or disable the cache according to \a enabled.
+*/
+void ScriptReportCache::setEnabled(bool enabled) {
+    QMutexLocker locker(&cache()->mutex);
+    cache()->isEnabled = enabled;
+}
+
+/*!
+    \fn QString ScriptReportCache::directory()
+    Returns the directory where the intermediate code is stored, by default is the
+    \c intermediate subdirectory of the application cache location.
+*/
+QString ScriptReportCache::directory() {
+    QMutexLocker locker(&cache()->mutex);
+    return cache()->directory;
+}
+
+/*!
+    \fn void ScriptReportCache::setDirectory(const QString &directory)
+    Set the directory where the intermediate code is stored to \a directory, it is created when
+    it is needed.
+*/
+void ScriptReportCache::setDirectory(const QString &directory) {
+    QMutexLocker locker(&cache()->mutex);
+    cache()->directory = QDir::cleanPath(directory);
+    cache()->size = -1;
+}
+
+/*!
+    \fn qint64 ScriptReportCache::maximumSize()
+    Returns the maximum size in bytes of the files in the cache directory, by default 64 MB.
+*/
+qint64 ScriptReportCache::maximumSize() {
+    QMutexLocker locker(&cache()->mutex);
+    return cache()->maximumSize;
+}
+
+/*!
+    \fn void ScriptReportCache::setMaximumSize(qint64 maximumSize)
+    Set the maximum size in bytes of the files in the cache directory to \a maximumSize.
+*/
+void ScriptReportCache::setMaximumSize(qint64 maximumSize) {
+    QMutexLocker locker(&cache()->mutex);
+    cache()->maximumSize = maximumSize;
+}
+
+/*!
+    \fn QString ScriptReportCache::key(const QString &source)
+    Returns the key of the report with the source \a source, it changes when the report or the
+    SourceTransformer version changes.
+*/
+QString ScriptReportCache::key(const QString &source) {
+    QCryptographicHash hash(QCryptographicHash::Sha1);
+    hash.addData(QByteArray::number(SourceTransformer::version()));
+    hash.addData(QByteArray(1, '\n'));
+    hash.addData(source.toUtf8());
+    return QString::fromLatin1(hash.result().toHex());
+}
+
+/*!
+    \fn bool ScriptReportCache::find(const QString &key, QString &intermediateCode)
+    Look for the report with the key \a key, returns true and set \a intermediateCode if it is
+    found; otherwise returns false. The hits and misses counters are updated.
+*/
+bool ScriptReportCache::find(const QString &key, QString &intermediateCode) {
+    ScriptReportCachePrivate *c = cache();
+    QString fileName;
+    {
+        QMutexLocker locker(&c->mutex);
+        if (!c->isEnabled) {
+            return false;
+        }
+        fileName = c->fileName(key);
+    }
+
+    QFile file(fileName);
+    if (!file.open(QIODevice::ReadOnly)) {
+        c->misses.ref();
+        return false;
+    }
+    intermediateCode = QString::fromUtf8(file.readAll());
+    c->hits.ref();
+    return true;
+}
+
+/*!
+    \fn bool ScriptReportCache::insert(const QString &key, const QString &intermediateCode)
+    Store \a intermediateCode with the key \a key in the cache, returns true if it was stored.
+    The file is written with a temporary name and renamed when it is complete, so other
+    processes never read a partial file.
+*/
+bool ScriptReportCache::insert(const QString &key, const QString &intermediateCode) {
+    ScriptReportCachePrivate *c = cache();
+    QMutexLocker locker(&c->mutex);
+    if (!c->isEnabled) {
+        return false;
+    }
+    if (!QDir().mkpath(c->directory)) {
+        return false;
+    }
+
+    const QString fileName = c->fileName(key);
+    const qint64 oldSize = QFileInfo(fileName).exists() ? QFileInfo(fileName).size() : 0;
+    const QByteArray data = intermediateCode.toUtf8();
+    QSaveFile file(fileName);
+    if (!file.open(QIODevice::WriteOnly)) {
+        return false;
+    }
+    file.write(data);
+    if (!file.commit()) {
+        return false;
+    }
+
+    if (c->size >= 0) {
+        c->size += data.size() - oldSize;
+    }
+    c->evict();
+    return true;
+}
+
+/*!
+    \fn void ScriptReportCache::clear()
+    Remove all the files in the cache directory.
+*/
+void ScriptReportCache::clear() {
+    ScriptReportCachePrivate *c = cache();
+    QMutexLocker locker(&c->mutex);
+    QDir dir(c->directory);
+    foreach (const QString &fileName, dir.entryList(QStringList(QString::fromLatin1("*.js")), QDir::Files)) {
+        dir.remove(fileName);
+    }
+    c->size = 0;
+}
+
+/*!
+    \fn int ScriptReportCache::hits()
+    Returns the number of reports found in the cache since the start of the process or the last
+    call to resetCounters().
+*/
+int ScriptReportCache::hits() {
+    return cache()->hits.load();
+}
+
+/*!
+    \fn int ScriptReportCache::misses()
+    Returns the number of reports not found in the cache since the start of the process or the
+    last call to resetCounters().
+*/
+int ScriptReportCache::misses() {
+    return cache()->misses.load();
+}
+
+/*!
+    \fn void ScriptReportCache::resetCounters()
+    Set the hits and misses counters to zero.
+*/
+void ScriptReportCache::resetCounters() {
+    cache()->hits.store(0);
+    cache()->misses.store(0);
+}
@@ -0,0 +1,50 @@
+/*
+ * Copyright 2010 and beyond, Juan Luis Paz
+ *
+ * This file is part of Script Report.
+ *
+ * Script Report is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Script Report is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with Script Report.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef SCRIPTREPORTCACHE_H
+#define SCRIPTREPORTCACHE_H
+
+#include "scriptreportengine_global.h"
+
+#include <QString>
+
+class SCRIPTREPORTENGINE_EXPORT ScriptReportCache
+{
+public:
+    static bool isEnabled();
+    static void setEnabled(bool enabled);
+    static QString directory();
+    static void setDirectory(const QString &directory);
+    static qint64 maximumSize();
+    static void setMaximumSize(qint64 maximumSize);
+
+    static QString key(const QString &source);
+    static bool find(const QString &key, QString &intermediateCode);
+    static bool insert(const QString &key, const QString &intermediateCode);
+    static void clear();
+
+    static int hits();
+    static int misses();
+    static void resetCounters();
+
+private:
+    ScriptReportCache();
+};
+
+#endif // SCRIPTREPORTCACHE_H
@@ -22,7 +22,13 @@
 #include <QTextStream>
 #include <QTextDocument>
 #include <QPainter>
+#include <QPicture>
+#include <QPagedPaintDevice>
 #include <QScriptEngine>
+#include <QScopedPointer>
+#include <QElapsedTimer>
+
+#include <limits>
 
 #if QT_VERSION >= 0x050000
 #include <QtPrintSupport/QPrinter>
@@ -30,11 +36,22 @@
 #include <QPrinter>
 #endif
 
+#include "scriptreportpagelayout.h"
+#include "scriptreporttracer.h"
 #include "sourcetransformer.h"
 #include "textstreamobject.h"
 
 class ScriptReportEnginePrivate {
-    // Nothing here at this momment
+public:
+    void paint(ScriptReport *scriptReport, QPagedPaintDevice *device, QPrinter *printer);
+
+    // A chunked layout consumes the content, the report is run again for lay out it again
+    static void rerunTakenContent(ScriptReport *scriptReport) {
+        if (scriptReport->isContentTaken()) {
+            scriptReport->reset();
+            scriptReport->run();
+        }
+    }
 };
 
 /*!
@@ -90,122 +107,83 @@ void ScriptReportEngine::loadPrintConfiguration(ScriptReport */*scriptReport*/,
     \brief Print the script report \a scriptReport with the \a printer.
 */
 void ScriptReportEngine::print(ScriptReport *scriptReport, QPrinter *printer) {
+    d->paint(scriptReport, printer, printer);
+}
+
+/*!
+    \fn ScriptReportEngine::render(ScriptReport *scriptReport, QPagedPaintDevice *device)
+    \brief Render the script report \a scriptReport in the paged paint \a device.
+
+    All the pages of the report are rendered once, in the page size of the \a device, like a
+    QPdfWriter. No printer or print dialog is used, so it works without widgets.
+*/
+void ScriptReportEngine::render(ScriptReport *scriptReport, QPagedPaintDevice *device) {
+    d->paint(scriptReport, device, 0);
+}
+
+/*
+ * Private members
+ */
+
+void ScriptReportEnginePrivate::paint(ScriptReport *scriptReport, QPagedPaintDevice *device, QPrinter *printer) {
     // Based on the code published by "Prashant Shah" on October 29, 2008 in the KDE mailing list
     // See: http://lists.kde.org/?l=kde-devel&m=122529598606039&w=2
     // Based on the code of the Qt 4.6 QTextDocument print method
 
-    QPainter painter(printer);
+    QElapsedTimer timer;
+    timer.start();
+    ScriptReportTraceSpan span("paint", "ScriptReport::print");
+    span.setArgument(QString::fromLatin1("report"), scriptReport->reportName());
+
+    QPainter painter(device);
     // Check that there is a valid device to print to.
     if (!painter.isActive()) {
         return;
      }
 
-    QRect printerRect(printer->pageRect());
-
-    QString pageName = QString::fromLatin1("##page##");
-    QString pageCountName = QString::fromLatin1("##pageCount##");
-
-    QString headerTemplate = scriptReport->outputHeader()->text();
-    QString headerFirstTemplate = scriptReport->outputHeaderFirst()->text();
-    QString headerLastTemplate = scriptReport->outputHeaderLast()->text();
-    bool headerHasPage = headerTemplate.contains(pageName);
-    bool headerHasPageCount = headerTemplate.contains(pageCountName);
-    QString contentTemplate = scriptReport->outputContent()->text();
-    bool contentHasPage = contentTemplate.contains(pageName);
-    bool contentHasPageCount = contentTemplate.contains(pageCountName);
-    QString footerTemplate = scriptReport->outputFooter()->text();
-    QString footerFirstTemplate = scriptReport->outputFooterFirst()->text();
-    QString footerLastTemplate = scriptReport->outputFooterLast()->text();
-    bool footerHasPage = footerTemplate.contains(pageName);
-    bool footerHasPageCount = footerTemplate.contains(pageCountName);
-
-    QTextDocument documentHeader;
-    QTextDocument documentFooter;
-    QTextDocument mainDocument;
-
-    QMapIterator<QUrl, ScriptReportResourcePair> resourcesIterator(scriptReport->resources());
-    while (resourcesIterator.hasNext()) {
-         resourcesIterator.next();
-         documentHeader.addResource(resourcesIterator.value().first, resourcesIterator.key(), resourcesIterator.value().second);
-         documentFooter.addResource(resourcesIterator.value().first, resourcesIterator.key(), resourcesIterator.value().second);
-         mainDocument.addResource(resourcesIterator.value().first, resourcesIterator.key(), resourcesIterator.value().second);
-     }
-
-
-
-    // Setting up the header and calculating the header size
-    documentHeader.setPageSize(printerRect.size());
-    QSizeF headerSize = QSize(0,0);
-    foreach ( QString t, QStringList()<<headerFirstTemplate<<headerLastTemplate<<headerTemplate )
-    {
-        documentHeader.setHtml(t);
-        if ( documentHeader.size().height() > headerSize.height() ) {
-            headerSize = documentHeader.size();
+    qreal scale;
+    QRect printerRect = ScriptReportPageLayout::pageRect(device, printer, &scale);
+    QSize pageSize = printerRect.size();
+
+    // The pages are recorded once in the page cache of the report and replayed for each copy, the
+    // documents are only parsed and laid out when a page is not in the cache. In a chunked layout
+    // the page count is only calculated before print if it is needed.
+    bool isLastPageFirst = printer && printer->pageOrder() == QPrinter::LastPageFirst;
+    QScopedPointer<ScriptReportPageLayout> layout;
+    int pageCount = scriptReport->cachedPageCount(pageSize);
+    if (pageCount < 0) {
+        rerunTakenContent(scriptReport);
+        layout.reset(new ScriptReportPageLayout(scriptReport, pageSize, scriptReport->layoutChunkSize()));
+        pageCount = layout->knownPageCount();
+        if (pageCount < 0 && isLastPageFirst) {
+            pageCount = layout->pageCount();
+        }
+        if (pageCount >= 0) {
+            scriptReport->setCachedPageCount(pageSize, pageCount);
         }
     }
 
-    // Setting up the footer and calculating the footer size
-    documentFooter.setPageSize(printerRect.size());
-    QSizeF footerSize = QSize(0,0);
-    foreach ( QString t, QStringList()<<footerFirstTemplate<<footerLastTemplate<<footerTemplate )
-    {
-        documentFooter.setHtml(t);
-        if ( documentFooter.size().height() > footerSize.height() ) {
-            footerSize = documentFooter.size();
+    int docCopies = 1;
+    int pageCopies = 1;
+    int fromPage = 0;
+    int toPage = 0;
+    bool ascending = true;
+
+    if (printer) {
+        bool collate = printer->collateCopies();
+        if (collate){
+            pageCopies = printer->numCopies();
+        } else {
+            docCopies = printer->numCopies();
         }
-    }
 
-    // Calculating the main document size for one page
-    QSizeF centerSize(printerRect.width(),
-                      printer->pageRect().height() -
-                         headerSize.toSize().height() -
-                         footerSize.toSize().height());
-
-    // Setting up the center page
-    mainDocument.setHtml(contentTemplate);
-    mainDocument.setPageSize(centerSize);
-
-    int pageCount = mainDocument.pageCount();
-    QString pageCountText = QString::number(pageCount);
-    if (headerHasPageCount) {
-        headerTemplate.replace(pageCountName, pageCountText);
-        documentHeader.setHtml(headerTemplate);
-    }
-    headerFirstTemplate.replace(pageCountName, pageCountText);
-    headerLastTemplate.replace(pageCountName, pageCountText);
-    if (contentHasPageCount) {
-        contentTemplate.replace(pageCountName, pageCountText);
-        mainDocument.setHtml(contentTemplate);
-    }
-    if (footerHasPageCount) {
-        footerTemplate.replace(pageCountName, pageCountText);
-        documentFooter.setHtml(footerTemplate);
-    }
-    footerFirstTemplate.replace(pageCountName, pageCountText);
-    footerLastTemplate.replace(pageCountName, pageCountText);
-
-    // Setting up the rectangles for each section.
-    QRect headerRect  = QRect(QPoint(0,0), documentHeader.size().toSize());
-    QRect footerRect  = QRect(QPoint(0,0), documentFooter.size().toSize());
-
-    int docCopies;
-    int pageCopies;
-    bool collate = printer->collateCopies();
-    if (collate){
-        docCopies = 1;
-        pageCopies = printer->numCopies();
-    } else {
-        docCopies = printer->numCopies();
-        pageCopies = 1;
+        fromPage = printer->fromPage();
+        toPage = printer->toPage();
     }
 
-    int fromPage = printer->fromPage();
-    int toPage = printer->toPage();
-    bool ascending = true;
-
     if (fromPage == 0 && toPage == 0) {
         fromPage = 1;
-        toPage = pageCount;
+        toPage = pageCount >= 0 ? pageCount : std::numeric_limits<int>::max();
     }
 
     if (toPage < fromPage) {
@@ -214,7 +192,7 @@ void ScriptReportEngine::print(ScriptReport *scriptReport, QPrinter *printer) {
         return;
     }
 
-    if (printer->pageOrder() == QPrinter::LastPageFirst) {
+    if (isLastPageFirst) {
         int tmp = fromPage;
         fromPage = toPage;
         toPage = tmp;
@@ -222,79 +200,47 @@ void ScriptReportEngine::print(ScriptReport *scriptReport, QPrinter *printer) {
     }
 
     for (int i = 0; i < docCopies; ++i) {
-        // Main content rectangle.
-        // Current main content rectangle.
-        QRect currentRect = QRect(QPoint(0,0), centerSize.toSize());
         int currentPage = fromPage;
 
         forever {
-            QString page = QString::number(currentPage);
-
-            if (contentHasPage) {
-                QString content = QString(contentTemplate).replace(pageName, page);
-                mainDocument.setHtml(content);
-            }
-
-            if (currentPage == 1 && footerFirstTemplate.isNull() ==false ) {
-                if( footerFirstTemplate.isNull() ==false ) {
-                    QString html = QString(footerFirstTemplate).replace(pageName, page);
-                    documentFooter.setHtml(html);
+            QPicture picture = scriptReport->cachedPage(currentPage, pageSize);
+            if (picture.isNull()) {
+                if (!layout) {
+                    rerunTakenContent(scriptReport);
+                    layout.reset(new ScriptReportPageLayout(scriptReport, pageSize, scriptReport->layoutChunkSize()));
                 }
-                if( headerFirstTemplate.isNull() ==false ) {
-                    QString html = QString(headerFirstTemplate).replace(pageName, page);
-                    documentHeader.setHtml(html);
-                }
-            }else if (currentPage >= pageCount ) {
-
-                if( footerLastTemplate.isNull() ==false ) {
-                    QString html = QString(footerLastTemplate).replace(pageName, page);
-                    documentFooter.setHtml(html);
-                }
-                if( headerLastTemplate.isNull() ==false ) {
-                    QString html = QString(headerLastTemplate).replace(pageName, page);
-                    documentHeader.setHtml(html);
-                }
-            } else {
-                QString footer = QString(footerTemplate).replace(pageName, page);
-                documentFooter.setHtml(footer);
-                QString header = QString(headerTemplate).replace(pageName, page);
-                documentHeader.setHtml(header);
+                QPainter recorder(&picture);
+                layout->paintPage(recorder, currentPage);
+                recorder.end();
+                scriptReport->insertCachedPage(currentPage, pageSize, picture);
             }
 
-
-            // Move the current rectangle to the area to be printed for the current page
-            currentRect.moveTo(0, (currentPage - 1) * currentRect.height());
-
             for (int j = 0; j < pageCopies; ++j) {
-                if (printer->printerState() == QPrinter::Aborted
-                    || printer->printerState() == QPrinter::Error) {
+                if (printer && (printer->printerState() == QPrinter::Aborted
+                    || printer->printerState() == QPrinter::Error)) {
                     return;
                 }
 
                 // Resetting the painter matrix co ordinate system.
-                painter.resetMatrix();
-
-                // Applying negative translation of painter co-ordinate system by current main content rectangle top y coordinate.
-                painter.translate(0, -currentRect.y());
-                // Applying positive translation of painter co-ordinate system by header hight.
-                painter.translate(0, headerRect.height());
-                // Drawing the center content for current page.
-                mainDocument.drawContents(&painter, currentRect);
-                ///Resetting the painter matrix co ordinate system.
-                painter.resetMatrix();
-                // Drawing the header on the top of the page
-                documentHeader.drawContents(&painter, headerRect);
-                // Applying positive translation of painter co-ordinate system to draw the footer
-                painter.translate(0, headerRect.height());
-                painter.translate(0, centerSize.height());
-                documentFooter.drawContents(&painter, footerRect);
+                ScriptReportPageLayout::resetMatrix(painter, scale);
+                // Replaying the recorded page
+                painter.drawPicture(0, 0, picture);
 
                 if (j < pageCopies - 1) {
-                    printer->newPage();
+                    device->newPage();
                 }
             }
 
-            if (currentPage == toPage) {
+            // When the page count is not known the last page is the last one of the content
+            bool isLastPage = currentPage == toPage;
+            if (!isLastPage && pageCount < 0 && !layout->hasPage(currentPage + 1)) {
+                isLastPage = true;
+                pageCount = currentPage;
+                toPage = currentPage;
+                scriptReport->setCachedPageCount(pageSize, pageCount);
+            }
+
+            if (isLastPage) {
                 if (scriptReport->isPrintErrorEnabled()) {
                     QString message = scriptReport->errorMessage();
                     if (!message.isNull()) {
@@ -304,9 +250,9 @@ void ScriptReportEngine::print(ScriptReport *scriptReport, QPrinter *printer) {
                         documentError.setPlainText(message);
                         QRect errorRect  = QRect(QPoint(0,0), documentError.size().toSize());
 
-                        printer->newPage();
+                        device->newPage();
                         // Resetting the painter matrix co ordinate system.
-                        painter.resetMatrix();
+                        ScriptReportPageLayout::resetMatrix(painter, scale);
                         // Drawing the error on the top of the page
                         documentError.drawContents(&painter, errorRect);
                     }
@@ -320,13 +266,17 @@ void ScriptReportEngine::print(ScriptReport *scriptReport, QPrinter *printer) {
                 --currentPage;
             }
 
-            printer->newPage();
+            device->newPage();
         }
 
         if ( i < docCopies - 1) {
-            printer->newPage();
+            device->newPage();
         }
     }
 
+    // The rest of the time is painting, the parse and layout of the pages is done on demand
+    qint64 parseTime = layout ? layout->parseTime() : 0;
+    qint64 layoutTime = layout ? layout->layoutTime() : 0;
+    scriptReport->setRenderStats(parseTime, layoutTime, timer.nsecsElapsed() - parseTime - layoutTime, pageCount);
 }
 
@@ -26,6 +26,7 @@
 #include "scriptreport.h"
 
 class QPrinter;
+class QPagedPaintDevice;
 class QScriptEngine;
 
 class ScriptReportEnginePrivate;
@@ -39,6 +40,7 @@ public:
     virtual void loadPrintConfiguration(ScriptReport *scriptReport, QPrinter *printer);
     virtual void print(ScriptReport *scriptReport, QPrinter *printer);
     virtual void initEngine(ScriptReport *scriptReport, QScriptEngine *engine);
+    virtual void render(ScriptReport *scriptReport, QPagedPaintDevice *device);
 
 private:
     ScriptReportEnginePrivate *d;
@@ -0,0 +1,303 @@
+/*
+ * Copyright 2010 and beyond, Juan Luis Paz
+ *
+ * This file is part of Script Report.
+ *
+ * Script Report is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Script Report is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with Script Report.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "scriptreportenginepool.h"
+
+#include <QList>
+#include <QScriptEngine>
+
+#if QT_VERSION >= 0x050000
+#include <QtPrintSupport/QPrinter>
+#else
+#include <QPrinter>
+#endif
+
+#include "scriptreport.h"
+#include "scriptreporttracer.h"
+#include "textstreamobject.h"
+
+class ScriptReportEnginePoolPrivate {
+public:
+    ScriptReportEnginePoolPrivate(int poolMaximumSize, QStringList poolExtensions) :
+            maximumSize(poolMaximumSize),
+            extensions(poolExtensions),
+            printer(0)
+    {
+    }
+
+    ~ScriptReportEnginePoolPrivate() {
+        delete printer;
+    }
+
+    int maximumSize;
+    QStringList extensions;
+    QString initScript;
+    QList<ScriptReport*> idle;
+    // The print configuration loaded in the reports, it is created only once
+    QPrinter *printer;
+};
+
+/*!
+    \class ScriptReportEnginePool
+    \brief Class for reuse the script engines of the reports.
+
+    The ScriptReportEnginePool class keep a set of ScriptReport objects whose script engine is
+    already initialized: the \c sr object, the \c print function and the chosen extensions (like
+    \c srsql or \c sri18n) are installed in the engine. Acquire a report from the pool avoid the
+    creation and initialization of the engine, and the parsed scripts are reused by the
+    ScriptReportProgramCache.
+
+    \code
+    ScriptReportEnginePool pool(4, QStringList() << "srsql");
+    ScriptReport *sr = pool.acquire("myReport.srt");
+    sr->print(&printer);
+    pool.release(sr);
+    \endcode
+
+    When a report is acquired its global scope is clean: the properties added by the last report
+    to the global object or to the \c sr object are removed and the changed ones are restored,
+    its output sections, resources, arguments and print configuration are empty. An engine where
+    the last report imported a new extension is not reused, because the extension can not be
+    imported again. The top-level \c var and \c function declarations of a report are not
+    deletable in QtScript, they are set to \c undefined and kept, so the next report sees them
+    declared but without value. Neither is an engine reused when a property can not be restored,
+    like a read only property that the report changed.
+
+    Only the own properties of the global object and of the \c sr object are restored. The
+    changes made by a report to the built-in objects and to their prototypes, like a function
+    added to \c Array.prototype, persist in the engine for the next reports. The extensions
+    release what the last report took from them, like the pooled connections of \c srsql, in the
+    handlers registered with ScriptReport::addRecycleHandler().
+
+    The acquired reports are children of the pool. The pool and its reports must be used in the
+    same thread, use a pool for each thread.
+
+    The ScriptReportCache is not enabled by the pool, the applications that run the same reports
+    many times, like a server, should enable it.
+*/
+
+/*!
+    \fn ScriptReportEnginePool::ScriptReportEnginePool(QObject *parent)
+    Constructs a Script Report Engine Pool with parent object \a parent, it keeps up to four idle
+    engines without extensions.
+*/
+ScriptReportEnginePool::ScriptReportEnginePool(QObject *parent) :
+        QObject(parent),
+        d(new ScriptReportEnginePoolPrivate(4, QStringList()))
+{
+}
+
+/*!
+    \fn ScriptReportEnginePool::ScriptReportEnginePool(int maximumSize, QStringList extensions, QObject *parent)
+    Constructs a Script Report Engine Pool with parent object \a parent, it keeps up to
+    \a maximumSize idle engines with the \a extensions imported.
+*/
+ScriptReportEnginePool::ScriptReportEnginePool(int maximumSize, QStringList extensions, QObject *parent) :
+        QObject(parent),
+        d(new ScriptReportEnginePoolPrivate(maximumSize, extensions))
+{
+}
+
+/*!
+    \fn ScriptReportEnginePool::~ScriptReportEnginePool()
+    Destroy the Script Report Engine Pool and all its reports, including the acquired ones.
+*/
+ScriptReportEnginePool::~ScriptReportEnginePool() {
+    clear();
+    delete d;
+}
+
+/*!
+    \property ScriptReportEnginePool::maximumSize
+    \brief Specifies the maximum number of idle engines kept by the pool.
+
+    This property's default is 4.
+*/
+int ScriptReportEnginePool::maximumSize() const {
+    return d->maximumSize;
+}
+
+void ScriptReportEnginePool::setMaximumSize(int maximumSize) {
+    d->maximumSize = maximumSize;
+    while (d->idle.size() > d->maximumSize) {
+        delete d->idle.takeLast();
+    }
+}
+
+/*!
+    \property ScriptReportEnginePool::extensions
+    \brief Specifies the extensions imported in the engines when they are created.
+
+    Changing the extensions destroy the idle engines.
+*/
+QStringList ScriptReportEnginePool::extensions() const {
+    return d->extensions;
+}
+
+void ScriptReportEnginePool::setExtensions(QStringList extensions) {
+    if (d->extensions == extensions) {
+        return;
+    }
+    d->extensions = extensions;
+    clear();
+}
+
+/*!
+    \property ScriptReportEnginePool::initScript
+    \brief Specifies a script evaluated once in the engines when they are created.
+
+    The script is evaluated after the extensions are imported, the global variables and
+    functions that it defines are kept in the engine for all the reports, like loaded translations
+    or shared configuration. Changing the script destroy the idle engines.
+*/
+QString ScriptReportEnginePool::initScript() const {
+    return d->initScript;
+}
+
+void ScriptReportEnginePool::setInitScript(QString initScript) {
+    if (d->initScript == initScript) {
+        return;
+    }
+    d->initScript = initScript;
+    clear();
+}
+
+/*!
+    \property ScriptReportEnginePool::idleCount
+    \brief The number of initialized engines ready to be acquired.
+*/
+int ScriptReportEnginePool::idleCount() const {
+    return d->idle.size();
+}
+
+/*!
+    \fn void ScriptReportEnginePool::warmUp(int count)
+    Create and initialize engines until there are \a count idle engines, without exceed the
+    maximum size.
+*/
+void ScriptReportEnginePool::warmUp(int count) {
+    const int size = qMin(count, d->maximumSize);
+    while (d->idle.size() < size) {
+        d->idle.append(create());
+    }
+}
+
+/*!
+    \fn void ScriptReportEnginePool::clear()
+    Destroy the idle engines.
+*/
+void ScriptReportEnginePool::clear() {
+    qDeleteAll(d->idle);
+    d->idle.clear();
+}
+
+/*!
+    \fn ScriptReport* ScriptReportEnginePool::acquire(QString reportName)
+    Returns a report with an initialized engine that will load the report with name
+    \a reportName.
+*/
+ScriptReport* ScriptReportEnginePool::acquire(QString reportName) {
+    ScriptReport *scriptReport = take(reportName);
+    scriptReport->openInputFile(reportName);
+    return scriptReport;
+}
+
+/*!
+    \fn ScriptReport* ScriptReportEnginePool::acquire(QTextStream *inputStream, QString reportName)
+    Returns a report with an initialized engine that will read the report from \a inputStream,
+    with the report name \a reportName.
+*/
+ScriptReport* ScriptReportEnginePool::acquire(QTextStream *inputStream, QString reportName) {
+    ScriptReport *scriptReport = take(reportName);
+    scriptReport->input()->setStream(inputStream);
+    return scriptReport;
+}
+
+/*!
+    \fn ScriptReport* ScriptReportEnginePool::acquire(QString input, QString reportName)
+    Returns a report with an initialized engine that will read the script from \a input, with
+    the report name \a reportName.
+*/
+ScriptReport* ScriptReportEnginePool::acquire(QString input, QString reportName) {
+    ScriptReport *scriptReport = take(reportName);
+    TextStreamObject *in = scriptReport->input();
+    in->setStream(0);
+    in->reset();
+    in->setText(input);
+    return scriptReport;
+}
+
+/*!
+    \fn void ScriptReportEnginePool::release(ScriptReport *scriptReport)
+    Return the \a scriptReport acquired from this pool, its engine is cleaned and kept for the
+    next acquisition, or destroyed if it can not be reused or the pool is full.
+*/
+void ScriptReportEnginePool::release(ScriptReport *scriptReport) {
+    if (!scriptReport) {
+        return;
+    }
+    if (d->idle.size() >= d->maximumSize || scriptReport->parent() != this || !scriptReport->recycle()) {
+        delete scriptReport;
+        return;
+    }
+    d->idle.append(scriptReport);
+}
+
+ScriptReport* ScriptReportEnginePool::create() {
+    if (!d->printer) {
+        d->printer = new QPrinter;
+    }
+
+    ScriptReport *scriptReport = new ScriptReport(this);
+    // Load the print configuration before the engine initialization, it avoids to create a
+    // printer for each engine
+    scriptReport->loadPrintConfiguration(d->printer);
+    QScriptEngine *engine = scriptReport->scriptEngine();
+    foreach (const QString &extension, d->extensions) {
+        ScriptReportTraceSpan span("extension", "importExtension");
+        span.setArgument(QString::fromLatin1("name"), extension);
+        engine->importExtension(extension);
+        if (engine->hasUncaughtException()) {
+            qWarning("ScriptReportEnginePool: unable to import the extension %s", qPrintable(extension));
+            engine->clearExceptions();
+        }
+    }
+    if (!d->initScript.isEmpty()) {
+        engine->evaluate(d->initScript, QString::fromLatin1("initScript"));
+        if (engine->hasUncaughtException()) {
+            qWarning("ScriptReportEnginePool: error in the init script: %s", qPrintable(engine->uncaughtException().toString()));
+            engine->clearExceptions();
+        }
+    }
+    scriptReport->saveGlobalScope();
+    return scriptReport;
+}
+
+ScriptReport* ScriptReportEnginePool::take(QString reportName) {
+    ScriptReport *scriptReport;
+    if (d->idle.isEmpty()) {
+        scriptReport = create();
+    } else {
+        scriptReport = d->idle.takeLast();
+    }
+
+    scriptReport->setReportName(reportName);
+    scriptReport->loadPrintConfiguration(d->printer);
+    return scriptReport;
+}
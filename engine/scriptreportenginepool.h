@@ -0,0 +1,70 @@
+/*
+ * Copyright 2010 and beyond, Juan Luis Paz
+ *
+ * This file is part of Script Report.
+ *
+ * Script Report is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Script Report is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with Script Report.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef SCRIPTREPORTENGINEPOOL_H
+#define SCRIPTREPORTENGINEPOOL_H
+
+#include "scriptreportengine_global.h"
+
+#include <QObject>
+#include <QStringList>
+
+class QTextStream;
+
+class ScriptReport;
+
+class ScriptReportEnginePoolPrivate;
+
+class SCRIPTREPORTENGINE_EXPORT ScriptReportEnginePool : public QObject
+{
+    Q_OBJECT
+    Q_PROPERTY(int maximumSize READ maximumSize WRITE setMaximumSize)
+    Q_PROPERTY(QStringList extensions READ extensions WRITE setExtensions)
+    Q_PROPERTY(QString initScript READ initScript WRITE setInitScript)
+    Q_PROPERTY(int idleCount READ idleCount)
+
+public:
+    explicit ScriptReportEnginePool(QObject *parent = 0);
+    ScriptReportEnginePool(int maximumSize, QStringList extensions, QObject *parent = 0);
+    ~ScriptReportEnginePool();
+
+    int maximumSize() const;
+    void setMaximumSize(int maximumSize);
+    QStringList extensions() const;
+    void setExtensions(QStringList extensions);
+    QString initScript() const;
+    void setInitScript(QString initScript);
+    int idleCount() const;
+
+    void warmUp(int count);
+    void clear();
+
+    ScriptReport* acquire(QString reportName);
+    ScriptReport* acquire(QTextStream *inputStream, QString reportName);
+    ScriptReport* acquire(QString input, QString reportName);
+    void release(ScriptReport *scriptReport);
+
+private:
+    ScriptReport* create();
+    ScriptReport* take(QString reportName);
+
+    ScriptReportEnginePoolPrivate *d;
+};
+
+#endif // SCRIPTREPORTENGINEPOOL_H
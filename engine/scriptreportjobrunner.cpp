@@ -0,0 +1,297 @@
+/*
+ * Copyright 2010 and beyond, Juan Luis Paz
+ *
+ * This file is part of Script Report.
+ *
+ * Script Report is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Script Report is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with Script Report.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "scriptreportjobrunner.h"
+
+#include <QBuffer>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QPdfWriter>
+#include <QTextStream>
+#include <QThreadPool>
+#include <QThreadStorage>
+#include <QtConcurrent/QtConcurrentRun>
+
+#include "scriptreport.h"
+#include "scriptreportenginepool.h"
+#include "scriptreporttracer.h"
+#include "textstreamobject.h"
+
+class ScriptReportJobRunnerPrivate {
+public:
+    ScriptReportJobRunnerPrivate(QStringList runnerExtensions) :
+            extensions(runnerExtensions)
+    {
+    }
+
+    ScriptReportEnginePool* enginePool() {
+        if (!enginePools.hasLocalData()) {
+            // Created in the worker thread, so the engines belong to it and they are deleted by
+            // the thread storage when the thread finishes
+            ScriptReportEnginePool *pool = new ScriptReportEnginePool(1, extensions);
+            pool->setInitScript(initScript);
+            enginePools.setLocalData(pool);
+        }
+        return enginePools.localData();
+    }
+
+    static ScriptReportJobResult runJob(ScriptReportJobRunnerPrivate *d, ScriptReportJob job);
+
+    QStringList extensions;
+    QString initScript;
+    // Declared before the thread pool, the threads must finish while the storage is alive
+    QThreadStorage<ScriptReportEnginePool*> enginePools;
+    QThreadPool threadPool;
+};
+
+ScriptReportJobResult ScriptReportJobRunnerPrivate::runJob(ScriptReportJobRunnerPrivate *d, ScriptReportJob job) {
+    QElapsedTimer timer;
+    timer.start();
+    ScriptReportTraceSpan span("job", "ScriptReportJobRunner::runJob");
+    span.setArgument(QString::fromLatin1("report"), job.reportName);
+
+    ScriptReportJobResult result;
+    result.reportName = job.reportName;
+    result.outputFileName = job.outputFileName;
+
+    ScriptReportEnginePool *pool = d->enginePool();
+    ScriptReport *sr;
+    if (job.input.isNull()) {
+        sr = pool->acquire(job.reportName);
+    } else {
+        sr = pool->acquire(job.input, job.reportName);
+    }
+    sr->setArguments(job.arguments);
+    sr->setPreviousScript(job.previousScript);
+    sr->setPrintErrorEnabled(job.isPrintErrorEnabled);
+    sr->setPipelineEnabled(job.isPipelineEnabled);
+    QTextStream printStream(&result.printOutput);
+    sr->printOutput()->setStream(&printStream);
+
+    QFile file(job.outputFileName);
+    QBuffer buffer(&result.output);
+    QIODevice *device = &buffer;
+    if (!job.outputFileName.isEmpty()) {
+        device = &file;
+    }
+
+    if (!device->open(QIODevice::WriteOnly)) {
+        result.hasError = true;
+        result.errorMessage = QString::fromLatin1("Unable to open the output file '%1'.").arg(job.outputFileName);
+    } else {
+        if (!job.isPipelineEnabled) {
+            // The report is run before the output is written, the pipelined mode runs it while
+            // the pages are rendered
+            sr->run();
+        }
+        if (job.isPipelineEnabled || !sr->hasUncaughtException() || job.isPrintErrorEnabled) {
+            QPdfWriter writer(device);
+            sr->render(&writer);
+        }
+        device->close();
+        result.hasUncaughtException = sr->hasUncaughtException();
+        result.hasError = result.hasUncaughtException;
+        result.errorMessage = sr->errorMessage();
+        result.stats = sr->stats();
+    }
+
+    printStream.flush();
+    sr->printOutput()->setStream(0);
+    pool->release(sr);
+
+    result.elapsedTime = timer.elapsed();
+    return result;
+}
+
+/*!
+    \class ScriptReportJob
+    \brief Describes a report to be rendered by a ScriptReportJobRunner.
+
+    A job is the report name, or the script in \c input with the report name used for the
+    messages, the script \c arguments and the \c previousScript, and the output target: the PDF is
+    written to the file \c outputFileName, or returned in ScriptReportJobResult::output if it is
+    empty. When \c isPrintErrorEnabled is true the report is printed even if the script fails,
+    and \c isPipelineEnabled renders the pages while the report is generated.
+*/
+
+/*!
+    \fn ScriptReportJob::ScriptReportJob()
+    Constructs an empty job.
+*/
+ScriptReportJob::ScriptReportJob() :
+        isPrintErrorEnabled(true),
+        isPipelineEnabled(false)
+{
+}
+
+/*!
+    \fn ScriptReportJob::ScriptReportJob(QString reportName, QStringList arguments, QString outputFileName)
+    Constructs a job that renders the report \a reportName with the \a arguments to the file
+    \a outputFileName.
+*/
+ScriptReportJob::ScriptReportJob(QString reportName, QStringList arguments, QString outputFileName) :
+        reportName(reportName),
+        arguments(arguments),
+        outputFileName(outputFileName),
+        isPrintErrorEnabled(true),
+        isPipelineEnabled(false)
+{
+}
+
+/*!
+    \class ScriptReportJobResult
+    \brief The result of a ScriptReportJob.
+
+    \c hasError is true if the report failed or the output could not be written, and
+    \c errorMessage describes the error. The PDF is in \c output when the job has no output file,
+    \c printOutput contains the text written by the \c print function and \c elapsedTime is the
+    time in milliseconds spent by the job, without the time waiting in the queue. The \c stats
+    of the report are filled when the job is run.
+*/
+
+/*!
+    \fn ScriptReportJobResult::ScriptReportJobResult()
+    Constructs an empty result.
+*/
+ScriptReportJobResult::ScriptReportJobResult() :
+        hasError(false),
+        hasUncaughtException(false),
+        elapsedTime(0)
+{
+}
+
+/*!
+    \class ScriptReportJobRunner
+    \brief Class for render reports in a pool of threads.
+
+    The ScriptReportJobRunner class runs ScriptReportJob objects in a thread pool and returns a
+    QFuture with the ScriptReportJobResult for each one, so several reports are rendered at the
+    same time using all the cores.
+
+    \code
+    ScriptReportJobRunner runner(4, QStringList() << "srsql");
+    QFuture<ScriptReportJobResult> future = runner.submit(ScriptReportJob("invoice.srt", arguments, "invoice.pdf"));
+    ScriptReportJobResult result = future.result();
+    \endcode
+
+    The script engines are not shared between threads: each worker thread has its own
+    ScriptReportEnginePool, created with the first job of the thread, and the reports are
+    created, run and destroyed in that thread. The engines are reused by the next jobs of the
+    same thread and destroyed when the thread finishes.
+
+    As the reports are run out of the application thread they cannot use widgets or pixmaps:
+    the image files and pictures added to the report are loaded as QImage, and rendering a
+    widget into the report throws a script error.
+*/
+
+/*!
+    \fn ScriptReportJobRunner::ScriptReportJobRunner(QObject *parent)
+    Constructs a Script Report Job Runner with parent object \a parent, it uses one thread for
+    each core without extensions.
+*/
+ScriptReportJobRunner::ScriptReportJobRunner(QObject *parent) :
+        QObject(parent),
+        d(new ScriptReportJobRunnerPrivate(QStringList()))
+{
+}
+
+/*!
+    \fn ScriptReportJobRunner::ScriptReportJobRunner(int maximumThreadCount, QStringList extensions, QObject *parent)
+    Constructs a Script Report Job Runner with parent object \a parent, it uses up to
+    \a maximumThreadCount threads whose engines have the \a extensions imported.
+*/
+ScriptReportJobRunner::ScriptReportJobRunner(int maximumThreadCount, QStringList extensions, QObject *parent) :
+        QObject(parent),
+        d(new ScriptReportJobRunnerPrivate(extensions))
+{
+    if (maximumThreadCount > 0) {
+        d->threadPool.setMaximumThreadCount(maximumThreadCount);
+    }
+}
+
+/*!
+    \fn ScriptReportJobRunner::~ScriptReportJobRunner()
+    Waits for the submitted jobs and destroy the Script Report Job Runner.
+*/
+ScriptReportJobRunner::~ScriptReportJobRunner() {
+    d->threadPool.waitForDone();
+    delete d;
+}
+
+/*!
+    \property ScriptReportJobRunner::maximumThreadCount
+    \brief Specifies the maximum number of threads used by the runner.
+
+    This property's default is QThread::idealThreadCount().
+*/
+int ScriptReportJobRunner::maximumThreadCount() const {
+    return d->threadPool.maximumThreadCount();
+}
+
+void ScriptReportJobRunner::setMaximumThreadCount(int maximumThreadCount) {
+    d->threadPool.setMaximumThreadCount(maximumThreadCount);
+}
+
+/*!
+    \property ScriptReportJobRunner::extensions
+    \brief The extensions imported in the engines of the worker threads.
+*/
+QStringList ScriptReportJobRunner::extensions() const {
+    return d->extensions;
+}
+
+/*!
+    \property ScriptReportJobRunner::initScript
+    \brief The script evaluated once in each engine of the worker threads.
+
+    It must be set before submit the first job, the engines already created are not changed.
+    \sa ScriptReportEnginePool::initScript
+*/
+QString ScriptReportJobRunner::initScript() const {
+    return d->initScript;
+}
+
+void ScriptReportJobRunner::setInitScript(QString initScript) {
+    d->initScript = initScript;
+}
+
+/*!
+    \property ScriptReportJobRunner::activeThreadCount
+    \brief The number of threads that are running a job.
+*/
+int ScriptReportJobRunner::activeThreadCount() const {
+    return d->threadPool.activeThreadCount();
+}
+
+/*!
+    \fn QFuture<ScriptReportJobResult> ScriptReportJobRunner::submit(const ScriptReportJob &job)
+    Queues the \a job and returns the future of its result.
+*/
+QFuture<ScriptReportJobResult> ScriptReportJobRunner::submit(const ScriptReportJob &job) {
+    return QtConcurrent::run(&d->threadPool, &ScriptReportJobRunnerPrivate::runJob, d, job);
+}
+
+/*!
+    \fn bool ScriptReportJobRunner::waitForDone(int msecs)
+    Waits up to \a msecs milliseconds, or without limit if it is -1, for the submitted jobs.
+    Returns true if all the jobs are finished.
+*/
+bool ScriptReportJobRunner::waitForDone(int msecs) {
+    return d->threadPool.waitForDone(msecs);
+}
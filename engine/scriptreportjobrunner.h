@@ -0,0 +1,91 @@
+/*
+ * Copyright 2010 and beyond, Juan Luis Paz
+ *
+ * This file is part of Script Report.
+ *
+ * Script Report is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Script Report is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with Script Report.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef SCRIPTREPORTJOBRUNNER_H
+#define SCRIPTREPORTJOBRUNNER_H
+
+#include "scriptreportengine_global.h"
+#include "scriptreportstats.h"
+
+#include <QByteArray>
+#include <QFuture>
+#include <QObject>
+#include <QStringList>
+
+class SCRIPTREPORTENGINE_EXPORT ScriptReportJob
+{
+public:
+    ScriptReportJob();
+    ScriptReportJob(QString reportName, QStringList arguments, QString outputFileName = QString());
+
+    QString reportName;
+    QString input;
+    QStringList arguments;
+    QString previousScript;
+    QString outputFileName;
+    bool isPrintErrorEnabled;
+    bool isPipelineEnabled;
+};
+
+class SCRIPTREPORTENGINE_EXPORT ScriptReportJobResult
+{
+public:
+    ScriptReportJobResult();
+
+    QString reportName;
+    QString outputFileName;
+    QByteArray output;
+    QString printOutput;
+    bool hasError;
+    bool hasUncaughtException;
+    QString errorMessage;
+    qint64 elapsedTime;
+    ScriptReportStats stats;
+};
+
+class ScriptReportJobRunnerPrivate;
+
+class SCRIPTREPORTENGINE_EXPORT ScriptReportJobRunner : public QObject
+{
+    Q_OBJECT
+    Q_PROPERTY(int maximumThreadCount READ maximumThreadCount WRITE setMaximumThreadCount)
+    Q_PROPERTY(QStringList extensions READ extensions)
+    Q_PROPERTY(QString initScript READ initScript WRITE setInitScript)
+    Q_PROPERTY(int activeThreadCount READ activeThreadCount)
+
+public:
+    explicit ScriptReportJobRunner(QObject *parent = 0);
+    ScriptReportJobRunner(int maximumThreadCount, QStringList extensions, QObject *parent = 0);
+    ~ScriptReportJobRunner();
+
+    int maximumThreadCount() const;
+    void setMaximumThreadCount(int maximumThreadCount);
+    QStringList extensions() const;
+    QString initScript() const;
+    void setInitScript(QString initScript);
+    int activeThreadCount() const;
+
+    QFuture<ScriptReportJobResult> submit(const ScriptReportJob &job);
+    bool waitForDone(int msecs = -1);
+
+private:
+    ScriptReportJobRunnerPrivate *d;
+};
+
+#endif // SCRIPTREPORTJOBRUNNER_H
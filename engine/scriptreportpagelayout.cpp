@@ -0,0 +1,674 @@
+/*
+ * Copyright 2010 and beyond, Juan Luis Paz
+ *
+ * This file is part of Script Report.
+ *
+ * Script Report is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Script Report is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with Script Report.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "scriptreportpagelayout.h"
+
+#include <QPainter>
+#include <QPagedPaintDevice>
+#include <QGuiApplication>
+#include <QScreen>
+#include <QAbstractTextDocumentLayout>
+#include <QElapsedTimer>
+#include <QTextFrame>
+
+#if QT_VERSION >= 0x050000
+#include <QtPrintSupport/QPrinter>
+#else
+#include <QPrinter>
+#endif
+
+#include "scriptreporttracer.h"
+#include "textstreamobject.h"
+
+/*!
+    \internal
+    \class ScriptReportPageLayout
+    \brief Layout of the pages of the output of a ScriptReport.
+
+    The header, footer and content sections are parsed once and each page is painted with \c paintPage().
+
+    When \a chunkSize is greater than 0 and the content is bigger, the content is split by a ContentSplitter
+    in chunks of about \a chunkSize characters. The chunks are laid out one at a time in the page order, and
+    only the recorded pages of the current chunk are kept in memory. Going back to a previous page lays out
+    the content again from the first chunk.
+
+    The content of a chunked layout is consumed while it is split: the layout takes it from the ScriptReport
+    and keeps the chunks compressed, each chunk is only kept as text while it is laid out.
+
+    A streamed layout doesn't have content when it is created, the chunks are appended with \c appendChunk()
+    while the report is generated and \c finishContent() is called at the end. The page count of the content
+    is not known until then, so it is painted later over the recorded pages.
+*/
+
+ScriptReportPageLayout::ScriptReportPageLayout(ScriptReport *scriptReport, const QSize &pageSize, int chunkSize) :
+        pageSize(pageSize),
+        contentNumbers(true),
+        decorationNumbers(false),
+        contentPageCount(-1),
+        isStreamed(false),
+        nextChunk(0),
+        lastPage(0),
+        firstKeptPage(1),
+        lastPageHeight(0),
+        totalParseTime(0),
+        totalLayoutTime(0)
+{
+    Sections reportSections = sections(scriptReport);
+    if (chunkSize > 0 && reportSections.content.size() > chunkSize) {
+        // The report doesn't keep its copy of the content, it is run again if it must be laid out again
+        reportSections.content = scriptReport->takeContent();
+    }
+    init(reportSections, chunkSize);
+}
+
+ScriptReportPageLayout::ScriptReportPageLayout(Sections sections, const QSize &pageSize, int chunkSize, bool isStreamed) :
+        pageSize(pageSize),
+        contentNumbers(true),
+        decorationNumbers(false),
+        contentPageCount(-1),
+        isStreamed(isStreamed),
+        nextChunk(0),
+        lastPage(0),
+        firstKeptPage(1),
+        lastPageHeight(0),
+        totalParseTime(0),
+        totalLayoutTime(0)
+{
+    init(sections, chunkSize);
+}
+
+/*!
+    \internal
+    Returns the sections of the output of \a scriptReport.
+*/
+ScriptReportPageLayout::Sections ScriptReportPageLayout::sections(ScriptReport *scriptReport) {
+    Sections sections;
+    sections.header = scriptReport->outputHeader()->text();
+    sections.headerFirst = scriptReport->outputHeaderFirst()->text();
+    sections.headerLast = scriptReport->outputHeaderLast()->text();
+    sections.content = scriptReport->outputContent()->text();
+    sections.footer = scriptReport->outputFooter()->text();
+    sections.footerFirst = scriptReport->outputFooterFirst()->text();
+    sections.footerLast = scriptReport->outputFooterLast()->text();
+    sections.resources = scriptReport->resources();
+    return sections;
+}
+
+/*!
+    \internal
+    Returns the rectangle of the page, in the coordinates used for lay out the documents, and the
+    \a scale from this coordinates to the \a device ones.
+*/
+QRect ScriptReportPageLayout::pageRect(QPagedPaintDevice *device, QPrinter *printer, qreal *scale) {
+    if (printer) {
+        *scale = 1;
+        return printer->pageRect();
+    }
+
+    // The documents are laid out at the screen resolution, like in a printer with the
+    // QPrinter::ScreenResolution mode, and scaled to the device resolution
+    QScreen *screen = QGuiApplication::primaryScreen();
+    qreal screenDpi = screen ? screen->logicalDotsPerInchY() : 96;
+    *scale = device->logicalDpiY() / screenDpi;
+    return QRect(0, 0, qRound(device->width() / *scale), qRound(device->height() / *scale));
+}
+
+void ScriptReportPageLayout::resetMatrix(QPainter &painter, qreal scale) {
+    painter.resetMatrix();
+    painter.scale(scale, scale);
+}
+
+bool ScriptReportPageLayout::isChunked() const {
+    return isStreamed || !chunks.isEmpty();
+}
+
+/*!
+    \internal
+    Returns true if any section of the report uses the \c ##pageCount## marker.
+*/
+bool ScriptReportPageLayout::hasPageCountMarker() const {
+    return pageCountMarker;
+}
+
+/*!
+    \internal
+    Returns the page count if it is known without lay out the whole content, otherwise returns -1.
+*/
+int ScriptReportPageLayout::knownPageCount() const {
+    return contentPageCount;
+}
+
+/*!
+    \internal
+    Returns the time in nanoseconds spent parsing the HTML of the sections.
+*/
+qint64 ScriptReportPageLayout::parseTime() const {
+    return totalParseTime;
+}
+
+/*!
+    \internal
+    Returns the time in nanoseconds spent laying out the documents in pages.
+*/
+qint64 ScriptReportPageLayout::layoutTime() const {
+    return totalLayoutTime;
+}
+
+/*!
+    \internal
+    Returns the page count, in a chunked layout all the chunks are laid out, without record them, if
+    the page count is not known. In a streamed layout the page count is not known until the end.
+*/
+int ScriptReportPageLayout::pageCount() {
+    if (contentPageCount < 0 && !isStreamed) {
+        ScriptReportTraceSpan span("layout", "pageCount");
+        restart();
+        while (nextChunk < chunks.size()) {
+            layoutNextChunk(false);
+        }
+        contentPageCount = lastPage;
+        restart();
+
+        contentNumbers.setPageCount(contentPageCount);
+        decorationNumbers.setPageCount(contentPageCount);
+        foreach (QTextDocument *document, numberedDocuments) {
+            document->markContentsDirty(0, document->characterCount());
+        }
+    }
+    return contentPageCount;
+}
+
+/*!
+    \internal
+    Returns true if the content has the page \a page, in a chunked layout the chunks are laid out until
+    the page is reached.
+*/
+bool ScriptReportPageLayout::hasPage(int page) {
+    if (!isChunked()) {
+        return page >= 1 && page <= contentPageCount;
+    }
+    if (page < firstKeptPage && !isStreamed) {
+        restart();
+    }
+    while (nextChunk < chunks.size() && lastPage < page) {
+        layoutNextChunk(true);
+    }
+    return page >= 1 && page <= lastPage;
+}
+
+void ScriptReportPageLayout::paintPage(QPainter &painter, int currentPage) {
+    ScriptReportTraceSpan span("paint", "paintPage");
+    span.setArgument(QString::fromLatin1("page"), currentPage);
+    contentNumbers.setPage(currentPage);
+    decorationNumbers.setPage(currentPage);
+
+    // Drawing the center content for current page.
+    painter.save();
+    // Applying positive translation of painter co-ordinate system by header hight.
+    painter.translate(0, headerRect.height());
+    paintContent(painter, currentPage);
+    painter.restore();
+
+    bool isLastPage;
+    if (isChunked()) {
+        isLastPage = !hasPage(currentPage + 1);
+    } else {
+        isLastPage = currentPage >= contentPageCount;
+    }
+
+    QTextDocument *pageHeader = &documentHeader;
+    QTextDocument *pageFooter = &documentFooter;
+    if (currentPage == 1 && footerFirstTemplate.isNull() ==false ) {
+        pageFooter = &documentFooterFirst;
+        if( headerFirstTemplate.isNull() ==false ) {
+            pageHeader = &documentHeaderFirst;
+        }
+    }else if (isLastPage) {
+        if( footerLastTemplate.isNull() ==false ) {
+            pageFooter = &documentFooterLast;
+        }
+        if( headerLastTemplate.isNull() ==false ) {
+            pageHeader = &documentHeaderLast;
+        }
+    }
+
+    // The small header and footer documents are laid out again for the width of the new numbers, or
+    // parsed again if they have markers that can not be replaced by the page number objects
+    if (replacedDocuments.contains(pageHeader)) {
+        pageHeader->setHtml(PageNumberObject::replaceMarkers(replacedDocuments.value(pageHeader), currentPage, contentPageCount));
+    }
+    if (replacedDocuments.contains(pageFooter)) {
+        pageFooter->setHtml(PageNumberObject::replaceMarkers(replacedDocuments.value(pageFooter), currentPage, contentPageCount));
+    }
+    if (numberedDocuments.contains(pageHeader)) {
+        pageHeader->markContentsDirty(0, pageHeader->characterCount());
+    }
+    if (numberedDocuments.contains(pageFooter)) {
+        pageFooter->markContentsDirty(0, pageFooter->characterCount());
+    }
+
+    // Drawing the header on the top of the page
+    pageHeader->drawContents(&painter, headerRect);
+    // Applying positive translation of painter co-ordinate system to draw the footer
+    painter.translate(0, headerRect.height());
+    painter.translate(0, centerSize.height());
+    pageFooter->drawContents(&painter, footerRect);
+}
+
+/*!
+    \internal
+    Appends the \a chunk of content, with the document head \a prefix and the \a resources, to a streamed
+    layout. The chunk is laid out and its pages are recorded.
+*/
+void ScriptReportPageLayout::appendChunk(const ContentSplitter::Chunk &chunk, const QString &prefix, const ScriptReportResources &resources) {
+    this->resources = resources;
+    contentPrefix = prefix;
+    chunks.append(chunk);
+    while (nextChunk < chunks.size()) {
+        layoutNextChunk(true);
+    }
+    // The html of the chunk is not needed any more
+    chunks.last().html.clear();
+}
+
+/*!
+    \internal
+    Ends the content of a streamed layout. The header and footer are set up again if they have been
+    changed in \a sections, but keeping the sizes calculated when the layout was created.
+*/
+void ScriptReportPageLayout::finishContent(const Sections &sections) {
+    resources = sections.resources;
+    if (sections.headerFirst != headerFirstTemplate || sections.headerLast != headerLastTemplate
+            || sections.header != headerTemplate
+            || sections.footerFirst != footerFirstTemplate || sections.footerLast != footerLastTemplate
+            || sections.footer != footerTemplate) {
+        QSizeF headerSize;
+        QSizeF footerSize;
+        setUpDecorations(sections, &headerSize, &footerSize);
+    }
+
+    contentPageCount = lastPage;
+    contentNumbers.setPageCount(contentPageCount);
+    decorationNumbers.setPageCount(contentPageCount);
+    foreach (QTextDocument *document, numberedDocuments) {
+        document->markContentsDirty(0, document->characterCount());
+    }
+}
+
+/*!
+    \internal
+    Returns the number of pages of a streamed layout that are complete, the last page can be continued
+    by the next chunk until the content is finished.
+*/
+int ScriptReportPageLayout::completePageCount() const {
+    if (contentPageCount >= 0) {
+        return contentPageCount;
+    }
+    return qMax(0, lastPage - 1);
+}
+
+/*!
+    \internal
+    Returns true if the page \a page of a streamed layout can't be painted until the page count is known.
+*/
+bool ScriptReportPageLayout::isPageCountPending(int page) const {
+    if (contentPageCount >= 0) {
+        return false;
+    }
+    return decorationPageCountMarker || contentPageCounts.contains(page);
+}
+
+/*
+ * Private members
+ */
+
+void ScriptReportPageLayout::init(Sections &sections, int chunkSize) {
+    QString pageCountName = QString::fromLatin1("##pageCount##");
+    resources = sections.resources;
+
+    // Each document is parsed and laid out once, the ##page## and ##pageCount## markers are replaced by
+    // objects that paint the current numbers. The page numbers of the content reserve the width of the
+    // page count, so its layout is valid for every page.
+    QSizeF headerSize = QSize(0,0);
+    QSizeF footerSize = QSize(0,0);
+    setUpDecorations(sections, &headerSize, &footerSize);
+    pageCountMarker = decorationPageCountMarker || sections.content.contains(pageCountName);
+
+    // Calculating the main document size for one page
+    centerSize = QSizeF(pageSize.width(),
+                        pageSize.height() -
+                           headerSize.toSize().height() -
+                           footerSize.toSize().height());
+
+    if (isStreamed) {
+        contentNumbers.setPageCountDeferred(true);
+    } else if (chunkSize > 0 && sections.content.size() > chunkSize) {
+        // The content is appended to the splitter a piece at a time, so it doesn't copy the whole text,
+        // and each chunk is compressed as soon as it is cut
+        ContentSplitter splitter(chunkSize);
+        for (int i = 0; i < sections.content.size(); i += chunkSize) {
+            splitter.append(sections.content.mid(i, chunkSize));
+            while (splitter.hasChunk()) {
+                appendPackedChunk(splitter.takeChunk());
+            }
+        }
+        ContentSplitter::Chunk last = splitter.finish();
+        if (chunks.isEmpty() || !last.html.trimmed().isEmpty()) {
+            appendPackedChunk(last);
+        }
+        contentPrefix = splitter.prefix();
+        if (chunks.size() < 2) {
+            chunks.clear();
+            packedChunks.clear();
+            contentPrefix.clear();
+        } else {
+            sections.content.clear();
+        }
+    }
+
+    if (isStreamed) {
+        // The content is appended later
+    } else if (isChunked()) {
+        if (pageCountMarker) {
+            pageCount();
+        }
+    } else {
+        // Setting up the center page
+        QElapsedTimer timer;
+        timer.start();
+        setUpDocument(&mainDocument);
+        {
+            ScriptReportTraceSpan span("parse", "setHtml");
+            span.setArgument(QString::fromLatin1("section"), QLatin1String("content"));
+            span.setArgument(QString::fromLatin1("size"), sections.content.size());
+            mainDocument.setHtml(sections.content);
+        }
+        bool contentNumbered = false;
+        if (PageNumberObject::hasMarkerInTag(sections.content)) {
+            // The markers inside tags are replaced in the html, the content is parsed again for each page
+            replacedContent = sections.content;
+        } else {
+            contentNumbered = contentNumbers.install(&mainDocument);
+        }
+        totalParseTime += timer.nsecsElapsed();
+        timer.start();
+        mainDocument.setPageSize(centerSize);
+
+        ScriptReportTraceSpan pageCountSpan("layout", "pageCount");
+        contentPageCount = mainDocument.pageCount();
+        contentNumbers.setPageCount(contentPageCount);
+        if (contentNumbered) {
+            // Only the width of the numbers can change, the content is laid out again but not parsed
+            mainDocument.markContentsDirty(0, mainDocument.characterCount());
+            contentPageCount = mainDocument.pageCount();
+            contentNumbers.setPageCount(contentPageCount);
+        }
+        decorationNumbers.setPageCount(contentPageCount);
+        foreach (QTextDocument *document, numberedDocuments) {
+            document->markContentsDirty(0, document->characterCount());
+        }
+        pageCountSpan.setArgument(QString::fromLatin1("pages"), contentPageCount);
+        totalLayoutTime += timer.nsecsElapsed();
+    }
+
+    // Setting up the rectangles for each section.
+    headerRect  = QRect(QPoint(0,0), documentHeader.size().toSize());
+    footerRect  = QRect(QPoint(0,0), documentFooter.size().toSize());
+}
+
+void ScriptReportPageLayout::setUpDecorations(const Sections &sections, QSizeF *headerSize, QSizeF *footerSize) {
+    QString pageCountName = QString::fromLatin1("##pageCount##");
+
+    headerTemplate = sections.header;
+    headerFirstTemplate = sections.headerFirst;
+    headerLastTemplate = sections.headerLast;
+    footerTemplate = sections.footer;
+    footerFirstTemplate = sections.footerFirst;
+    footerLastTemplate = sections.footerLast;
+
+    QList<QTextDocument*> documents;
+    documents << &documentHeaderFirst << &documentHeaderLast << &documentHeader
+              << &documentFooterFirst << &documentFooterLast << &documentFooter;
+    QStringList decorationTemplates;
+    decorationTemplates << sections.headerFirst << sections.headerLast << sections.header
+                        << sections.footerFirst << sections.footerLast << sections.footer;
+    static const char *const decorationNames[] = {
+        "headerFirst", "headerLast", "header", "footerFirst", "footerLast", "footer"
+    };
+
+    // Setting up the headers and footers and calculating the header and footer size
+    decorationPageCountMarker = false;
+    numberedDocuments.clear();
+    replacedDocuments.clear();
+    for (int i = 0; i < decorationTemplates.size(); i++) {
+        QTextDocument *document = documents.at(i);
+        QElapsedTimer timer;
+        timer.start();
+        setUpDocument(document);
+        document->setPageSize(pageSize);
+        {
+            ScriptReportTraceSpan span("parse", "setHtml");
+            span.setArgument(QString::fromLatin1("section"), QString::fromLatin1(decorationNames[i]));
+            span.setArgument(QString::fromLatin1("size"), decorationTemplates.at(i).size());
+            document->setHtml(decorationTemplates.at(i));
+        }
+        if (PageNumberObject::hasMarkerInTag(decorationTemplates.at(i))) {
+            replacedDocuments.insert(document, decorationTemplates.at(i));
+        } else if (decorationNumbers.install(document)) {
+            numberedDocuments.append(document);
+        }
+        totalParseTime += timer.nsecsElapsed();
+        timer.start();
+        decorationPageCountMarker = decorationPageCountMarker || decorationTemplates.at(i).contains(pageCountName);
+        QSizeF *size = i < 3 ? headerSize : footerSize;
+        if ( document->size().height() > size->height() ) {
+            *size = document->size();
+        }
+        totalLayoutTime += timer.nsecsElapsed();
+    }
+}
+
+void ScriptReportPageLayout::setUpDocument(QTextDocument *document) const {
+    document->setUndoRedoEnabled(false);
+    QMapIterator<QUrl, ScriptReportResourcePair> resourcesIterator(resources);
+    while (resourcesIterator.hasNext()) {
+        resourcesIterator.next();
+        document->addResource(resourcesIterator.value().first, resourcesIterator.key(), resourcesIterator.value().second);
+    }
+}
+
+void ScriptReportPageLayout::paintContent(QPainter &painter, int page) {
+    if (!isChunked()) {
+        if (!replacedContent.isNull()) {
+            QElapsedTimer timer;
+            timer.start();
+            {
+                ScriptReportTraceSpan span("parse", "setHtml");
+                span.setArgument(QString::fromLatin1("section"), QLatin1String("content"));
+                span.setArgument(QString::fromLatin1("page"), page);
+                mainDocument.setHtml(PageNumberObject::replaceMarkers(replacedContent, page, contentPageCount));
+            }
+            totalParseTime += timer.nsecsElapsed();
+        }
+
+        // Main content rectangle for the current page.
+        QRect currentRect = QRect(QPoint(0,0), centerSize.toSize());
+        currentRect.moveTo(0, (page - 1) * currentRect.height());
+
+        // Applying negative translation of painter co-ordinate system by current main content rectangle top y coordinate.
+        painter.translate(0, -currentRect.y());
+        ScriptReportTraceSpan span("paint", "drawContents");
+        span.setArgument(QString::fromLatin1("page"), page);
+        mainDocument.drawContents(&painter, currentRect);
+        return;
+    }
+
+    if (page < firstKeptPage && !isStreamed) {
+        restart();
+    }
+    // The page is complete when a later chunk starts in a new page
+    while (nextChunk < chunks.size()
+           && (lastPage < page || (lastPage == page && !chunks.at(nextChunk).isPageBreak))) {
+        layoutNextChunk(true);
+    }
+
+    foreach (const QPicture &picture, contentPages.value(page)) {
+        painter.drawPicture(0, 0, picture);
+    }
+    PageNumberObject::paintDeferredNumbers(&painter, contentPageCounts.value(page), contentPageCount);
+
+    // Only the current page is kept, for the copies
+    while (!contentPages.isEmpty() && contentPages.constBegin().key() < page) {
+        contentPages.erase(contentPages.begin());
+    }
+    while (!contentPageCounts.isEmpty() && contentPageCounts.constBegin().key() < page) {
+        contentPageCounts.erase(contentPageCounts.begin());
+    }
+    firstKeptPage = page;
+}
+
+void ScriptReportPageLayout::restart() {
+    nextChunk = 0;
+    lastPage = 0;
+    firstKeptPage = 1;
+    lastPageHeight = 0;
+    contentPages.clear();
+    contentPageCounts.clear();
+}
+
+void ScriptReportPageLayout::appendPackedChunk(const ContentSplitter::Chunk &chunk) {
+    ContentSplitter::Chunk packed;
+    packed.isPageBreak = chunk.isPageBreak;
+    chunks.append(packed);
+    packedChunks.append(qCompress(chunk.html.toUtf8(), 1));
+}
+
+void ScriptReportPageLayout::layoutNextChunk(bool record) {
+    const ContentSplitter::Chunk &chunk = chunks.at(nextChunk);
+    QString html = chunk.html;
+    if (nextChunk < packedChunks.size()) {
+        html = QString::fromUtf8(qUncompress(packedChunks.at(nextChunk)));
+    }
+    bool continuesPage = nextChunk > 0 && !chunk.isPageBreak;
+
+    QElapsedTimer timer;
+    timer.start();
+    QTextDocument document;
+    setUpDocument(&document);
+    {
+        ScriptReportTraceSpan span("parse", "setHtml");
+        span.setArgument(QString::fromLatin1("section"), QLatin1String("content"));
+        span.setArgument(QString::fromLatin1("chunk"), nextChunk);
+        span.setArgument(QString::fromLatin1("size"), html.size());
+        document.setHtml(contentPrefix + html);
+    }
+    // The text of the chunk is released once it is parsed, unless it has markers inside tags that must be
+    // replaced in the html of each page
+    bool replacesMarkers = record && PageNumberObject::hasMarkerInTag(html);
+    if (!replacesMarkers) {
+        html.clear();
+    }
+    contentNumbers.install(&document);
+    totalParseTime += timer.nsecsElapsed();
+    timer.start();
+    if (continuesPage) {
+        // The chunk starts below the content of the previous chunk in its last page
+        QTextFrameFormat format = document.rootFrame()->frameFormat();
+        format.setTopMargin(lastPageHeight);
+        document.rootFrame()->setFrameFormat(format);
+    }
+    document.setPageSize(centerSize);
+
+    qreal pageHeight = centerSize.height();
+    int documentPageCount;
+    {
+        ScriptReportTraceSpan span("layout", "pageCount");
+        span.setArgument(QString::fromLatin1("chunk"), nextChunk);
+        documentPageCount = document.pageCount();
+    }
+    QAbstractTextDocumentLayout *layout = document.documentLayout();
+    totalLayoutTime += timer.nsecsElapsed();
+
+    // A chunk that starts with a page break can have an empty first page
+    int skippedPages = 0;
+    if (chunk.isPageBreak) {
+        for (QTextFrame::iterator it = document.rootFrame()->begin(); !it.atEnd(); ++it) {
+            if (it.currentFrame()) {
+                skippedPages = int(layout->frameBoundingRect(it.currentFrame()).top() / pageHeight);
+                break;
+            }
+            if (it.currentBlock().length() > 1) {
+                skippedPages = int(layout->blockBoundingRect(it.currentBlock()).top() / pageHeight);
+                break;
+            }
+        }
+        skippedPages = qBound(0, skippedPages, documentPageCount - 1);
+    }
+
+    int startPage = continuesPage ? qMax(1, lastPage) : lastPage + 1;
+    for (int i = skippedPages; record && i < documentPageCount; i++) {
+        int page = startPage + i - skippedPages;
+        contentNumbers.setPage(page);
+
+        QTextDocument *pageDocument = &document;
+        QTextDocument replacedDocument;
+        if (replacesMarkers) {
+            timer.start();
+            setUpDocument(&replacedDocument);
+            {
+                ScriptReportTraceSpan span("parse", "setHtml");
+                span.setArgument(QString::fromLatin1("section"), QLatin1String("content"));
+                span.setArgument(QString::fromLatin1("chunk"), nextChunk);
+                span.setArgument(QString::fromLatin1("page"), page);
+                replacedDocument.setHtml(contentPrefix + PageNumberObject::replaceMarkers(html, page, contentPageCount));
+            }
+            contentNumbers.install(&replacedDocument);
+            replacedDocument.rootFrame()->setFrameFormat(document.rootFrame()->frameFormat());
+            replacedDocument.setPageSize(centerSize);
+            totalParseTime += timer.nsecsElapsed();
+            pageDocument = &replacedDocument;
+        }
+
+        QPicture picture;
+        QPainter painter(&picture);
+        QRectF pageRect(0, i * pageHeight, centerSize.width(), pageHeight);
+        painter.translate(0, -pageRect.y());
+        {
+            ScriptReportTraceSpan span("paint", "drawContents");
+            span.setArgument(QString::fromLatin1("page"), page);
+            pageDocument->drawContents(&painter, pageRect);
+        }
+        painter.end();
+        contentPages[page].append(picture);
+
+        QList<PageNumberObject::DeferredNumber> pageCounts = contentNumbers.takeDeferredNumbers();
+        if (!pageCounts.isEmpty()) {
+            contentPageCounts[page] += pageCounts;
+        }
+    }
+
+    lastPage = startPage + documentPageCount - 1 - skippedPages;
+    lastPageHeight = layout->blockBoundingRect(document.lastBlock()).bottom() - (documentPageCount - 1) * pageHeight;
+    lastPageHeight = qBound(qreal(0), lastPageHeight, pageHeight);
+
+    nextChunk++;
+    if (nextChunk == chunks.size() && contentPageCount < 0 && record && !isStreamed) {
+        contentPageCount = lastPage;
+    }
+}
@@ -0,0 +1,137 @@
+/*
+ * Copyright 2010 and beyond, Juan Luis Paz
+ *
+ * This file is part of Script Report.
+ *
+ * Script Report is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Script Report is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with Script Report.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef SCRIPTREPORTPAGELAYOUT_H
+#define SCRIPTREPORTPAGELAYOUT_H
+
+#include <QByteArray>
+#include <QList>
+#include <QMap>
+#include <QPicture>
+#include <QRect>
+#include <QStringList>
+#include <QTextDocument>
+
+#include "contentsplitter.h"
+#include "pagenumberobject.h"
+#include "scriptreport.h"
+
+class QPainter;
+class QPagedPaintDevice;
+class QPrinter;
+
+class ScriptReportPageLayout
+{
+public:
+    struct Sections {
+        QString header;
+        QString headerFirst;
+        QString headerLast;
+        QString content;
+        QString footer;
+        QString footerFirst;
+        QString footerLast;
+        ScriptReportResources resources;
+    };
+
+    ScriptReportPageLayout(ScriptReport *scriptReport, const QSize &pageSize, int chunkSize = 0);
+    ScriptReportPageLayout(Sections sections, const QSize &pageSize, int chunkSize = 0, bool isStreamed = false);
+
+    static Sections sections(ScriptReport *scriptReport);
+    static QRect pageRect(QPagedPaintDevice *device, QPrinter *printer, qreal *scale);
+    static void resetMatrix(QPainter &painter, qreal scale);
+
+    bool isChunked() const;
+    bool hasPageCountMarker() const;
+    int knownPageCount() const;
+    int pageCount();
+    bool hasPage(int page);
+    qint64 parseTime() const;
+    qint64 layoutTime() const;
+
+    void paintPage(QPainter &painter, int page);
+
+    void appendChunk(const ContentSplitter::Chunk &chunk, const QString &prefix, const ScriptReportResources &resources);
+    void finishContent(const Sections &sections);
+    int completePageCount() const;
+    bool isPageCountPending(int page) const;
+
+private:
+    void init(Sections &sections, int chunkSize);
+    void setUpDecorations(const Sections &sections, QSizeF *headerSize, QSizeF *footerSize);
+    void setUpDocument(QTextDocument *document) const;
+    void paintContent(QPainter &painter, int page);
+
+    void restart();
+    void appendPackedChunk(const ContentSplitter::Chunk &chunk);
+    void layoutNextChunk(bool record);
+
+    QSize pageSize;
+    ScriptReportResources resources;
+
+    QString headerTemplate;
+    QString headerFirstTemplate;
+    QString headerLastTemplate;
+    QString footerTemplate;
+    QString footerFirstTemplate;
+    QString footerLastTemplate;
+    bool pageCountMarker;
+    bool decorationPageCountMarker;
+
+    PageNumberObject contentNumbers;
+    PageNumberObject decorationNumbers;
+
+    QTextDocument documentHeader;
+    QTextDocument documentHeaderFirst;
+    QTextDocument documentHeaderLast;
+    QTextDocument documentFooter;
+    QTextDocument documentFooterFirst;
+    QTextDocument documentFooterLast;
+    QTextDocument mainDocument;
+    QList<QTextDocument*> numberedDocuments;
+    // The headers and footers with page markers inside a tag, they are parsed for each page
+    QMap<QTextDocument*, QString> replacedDocuments;
+    // The content with page markers inside a tag, it is parsed for each page
+    QString replacedContent;
+
+    QSizeF centerSize;
+    QRect headerRect;
+    QRect footerRect;
+    int contentPageCount;
+
+    // Chunked layout: the content is laid out a chunk at a time, the pages of each chunk are
+    // recorded and the chunk document is freed before the next one. In a streamed layout the
+    // chunks are appended while the report is generated, otherwise the html of the chunks is kept
+    // compressed in packedChunks and only the chunk being laid out is kept as text.
+    bool isStreamed;
+    QString contentPrefix;
+    QList<ContentSplitter::Chunk> chunks;
+    QList<QByteArray> packedChunks;
+    int nextChunk;
+    int lastPage;
+    int firstKeptPage;
+    qreal lastPageHeight;
+    QMap<int, QList<QPicture> > contentPages;
+    QMap<int, QList<PageNumberObject::DeferredNumber> > contentPageCounts;
+
+    qint64 totalParseTime;
+    qint64 totalLayoutTime;
+};
+
+#endif // SCRIPTREPORTPAGELAYOUT_H
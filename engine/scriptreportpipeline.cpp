@@ -0,0 +1,320 @@
+/*
+ * Copyright 2010 and beyond, Juan Luis Paz
+ *
+ * This file is part of Script Report.
+ *
+ * Script Report is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Script Report is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with Script Report.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "scriptreportpipeline.h"
+
+#include <QElapsedTimer>
+#include <QMutexLocker>
+#include <QPainter>
+#include <QPagedPaintDevice>
+#include <QPixmap>
+#include <QImage>
+
+#if QT_VERSION >= 0x050000
+#include <QtPrintSupport/QPrinter>
+#else
+#include <QPrinter>
+#endif
+
+#include "scriptreport.h"
+
+/*!
+    \internal
+    \class ScriptReportPipeline
+    \brief Lays out and prints the content of a report while the report is generated.
+
+    The content written by the script is appended with \c append() and split by a ContentSplitter in chunks
+    of about \a chunkSize characters. The chunks are sent through a queue of \c QueueCapacity chunks, so the
+    script waits when the layout is late, to a thread that lays out them with a streamed
+    ScriptReportPageLayout and prints the pages as they are complete.
+
+    The pipeline starts with the first chunk of content, the print configuration and the header and footer
+    sections written until that moment are used for the page layout. When the header, the footer or the
+    content use the page count, the pages are recorded and kept until \c finish() is called; at the end the
+    page count is painted over the recorded pages, and only the header and the footer are laid out again.
+*/
+
+ScriptReportPipeline::ScriptReportPipeline(ScriptReport *scriptReport, QPagedPaintDevice *device, QPrinter *printer, int chunkSize, QObject *parent) :
+        QThread(parent),
+        m_scriptReport(scriptReport),
+        m_device(device),
+        m_printer(printer),
+        m_splitter(chunkSize),
+        m_isStarted(false),
+        m_scale(1),
+        m_parseTime(0),
+        m_layoutTime(0),
+        m_paintTime(0),
+        m_pageCount(-1)
+{
+}
+
+ScriptReportPipeline::~ScriptReportPipeline() {
+    if (m_isStarted && isRunning()) {
+        enqueue(ContentSplitter::Chunk(), true);
+        wait();
+    }
+}
+
+/*!
+    \internal
+    Returns true if the pipeline can print with \a printer. The pages are printed in order as they are
+    laid out, so page ranges, the reverse order and the uncollated copies are not supported.
+*/
+bool ScriptReportPipeline::canPrint(QPrinter *printer) {
+    if (!printer) {
+        return true;
+    }
+    return (printer->collateCopies() || printer->numCopies() == 1)
+            && printer->fromPage() == 0 && printer->toPage() == 0
+            && printer->pageOrder() == QPrinter::FirstPageFirst;
+}
+
+/*!
+    \internal
+    Appends the content \a text written by the script.
+*/
+void ScriptReportPipeline::append(const QString &text) {
+    m_splitter.append(text);
+    while (m_splitter.hasChunk()) {
+        startLayout();
+        enqueue(m_splitter.takeChunk(), false);
+    }
+}
+
+/*!
+    \internal
+    Sends the rest of the content and waits until all the pages are printed.
+*/
+void ScriptReportPipeline::finish() {
+    ContentSplitter::Chunk chunk = m_splitter.finish();
+    if (!m_isStarted || !chunk.html.trimmed().isEmpty()) {
+        startLayout();
+        enqueue(chunk, false);
+    }
+
+    {
+        QMutexLocker locker(&m_mutex);
+        m_endSections = sections();
+        if (m_scriptReport->isPrintErrorEnabled()) {
+            m_errorMessage = m_scriptReport->errorMessage();
+        }
+    }
+    enqueue(ContentSplitter::Chunk(), true);
+    wait();
+}
+
+/*!
+    \internal
+    Returns the time in nanoseconds spent parsing the HTML by the layout thread.
+*/
+qint64 ScriptReportPipeline::parseTime() const {
+    return m_parseTime;
+}
+
+/*!
+    \internal
+    Returns the time in nanoseconds spent laying out the pages by the layout thread.
+*/
+qint64 ScriptReportPipeline::layoutTime() const {
+    return m_layoutTime;
+}
+
+/*!
+    \internal
+    Returns the time in nanoseconds spent painting the pages by the layout thread, without the time
+    waiting for content.
+*/
+qint64 ScriptReportPipeline::paintTime() const {
+    return m_paintTime;
+}
+
+/*!
+    \internal
+    Returns the number of printed pages, or -1 if the pipeline has not finished.
+*/
+int ScriptReportPipeline::pageCount() const {
+    return m_pageCount;
+}
+
+void ScriptReportPipeline::run() {
+    QElapsedTimer timer;
+    qint64 workTime = 0;
+    timer.start();
+    ScriptReportPageLayout layout(m_startSections, m_pageSize, 0, true);
+
+    QPainter painter(m_device);
+    // Check that there is a valid device to print to, the queue is consumed anyway.
+    bool isPrinting = painter.isActive();
+
+    int printedPages = 0;
+    bool isHolding = false;
+    workTime += timer.nsecsElapsed();
+    forever {
+        Item item = dequeue();
+        if (item.isEnd) {
+            break;
+        }
+        if (!isPrinting) {
+            continue;
+        }
+
+        timer.start();
+        layout.appendChunk(item.chunk, item.prefix, item.resources);
+        while (!isHolding && isPrinting && printedPages < layout.completePageCount()) {
+            if (layout.isPageCountPending(printedPages + 1)) {
+                // The rest of the pages are printed in order when the page count is known
+                isHolding = true;
+            } else {
+                isPrinting = paintPage(painter, layout, ++printedPages);
+            }
+        }
+        workTime += timer.nsecsElapsed();
+    }
+    if (!isPrinting) {
+        setStats(layout, workTime, printedPages);
+        return;
+    }
+
+    // The final pass, only the header and footer are laid out
+    timer.start();
+    {
+        QMutexLocker locker(&m_mutex);
+        layout.finishContent(m_endSections);
+    }
+    while (isPrinting && printedPages < layout.knownPageCount()) {
+        isPrinting = paintPage(painter, layout, ++printedPages);
+    }
+
+    if (isPrinting && !m_errorMessage.isNull()) {
+        // Setting up the error and calculating the error size
+        QTextDocument documentError;
+        documentError.setPageSize(m_pageSize);
+        documentError.setPlainText(m_errorMessage);
+        QRect errorRect  = QRect(QPoint(0,0), documentError.size().toSize());
+
+        m_device->newPage();
+        // Resetting the painter matrix co ordinate system.
+        ScriptReportPageLayout::resetMatrix(painter, m_scale);
+        // Drawing the error on the top of the page
+        documentError.drawContents(&painter, errorRect);
+    }
+    workTime += timer.nsecsElapsed();
+    setStats(layout, workTime, printedPages);
+}
+
+/*
+ * Private members
+ */
+
+void ScriptReportPipeline::startLayout() {
+    if (m_isStarted) {
+        return;
+    }
+    m_isStarted = true;
+
+    m_scriptReport->applyConfiguration(m_device, m_printer);
+    m_pageSize = ScriptReportPageLayout::pageRect(m_device, m_printer, &m_scale).size();
+    m_startSections = sections();
+    start();
+}
+
+void ScriptReportPipeline::enqueue(const ContentSplitter::Chunk &chunk, bool isEnd) {
+    Item item;
+    item.chunk = chunk;
+    item.isEnd = isEnd;
+    if (!isEnd) {
+        item.prefix = m_splitter.prefix();
+        item.resources = sections().resources;
+    }
+
+    QMutexLocker locker(&m_mutex);
+    while (m_queue.size() >= QueueCapacity) {
+        m_notFull.wait(&m_mutex);
+    }
+    m_queue.enqueue(item);
+    m_notEmpty.wakeOne();
+}
+
+ScriptReportPipeline::Item ScriptReportPipeline::dequeue() {
+    QMutexLocker locker(&m_mutex);
+    while (m_queue.isEmpty()) {
+        m_notEmpty.wait(&m_mutex);
+    }
+    Item item = m_queue.dequeue();
+    m_notFull.wakeOne();
+    return item;
+}
+
+/*!
+    \internal
+    Returns the header and footer sections of the report, without the content, and the resources.
+    The pixmaps can't be used outside the GUI thread, they are converted to images.
+*/
+ScriptReportPageLayout::Sections ScriptReportPipeline::sections() {
+    ScriptReportPageLayout::Sections sections = ScriptReportPageLayout::sections(m_scriptReport);
+    sections.content.clear();
+
+    QMapIterator<QUrl, ScriptReportResourcePair> resourcesIterator(sections.resources);
+    while (resourcesIterator.hasNext()) {
+        resourcesIterator.next();
+        if (!m_resources.contains(resourcesIterator.key())) {
+            ScriptReportResourcePair resource = resourcesIterator.value();
+            if (resource.second.type() == QVariant::Pixmap) {
+                resource.second = QVariant(qvariant_cast<QPixmap>(resource.second).toImage());
+            }
+            m_resources.insert(resourcesIterator.key(), resource);
+        }
+    }
+    sections.resources = m_resources;
+    return sections;
+}
+
+bool ScriptReportPipeline::paintPage(QPainter &painter, ScriptReportPageLayout &layout, int page) {
+    int pageCopies = 1;
+    if (m_printer && m_printer->collateCopies()) {
+        pageCopies = m_printer->numCopies();
+    }
+
+    if (page > 1) {
+        m_device->newPage();
+    }
+    for (int j = 0; j < pageCopies; ++j) {
+        if (m_printer && (m_printer->printerState() == QPrinter::Aborted
+            || m_printer->printerState() == QPrinter::Error)) {
+            return false;
+        }
+
+        // Resetting the painter matrix co ordinate system.
+        ScriptReportPageLayout::resetMatrix(painter, m_scale);
+        layout.paintPage(painter, page);
+
+        if (j < pageCopies - 1) {
+            m_device->newPage();
+        }
+    }
+    return true;
+}
+
+void ScriptReportPipeline::setStats(const ScriptReportPageLayout &layout, qint64 workTime, int pageCount) {
+    m_parseTime = layout.parseTime();
+    m_layoutTime = layout.layoutTime();
+    m_paintTime = workTime - m_parseTime - m_layoutTime;
+    m_pageCount = pageCount;
+}
@@ -0,0 +1,101 @@
+/*
+ * Copyright 2010 and beyond, Juan Luis Paz
+ *
+ * This file is part of Script Report.
+ *
+ * Script Report is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Script Report is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with Script Report.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef SCRIPTREPORTPIPELINE_H
+#define SCRIPTREPORTPIPELINE_H
+
+#include <QThread>
+#include <QMutex>
+#include <QWaitCondition>
+#include <QQueue>
+
+#include "contentsplitter.h"
+#include "scriptreportpagelayout.h"
+
+class QPainter;
+class QPagedPaintDevice;
+class QPrinter;
+
+class ScriptReport;
+
+class ScriptReportPipeline : public QThread
+{
+public:
+    enum {
+        DefaultChunkSize = 64 * 1024,
+        QueueCapacity = 4
+    };
+
+    ScriptReportPipeline(ScriptReport *scriptReport, QPagedPaintDevice *device, QPrinter *printer, int chunkSize, QObject *parent = 0);
+    ~ScriptReportPipeline();
+
+    static bool canPrint(QPrinter *printer);
+
+    void append(const QString &text);
+    void finish();
+
+    qint64 parseTime() const;
+    qint64 layoutTime() const;
+    qint64 paintTime() const;
+    int pageCount() const;
+
+protected:
+    void run();
+
+private:
+    struct Item {
+        ContentSplitter::Chunk chunk;
+        QString prefix;
+        ScriptReportResources resources;
+        bool isEnd;
+    };
+
+    void startLayout();
+    void enqueue(const ContentSplitter::Chunk &chunk, bool isEnd);
+    Item dequeue();
+    ScriptReportPageLayout::Sections sections();
+    bool paintPage(QPainter &painter, ScriptReportPageLayout &layout, int page);
+    void setStats(const ScriptReportPageLayout &layout, qint64 workTime, int pageCount);
+
+    ScriptReport *m_scriptReport;
+    QPagedPaintDevice *m_device;
+    QPrinter *m_printer;
+    ContentSplitter m_splitter;
+    bool m_isStarted;
+
+    ScriptReportResources m_resources;
+    ScriptReportPageLayout::Sections m_startSections;
+    ScriptReportPageLayout::Sections m_endSections;
+    QString m_errorMessage;
+    QSize m_pageSize;
+    qreal m_scale;
+
+    // The statistics of the layout thread, read after it finishes
+    qint64 m_parseTime;
+    qint64 m_layoutTime;
+    qint64 m_paintTime;
+    int m_pageCount;
+
+    QMutex m_mutex;
+    QWaitCondition m_notEmpty;
+    QWaitCondition m_notFull;
+    QQueue<Item> m_queue;
+};
+
+#endif // SCRIPTREPORTPIPELINE_H
@@ -0,0 +1,406 @@
+/*
+ * Copyright 2010 and beyond, Juan Luis Paz
+ *
+ * This file is part of Script Report.
+ *
+ * Script Report is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Script Report is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with Script Report.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "scriptreportprofiler.h"
+
+#include <QElapsedTimer>
+#include <QFile>
+#include <QFileInfo>
+#include <QHash>
+#include <QPair>
+#include <QScriptContext>
+#include <QScriptContextInfo>
+#include <QScriptEngine>
+#include <QTextStream>
+#include <QVector>
+
+#include <algorithm>
+
+typedef QPair<QString, int> ScriptReportProfilerLine;
+
+class ScriptReportProfilerPrivate {
+public:
+    struct Frame {
+        QString key;
+        int stackKeyLength;
+        qint64 startTime;
+        QString callerFileName;
+        int callerLine;
+    };
+
+    ScriptReportProfilerPrivate() :
+            isActive(false),
+            previousAgent(0),
+            lastEventTime(0),
+            currentLine(-1)
+    {
+    }
+
+    // Adds the time since the last event to the current stack, function and line
+    void account() {
+        qint64 now = clock.nsecsElapsed();
+        qint64 elapsed = now - lastEventTime;
+        lastEventTime = now;
+        if (!stack.isEmpty()) {
+            stackTimes[stackKey] += elapsed;
+            functionStats[stack.last().key].selfTime += elapsed;
+        }
+        if (currentLine > 0) {
+            lineStats[ScriptReportProfilerLine(currentFileName, currentLine)].time += elapsed;
+        }
+    }
+
+    void popFrame() {
+        Frame frame = stack.takeLast();
+        functionStats[frame.key].totalTime += lastEventTime - frame.startTime;
+        stackKey.truncate(frame.stackKeyLength);
+        currentFileName = frame.callerFileName;
+        currentLine = frame.callerLine;
+    }
+
+    // The programs parsed before the profiler was started are not loaded again, their name is
+    // taken from the context
+    QString scriptFileName(qint64 scriptId, QScriptContext *context) {
+        if (scriptId == -1) {
+            return QString();
+        }
+        QHash<qint64, QString>::const_iterator i = scriptFileNames.constFind(scriptId);
+        if (i != scriptFileNames.constEnd()) {
+            return i.value();
+        }
+        QString name = QScriptContextInfo(context).fileName();
+        if (name.isEmpty()) {
+            name = QString::fromLatin1("<anonymous script>");
+        }
+        scriptFileNames.insert(scriptId, name);
+        return name;
+    }
+
+    QString sourceLine(const QString &fileName, int line) const {
+        QStringList lines = sourceLines.value(fileName);
+        if (lines.isEmpty() && programs.contains(fileName)) {
+            lines = programs.value(fileName).split(QChar::fromLatin1('\n'));
+        }
+        if (line < 1 || line > lines.size()) {
+            return QString();
+        }
+        return lines.at(line - 1).trimmed();
+    }
+
+    static bool lessLineTime(const ScriptReportProfiler::LineStats &a, const ScriptReportProfiler::LineStats &b) {
+        return a.time > b.time;
+    }
+
+    static bool lessFunctionTime(const ScriptReportProfiler::FunctionStats &a, const ScriptReportProfiler::FunctionStats &b) {
+        return a.selfTime > b.selfTime;
+    }
+
+    bool isActive;
+    QScriptEngineAgent *previousAgent;
+    QElapsedTimer clock;
+    qint64 lastEventTime;
+
+    QHash<qint64, QString> scriptFileNames;
+    QHash<QString, QString> programs;
+    QHash<QString, QStringList> sourceLines;
+
+    QVector<Frame> stack;
+    QString stackKey;
+    QString currentFileName;
+    int currentLine;
+
+    QHash<QString, qint64> stackTimes;
+    QHash<QString, ScriptReportProfiler::FunctionStats> functionStats;
+    QHash<ScriptReportProfilerLine, ScriptReportProfiler::LineStats> lineStats;
+};
+
+/*!
+    \class ScriptReportProfiler
+    \brief Profiler of the scripts of a report.
+
+    The ScriptReportProfiler class is an agent of the script engine that measures the time and the
+    number of calls of each function, and the time and the number of executions of each line of
+    the scripts. It is used by ScriptReport when ScriptReport::isProfilingEnabled is true:
+
+    \code
+    ScriptReport sr("myReport.srt");
+    sr.setProfilingEnabled(true);
+    sr.run();
+    sr.profiler()->writeCollapsedStacks("myReport.folded");
+    \endcode
+
+    The SourceTransformer keeps each line of the template in the same line of the intermediate
+    code, so the lines of the report are the lines of the \c .srt file. The time of a line
+    includes the native functions that it calls, but not the script functions, whose lines are
+    measured apart. The times are in nanoseconds.
+
+    Only one agent can be installed in an engine, the previous agent, like a debugger, is
+    replaced while the profiler is active.
+*/
+
+/*!
+    \fn ScriptReportProfiler::ScriptReportProfiler(QScriptEngine *engine)
+    Constructs a profiler for the \a engine, it is not active until \c start() is called.
+*/
+ScriptReportProfiler::ScriptReportProfiler(QScriptEngine *engine) :
+        QScriptEngineAgent(engine),
+        d(new ScriptReportProfilerPrivate())
+{
+}
+
+/*!
+    \fn ScriptReportProfiler::~ScriptReportProfiler()
+    Destroy the profiler.
+*/
+ScriptReportProfiler::~ScriptReportProfiler() {
+    stop();
+    delete d;
+}
+
+/*!
+    \fn void ScriptReportProfiler::start()
+    Installs the profiler in the engine and starts to measure.
+*/
+void ScriptReportProfiler::start() {
+    if (d->isActive) {
+        return;
+    }
+    d->isActive = true;
+    d->previousAgent = engine()->agent();
+    engine()->setAgent(this);
+    if (!d->clock.isValid()) {
+        d->clock.start();
+    }
+    d->lastEventTime = d->clock.nsecsElapsed();
+}
+
+/*!
+    \fn void ScriptReportProfiler::stop()
+    Stops to measure and restores the previous agent of the engine.
+*/
+void ScriptReportProfiler::stop() {
+    if (!d->isActive) {
+        return;
+    }
+    d->account();
+    while (!d->stack.isEmpty()) {
+        d->popFrame();
+    }
+    d->currentLine = -1;
+    d->isActive = false;
+    if (engine()->agent() == this) {
+        engine()->setAgent(d->previousAgent);
+    }
+    d->previousAgent = 0;
+}
+
+/*!
+    \fn bool ScriptReportProfiler::isActive() const
+    Returns true if the profiler is measuring.
+*/
+bool ScriptReportProfiler::isActive() const {
+    return d->isActive;
+}
+
+/*!
+    \fn void ScriptReportProfiler::clear()
+    Removes the measures.
+*/
+void ScriptReportProfiler::clear() {
+    d->stackTimes.clear();
+    d->functionStats.clear();
+    d->lineStats.clear();
+}
+
+/*!
+    \fn void ScriptReportProfiler::setSourceLines(const QString &fileName, const QStringList &lines)
+    Sets the source \a lines of the script \a fileName, they are shown by \c hotLines() instead of
+    the lines of the intermediate code, like the lines of the template of a report.
+*/
+void ScriptReportProfiler::setSourceLines(const QString &fileName, const QStringList &lines) {
+    d->sourceLines.insert(fileName, lines);
+}
+
+/*!
+    \fn QList<ScriptReportProfiler::LineStats> ScriptReportProfiler::lines() const
+    Returns the measures of the executed lines, the slowest first.
+*/
+QList<ScriptReportProfiler::LineStats> ScriptReportProfiler::lines() const {
+    QList<LineStats> lines = d->lineStats.values();
+    std::sort(lines.begin(), lines.end(), ScriptReportProfilerPrivate::lessLineTime);
+    return lines;
+}
+
+/*!
+    \fn QList<ScriptReportProfiler::FunctionStats> ScriptReportProfiler::functions() const
+    Returns the measures of the called functions, the slowest first by its own time. The total
+    time of a recursive function includes each of the recursive calls.
+*/
+QList<ScriptReportProfiler::FunctionStats> ScriptReportProfiler::functions() const {
+    QList<FunctionStats> functions = d->functionStats.values();
+    std::sort(functions.begin(), functions.end(), ScriptReportProfilerPrivate::lessFunctionTime);
+    return functions;
+}
+
+/*!
+    \fn QString ScriptReportProfiler::collapsedStacks() const
+    Returns the time of each stack of calls in the collapsed stacks format used by the flame graph
+    tools: a line for each stack with its functions separated by semicolons, the outermost first,
+    and the time in microseconds.
+*/
+QString ScriptReportProfiler::collapsedStacks() const {
+    QStringList stacks = d->stackTimes.keys();
+    stacks.sort();
+
+    QString result;
+    QTextStream out(&result, QIODevice::WriteOnly);
+    foreach (const QString &stack, stacks) {
+        qint64 time = d->stackTimes.value(stack) / 1000;
+        if (time > 0) {
+            // The stack key starts with a separator
+            out << stack.mid(1) << ' ' << time << '\n';
+        }
+    }
+    out.flush();
+    return result;
+}
+
+/*!
+    \fn bool ScriptReportProfiler::writeCollapsedStacks(const QString &fileName) const
+    Writes the collapsed stacks in the file \a fileName, returns false if the file can't be written.
+    \sa collapsedStacks()
+*/
+bool ScriptReportProfiler::writeCollapsedStacks(const QString &fileName) const {
+    QFile file(fileName);
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Text)) {
+        return false;
+    }
+    QTextStream out(&file);
+    out.setCodec("UTF-8");
+    out << collapsedStacks();
+    out.flush();
+    return file.error() == QFile::NoError;
+}
+
+/*!
+    \fn QString ScriptReportProfiler::hotLines(int maximumLines) const
+    Returns a text table with the \a maximumLines slowest lines, with its time, the percentage of
+    the time of all the lines, the number of executions and the source of the line.
+*/
+QString ScriptReportProfiler::hotLines(int maximumLines) const {
+    QList<LineStats> lines = this->lines();
+    qint64 totalTime = 0;
+    foreach (const LineStats &line, lines) {
+        totalTime += line.time;
+    }
+
+    QString result;
+    QTextStream out(&result, QIODevice::WriteOnly);
+    out << QString::fromLatin1("%1 %2 %3  %4\n")
+           .arg(QString::fromLatin1("Time (ms)"), 12)
+           .arg(QString::fromLatin1("%"), 7)
+           .arg(QString::fromLatin1("Hits"), 10)
+           .arg(QString::fromLatin1("Line"));
+    for (int i = 0; i < lines.size() && i < maximumLines; i++) {
+        const LineStats &line = lines.at(i);
+        double percent = totalTime > 0 ? line.time * 100.0 / totalTime : 0;
+        out << QString::fromLatin1("%1 %2% %3  %4:%5  %6\n")
+               .arg(line.time / 1000000.0, 12, 'f', 3)
+               .arg(percent, 6, 'f', 1)
+               .arg(line.hitCount, 10)
+               .arg(QFileInfo(line.fileName).fileName())
+               .arg(line.line)
+               .arg(d->sourceLine(line.fileName, line.line));
+    }
+    out.flush();
+    return result;
+}
+
+void ScriptReportProfiler::scriptLoad(qint64 id, const QString &program, const QString &fileName, int /*baseLineNumber*/) {
+    QString name = fileName.isEmpty() ? QString::fromLatin1("<anonymous script>") : fileName;
+    d->scriptFileNames.insert(id, name);
+    d->programs.insert(name, program);
+}
+
+void ScriptReportProfiler::functionEntry(qint64 scriptId) {
+    d->account();
+
+    QScriptContext *context = engine()->currentContext();
+    QScriptContextInfo info(context);
+    QString fileName = d->scriptFileName(scriptId, context);
+    QString name = info.functionName();
+    if (name.isEmpty()) {
+        if (!context->callee().isFunction()) {
+            name = QString::fromLatin1("<program>");
+        } else if (info.functionType() == QScriptContextInfo::ScriptFunction) {
+            name = QString::fromLatin1("<anonymous>");
+        } else {
+            name = QString::fromLatin1("<native>");
+        }
+    }
+    int line = info.functionStartLineNumber();
+
+    QString key;
+    if (fileName.isEmpty()) {
+        key = QString::fromLatin1("%1 (native)").arg(name);
+    } else if (line > 0) {
+        key = QString::fromLatin1("%1 (%2:%3)").arg(name, QFileInfo(fileName).fileName(), QString::number(line));
+    } else {
+        key = QString::fromLatin1("%1 (%2)").arg(name, QFileInfo(fileName).fileName());
+    }
+    // The semicolon separates the functions in the collapsed stacks
+    key.replace(QChar::fromLatin1(';'), QChar::fromLatin1(','));
+
+    FunctionStats &stats = d->functionStats[key];
+    if (stats.callCount == 0) {
+        stats.name = name;
+        stats.fileName = fileName;
+        stats.line = line;
+    }
+    stats.callCount++;
+
+    ScriptReportProfilerPrivate::Frame frame;
+    frame.key = key;
+    frame.stackKeyLength = d->stackKey.size();
+    frame.startTime = d->lastEventTime;
+    frame.callerFileName = d->currentFileName;
+    frame.callerLine = d->currentLine;
+    d->stack.append(frame);
+    d->stackKey.append(QChar::fromLatin1(';')).append(key);
+}
+
+void ScriptReportProfiler::functionExit(qint64 /*scriptId*/, const QScriptValue &/*returnValue*/) {
+    d->account();
+    if (!d->stack.isEmpty()) {
+        d->popFrame();
+    }
+}
+
+void ScriptReportProfiler::positionChange(qint64 scriptId, int lineNumber, int /*columnNumber*/) {
+    d->account();
+    d->currentFileName = d->scriptFileName(scriptId, engine()->currentContext());
+    d->currentLine = lineNumber;
+
+    LineStats &stats = d->lineStats[ScriptReportProfilerLine(d->currentFileName, lineNumber)];
+    if (stats.hitCount == 0) {
+        stats.fileName = d->currentFileName;
+        stats.line = lineNumber;
+    }
+    stats.hitCount++;
+}
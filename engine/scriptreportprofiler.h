@@ -0,0 +1,78 @@
+/*
+ * Copyright 2010 and beyond, Juan Luis Paz
+ *
+ * This file is part of Script Report.
+ *
+ * Script Report is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Script Report is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with Script Report.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef SCRIPTREPORTPROFILER_H
+#define SCRIPTREPORTPROFILER_H
+
+#include "scriptreportengine_global.h"
+
+#include <QList>
+#include <QScriptEngineAgent>
+#include <QStringList>
+
+class ScriptReportProfilerPrivate;
+
+class SCRIPTREPORTENGINE_EXPORT ScriptReportProfiler : public QScriptEngineAgent
+{
+public:
+    struct LineStats {
+        LineStats() : line(0), hitCount(0), time(0) {}
+        QString fileName;
+        int line;
+        int hitCount;
+        qint64 time;
+    };
+
+    struct FunctionStats {
+        FunctionStats() : line(0), callCount(0), totalTime(0), selfTime(0) {}
+        QString name;
+        QString fileName;
+        int line;
+        int callCount;
+        qint64 totalTime;
+        qint64 selfTime;
+    };
+
+    explicit ScriptReportProfiler(QScriptEngine *engine);
+    ~ScriptReportProfiler();
+
+    void start();
+    void stop();
+    bool isActive() const;
+    void clear();
+
+    void setSourceLines(const QString &fileName, const QStringList &lines);
+
+    QList<LineStats> lines() const;
+    QList<FunctionStats> functions() const;
+    QString collapsedStacks() const;
+    bool writeCollapsedStacks(const QString &fileName) const;
+    QString hotLines(int maximumLines = 20) const;
+
+    //overrides:
+    void scriptLoad(qint64 id, const QString &program, const QString &fileName, int baseLineNumber);
+    void functionEntry(qint64 scriptId);
+    void functionExit(qint64 scriptId, const QScriptValue &returnValue);
+    void positionChange(qint64 scriptId, int lineNumber, int columnNumber);
+
+private:
+    ScriptReportProfilerPrivate *d;
+};
+
+#endif // SCRIPTREPORTPROFILER_H
@@ -0,0 +1,191 @@
+/*
+ * Copyright 2010 and beyond, Juan Luis Paz
+ *
+ * This file is part of Script Report.
+ *
+ * Script Report is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Script Report is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with Script Report.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "scriptreportprogramcache.h"
+
+#include <QAtomicInt>
+#include <QCache>
+#include <QCryptographicHash>
+#include <QScriptEngine>
+
+/*
+ * Statics
+ */
+
+static QAtomicInt maximumProgramsSize(32 * 1024 * 1024);
+static QAtomicInt generation(0);
+static QAtomicInt programHits(0);
+static QAtomicInt programMisses(0);
+
+// The programs of one engine, it is a child of the engine, so it is only used in the engine's
+// thread and it is destroyed with the engine
+class EnginePrograms : public QObject {
+public:
+    explicit EnginePrograms(QScriptEngine *engine) :
+            QObject(engine),
+            generation(::generation.load())
+    {
+        setObjectName(name());
+    }
+
+    static QString name() {
+        return QString::fromLatin1("ScriptReportProgramCache");
+    }
+
+    int generation;
+    // The cost of each program is the size of its source code
+    QCache<QByteArray, QScriptProgram> programs;
+};
+
+static EnginePrograms *enginePrograms(QScriptEngine *engine) {
+    EnginePrograms *result = static_cast<EnginePrograms*>(
+            engine->findChild<QObject*>(EnginePrograms::name(), Qt::FindDirectChildrenOnly));
+    if (!result) {
+        result = new EnginePrograms(engine);
+    }
+
+    const int currentGeneration = generation.load();
+    if (result->generation != currentGeneration) {
+        // clear() was called
+        result->programs.clear();
+        result->generation = currentGeneration;
+    }
+    result->programs.setMaxCost(maximumProgramsSize.load());
+    return result;
+}
+
+/*!
+    \class ScriptReportProgramCache
+    \brief Class for reuse the parsed scripts.
+
+    The ScriptReportProgramCache class keep the QScriptProgram objects created for the scripts
+    evaluated by the reports: the intermediate code, the ScriptReport::previousScript and the
+    files loaded with \c sr.engine.load(). When the same script is evaluated again it is not
+    parsed again.
+
+    The programs are identified by a hash of the source code and the file name. A QScriptProgram
+    keeps the compiled code of the engine where it was evaluated, and it only can be used in the
+    engine's thread, therefore the programs are registered for each script engine and are
+    destroyed with it. The configuration and the counters are shared by all the engines in the
+    process, all the functions are thread-safe.
+
+    The cache is bypassed while the engine has a QScriptEngineAgent, like the ScriptReportProfiler
+    or the debugger: the programs are parsed again, they are not stored and the counters are not
+    changed.
+*/
+
+/*
+ * Class
+ */
+
+/*!
+    \fn QScriptProgram ScriptReportProgramCache::program(QScriptEngine *engine, const QString &sourceCode, const QString &fileName)
+    Returns the program with the source code \a sourceCode and the file name \a fileName for
+    be evaluated in \a engine, the program is created if it is not in the cache. This function
+    must be called from the thread of \a engine.
+*/
+QScriptProgram ScriptReportProgramCache::program(QScriptEngine *engine, const QString &sourceCode, const QString &fileName) {
+    if (engine->agent()) {
+        // A cached program wouldn't be seen by the profiler or the debugger, and the program
+        // compiled for them is slower, so it is not cached for the runs without an agent
+        return QScriptProgram(sourceCode, fileName);
+    }
+
+    QCryptographicHash hash(QCryptographicHash::Sha1);
+    hash.addData(fileName.toUtf8());
+    hash.addData(QByteArray(1, '\0'));
+    hash.addData(sourceCode.toUtf8());
+    const QByteArray key = hash.result();
+
+    EnginePrograms *programs = enginePrograms(engine);
+    QScriptProgram *cached = programs->programs.object(key);
+    if (cached) {
+        programHits.ref();
+        return *cached;
+    }
+
+    programMisses.ref();
+    QScriptProgram result(sourceCode, fileName);
+    // The copy shares the compiled code with result
+    programs->programs.insert(key, new QScriptProgram(result), qMax(1, sourceCode.size()));
+    return result;
+}
+
+/*!
+    \fn QScriptValue ScriptReportProgramCache::evaluate(QScriptEngine *engine, const QString &sourceCode, const QString &fileName)
+    Evaluate the program with the source code \a sourceCode and the file name \a fileName in
+    \a engine, like QScriptEngine::evaluate(), using the cached program if it exists.
+*/
+QScriptValue ScriptReportProgramCache::evaluate(QScriptEngine *engine, const QString &sourceCode, const QString &fileName) {
+    return engine->evaluate(program(engine, sourceCode, fileName));
+}
+
+/*!
+    \fn int ScriptReportProgramCache::maximumSize()
+    Returns the maximum total size, in characters of source code, of the programs cached for
+    each engine. By default it is 32M characters.
+*/
+int ScriptReportProgramCache::maximumSize() {
+    return maximumProgramsSize.load();
+}
+
+/*!
+    \fn void ScriptReportProgramCache::setMaximumSize(int maximumSize)
+    Set the maximum total size, in characters of source code, of the programs cached for each
+    engine to \a maximumSize, the least recently used programs are removed when it is exceeded.
+*/
+void ScriptReportProgramCache::setMaximumSize(int maximumSize) {
+    maximumProgramsSize.store(maximumSize);
+}
+
+/*!
+    \fn void ScriptReportProgramCache::clear()
+    Remove all the programs in the cache, the programs of each engine are removed the next time
+    the engine looks for a program.
+*/
+void ScriptReportProgramCache::clear() {
+    generation.ref();
+}
+
+/*!
+    \fn int ScriptReportProgramCache::hits()
+    Returns the number of programs found in the cache since the start of the process or the last
+    call to resetCounters().
+*/
+int ScriptReportProgramCache::hits() {
+    return programHits.load();
+}
+
+/*!
+    \fn int ScriptReportProgramCache::misses()
+    Returns the number of programs not found in the cache since the start of the process or the
+    last call to resetCounters().
+*/
+int ScriptReportProgramCache::misses() {
+    return programMisses.load();
+}
+
+/*!
+    \fn void ScriptReportProgramCache::resetCounters()
+    Set the hits and misses counters to zero.
+*/
+void ScriptReportProgramCache::resetCounters() {
+    programHits.store(0);
+    programMisses.store(0);
+}
@@ -0,0 +1,48 @@
+/*
+ * Copyright 2010 and beyond, Juan Luis Paz
+ *
+ * This file is part of Script Report.
+ *
+ * Script Report is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Script Report is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with Script Report.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef SCRIPTREPORTPROGRAMCACHE_H
+#define SCRIPTREPORTPROGRAMCACHE_H
+
+#include "scriptreportengine_global.h"
+
+#include <QScriptProgram>
+#include <QScriptValue>
+
+class QScriptEngine;
+
+class SCRIPTREPORTENGINE_EXPORT ScriptReportProgramCache
+{
+public:
+    static QScriptProgram program(QScriptEngine *engine, const QString &sourceCode, const QString &fileName = QString());
+    static QScriptValue evaluate(QScriptEngine *engine, const QString &sourceCode, const QString &fileName = QString());
+
+    static int maximumSize();
+    static void setMaximumSize(int maximumSize);
+    static void clear();
+
+    static int hits();
+    static int misses();
+    static void resetCounters();
+
+private:
+    ScriptReportProgramCache();
+};
+
+#endif // SCRIPTREPORTPROGRAMCACHE_H
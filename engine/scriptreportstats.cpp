@@ -0,0 +1,130 @@
+/*
+ * Copyright 2010 and beyond, Juan Luis Paz
+ *
+ * This file is part of Script Report.
+ *
+ * Script Report is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Script Report is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with Script Report.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "scriptreportstats.h"
+
+/*!
+    \class ScriptReportStats
+    \brief The timings and sizes of the phases of a report.
+
+    The statistics of a ScriptReport are available with ScriptReport::stats(), they describe the
+    last transformation, run and render of the report:
+
+    \list
+    \o \c transformTime, the transformation of the report to javascript, \c isTransformCached is
+       true if the intermediate code was loaded from the ScriptReportCache.
+    \o \c runTime, the evaluation of the previous script and the intermediate code.
+    \o \c parseTime, the parse of the HTML of the sections.
+    \o \c layoutTime, the layout of the documents in pages.
+    \o \c paintTime, the painting of the pages in the device, including the copies.
+    \endlist
+
+    The times are in nanoseconds, measured with QElapsedTimer. The sizes are the bytes used by the
+    text in memory: the input, the intermediate code, each output section and the biggest of them
+    in \c peakSectionSize. The \c pageCount is -1 until the report is rendered.
+
+    \sa ScriptReport::stats()
+*/
+
+/*!
+    \fn ScriptReportStats::ScriptReportStats()
+    Constructs empty statistics.
+*/
+ScriptReportStats::ScriptReportStats() :
+        transformTime(0),
+        runTime(0),
+        isTransformCached(false),
+        inputSize(0),
+        intermediateSize(0)
+{
+    clearOutput();
+}
+
+/*!
+    \fn void ScriptReportStats::clearOutput()
+    Clears the statistics of the run and the render, the transformation ones are kept.
+*/
+void ScriptReportStats::clearOutput() {
+    runTime = 0;
+    headerSize = 0;
+    headerFirstSize = 0;
+    headerLastSize = 0;
+    contentSize = 0;
+    footerSize = 0;
+    footerFirstSize = 0;
+    footerLastSize = 0;
+    peakSectionSize = 0;
+    resourceSize = 0;
+    resourceCount = 0;
+    clearRender();
+}
+
+/*!
+    \fn void ScriptReportStats::clearRender()
+    Clears the statistics of the render.
+*/
+void ScriptReportStats::clearRender() {
+    parseTime = 0;
+    layoutTime = 0;
+    paintTime = 0;
+    pageCount = -1;
+}
+
+/*!
+    \fn qint64 ScriptReportStats::totalTime() const
+    Returns the sum of the times of all the phases, in nanoseconds.
+*/
+qint64 ScriptReportStats::totalTime() const {
+    return transformTime + runTime + parseTime + layoutTime + paintTime;
+}
+
+/*!
+    \fn QJsonObject ScriptReportStats::toJson() const
+    Returns the statistics as a JSON object, the times are in milliseconds.
+*/
+QJsonObject ScriptReportStats::toJson() const {
+    QJsonObject times;
+    times.insert(QLatin1String("transform"), transformTime / 1000000.0);
+    times.insert(QLatin1String("run"), runTime / 1000000.0);
+    times.insert(QLatin1String("parse"), parseTime / 1000000.0);
+    times.insert(QLatin1String("layout"), layoutTime / 1000000.0);
+    times.insert(QLatin1String("paint"), paintTime / 1000000.0);
+    times.insert(QLatin1String("total"), totalTime() / 1000000.0);
+
+    QJsonObject sizes;
+    sizes.insert(QLatin1String("input"), double(inputSize));
+    sizes.insert(QLatin1String("intermediate"), double(intermediateSize));
+    sizes.insert(QLatin1String("header"), double(headerSize));
+    sizes.insert(QLatin1String("headerFirst"), double(headerFirstSize));
+    sizes.insert(QLatin1String("headerLast"), double(headerLastSize));
+    sizes.insert(QLatin1String("content"), double(contentSize));
+    sizes.insert(QLatin1String("footer"), double(footerSize));
+    sizes.insert(QLatin1String("footerFirst"), double(footerFirstSize));
+    sizes.insert(QLatin1String("footerLast"), double(footerLastSize));
+    sizes.insert(QLatin1String("peakSection"), double(peakSectionSize));
+    sizes.insert(QLatin1String("resources"), double(resourceSize));
+
+    QJsonObject stats;
+    stats.insert(QLatin1String("times"), times);
+    stats.insert(QLatin1String("sizes"), sizes);
+    stats.insert(QLatin1String("transformCached"), isTransformCached);
+    stats.insert(QLatin1String("resourceCount"), resourceCount);
+    stats.insert(QLatin1String("pageCount"), pageCount);
+    return stats;
+}
@@ -0,0 +1,61 @@
+/*
+ * Copyright 2010 and beyond, Juan Luis Paz
+ *
+ * This file is part of Script Report.
+ *
+ * Script Report is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Script Report is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with Script Report.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef SCRIPTREPORTSTATS_H
+#define SCRIPTREPORTSTATS_H
+
+#include "scriptreportengine_global.h"
+
+#include <QJsonObject>
+
+class SCRIPTREPORTENGINE_EXPORT ScriptReportStats
+{
+public:
+    ScriptReportStats();
+
+    void clearOutput();
+    void clearRender();
+    qint64 totalTime() const;
+    QJsonObject toJson() const;
+
+    // Times in nanoseconds
+    qint64 transformTime;
+    qint64 runTime;
+    qint64 parseTime;
+    qint64 layoutTime;
+    qint64 paintTime;
+    bool isTransformCached;
+
+    // Sizes in bytes
+    qint64 inputSize;
+    qint64 intermediateSize;
+    qint64 headerSize;
+    qint64 headerFirstSize;
+    qint64 headerLastSize;
+    qint64 contentSize;
+    qint64 footerSize;
+    qint64 footerFirstSize;
+    qint64 footerLastSize;
+    qint64 peakSectionSize;
+    qint64 resourceSize;
+    int resourceCount;
+    int pageCount;
+};
+
+#endif // SCRIPTREPORTSTATS_H
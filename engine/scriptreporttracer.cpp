@@ -0,0 +1,330 @@
+/*
+ * Copyright 2010 and beyond, Juan Luis Paz
+ *
+ * This file is part of Script Report.
+ *
+ * Script Report is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Script Report is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with Script Report.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "scriptreporttracer.h"
+
+#include <QAtomicInt>
+#include <QCoreApplication>
+#include <QElapsedTimer>
+#include <QHash>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QMutex>
+#include <QMutexLocker>
+#include <QSaveFile>
+#include <QThread>
+#include <QThreadStorage>
+#include <QVector>
+
+class ScriptReportTracerPrivate {
+public:
+    struct Event {
+        QString category;
+        QString name;
+        qint64 start;
+        qint64 duration;
+        int thread;
+        QJsonObject arguments;
+    };
+
+    ScriptReportTracerPrivate() :
+            threadCount(0)
+    {
+        timer.start();
+    }
+
+    int currentThread();
+
+    QAtomicInt isEnabled;
+    QElapsedTimer timer;
+
+    QMutex mutex;
+    QVector<Event> events;
+    QHash<int, QString> threadNames;
+    int threadCount;
+    QThreadStorage<int> threadIds;
+};
+
+Q_GLOBAL_STATIC(ScriptReportTracerPrivate, tracer)
+
+// Returns the id of the current thread in the trace, the first time that a thread is seen it is
+// registered with its object name, the mutex must be locked
+int ScriptReportTracerPrivate::currentThread() {
+    if (threadIds.hasLocalData()) {
+        return threadIds.localData();
+    }
+
+    int id = ++threadCount;
+    threadIds.setLocalData(id);
+
+    // The threads of a pool have the same object name, the id is appended
+    QThread *thread = QThread::currentThread();
+    QString name;
+    if (QCoreApplication::instance() && QCoreApplication::instance()->thread() == thread) {
+        name = QString::fromLatin1("Main thread");
+    } else if (thread->objectName().isEmpty()) {
+        name = QString::fromLatin1("Thread %1").arg(id);
+    } else {
+        name = QString::fromLatin1("%1 %2").arg(thread->objectName()).arg(id);
+    }
+    threadNames.insert(id, name);
+    return id;
+}
+
+/*!
+    \class ScriptReportTracer
+    \brief Class for record a timeline of the work done by the reports.
+
+    The ScriptReportTracer class collects spans of time, named events with a start and a
+    duration, in the Chrome \c trace_event format, so the timeline can be shown with
+    \c chrome://tracing or Perfetto. The tracing is disabled by default, when it is enabled the
+    spans of the transformation, the script run, the import of extensions, the HTML parse, the
+    layout and the paint of each page are recorded; the script extensions add the SQL queries
+    and the translations.
+
+    The spans are recorded for all the threads of the process, each thread has its own id in
+    the trace, so the work of the engines of a ScriptReportJobRunner or a
+    ScriptReportEnginePool is shown in parallel. All the functions are thread-safe.
+
+    The spans are usually created with a ScriptReportTraceSpan, that measures the time until it
+    is destroyed:
+
+    \code
+    ScriptReportTraceSpan span("layout", "setHtml");
+    document.setHtml(html);
+    \endcode
+
+    \sa ScriptReportTraceSpan
+*/
+
+/*
+ * Class
+ */
+
+/*!
+    \fn bool ScriptReportTracer::isEnabled()
+    Returns true if the spans are recorded.
+*/
+bool ScriptReportTracer::isEnabled() {
+    return tracer()->isEnabled.load() != 0;
+}
+
+/*!
+    \fn void ScriptReportTracer::setEnabled(bool enabled)
+    Enable or disable the record of the spans, the spans already recorded are kept.
+*/
+void ScriptReportTracer::setEnabled(bool enabled) {
+    tracer()->isEnabled.store(enabled ? 1 : 0);
+}
+
+/*!
+    \fn void ScriptReportTracer::clear()
+    Remove all the recorded spans.
+*/
+void ScriptReportTracer::clear() {
+    ScriptReportTracerPrivate *d = tracer();
+    QMutexLocker locker(&d->mutex);
+    d->events.clear();
+}
+
+/*!
+    \fn qint64 ScriptReportTracer::timestamp()
+    Returns the current time of the trace, in nanoseconds. It is the start time used by
+    addEvent().
+*/
+qint64 ScriptReportTracer::timestamp() {
+    return tracer()->timer.nsecsElapsed();
+}
+
+/*!
+    \fn void ScriptReportTracer::addEvent(const QString &category, const QString &name, qint64 start, qint64 duration, const QJsonObject &arguments)
+    Record a span of the current thread with the name \a name in the category \a category, it
+    started at \a start, returned by timestamp(), and lasted \a duration nanoseconds. The
+    \a arguments are shown with the span. Nothing is recorded if the tracing is disabled.
+*/
+void ScriptReportTracer::addEvent(const QString &category, const QString &name, qint64 start, qint64 duration, const QJsonObject &arguments) {
+    ScriptReportTracerPrivate *d = tracer();
+    if (!d->isEnabled.load()) {
+        return;
+    }
+
+    ScriptReportTracerPrivate::Event event;
+    event.category = category;
+    event.name = name;
+    event.start = start;
+    event.duration = duration;
+    event.arguments = arguments;
+
+    QMutexLocker locker(&d->mutex);
+    event.thread = d->currentThread();
+    d->events.append(event);
+}
+
+/*!
+    \fn void ScriptReportTracer::setThreadName(const QString &name)
+    Set the name shown in the trace for the current thread. By default the name is the object
+    name of the thread.
+*/
+void ScriptReportTracer::setThreadName(const QString &name) {
+    ScriptReportTracerPrivate *d = tracer();
+    QMutexLocker locker(&d->mutex);
+    d->threadNames.insert(d->currentThread(), name);
+}
+
+/*!
+    \fn int ScriptReportTracer::eventCount()
+    Returns the number of recorded spans.
+*/
+int ScriptReportTracer::eventCount() {
+    ScriptReportTracerPrivate *d = tracer();
+    QMutexLocker locker(&d->mutex);
+    return d->events.size();
+}
+
+/*!
+    \fn QByteArray ScriptReportTracer::toJson()
+    Returns the recorded spans as a JSON document in the Chrome \c trace_event format, the
+    times are in microseconds.
+*/
+QByteArray ScriptReportTracer::toJson() {
+    ScriptReportTracerPrivate *d = tracer();
+    const double pid = QCoreApplication::applicationPid();
+
+    QJsonArray traceEvents;
+    QMutexLocker locker(&d->mutex);
+
+    QHash<int, QString>::ConstIterator it;
+    for (it = d->threadNames.constBegin(); it != d->threadNames.constEnd(); ++it) {
+        QJsonObject arguments;
+        arguments.insert(QLatin1String("name"), it.value());
+
+        QJsonObject metadata;
+        metadata.insert(QLatin1String("name"), QLatin1String("thread_name"));
+        metadata.insert(QLatin1String("ph"), QLatin1String("M"));
+        metadata.insert(QLatin1String("pid"), pid);
+        metadata.insert(QLatin1String("tid"), it.key());
+        metadata.insert(QLatin1String("args"), arguments);
+        traceEvents.append(metadata);
+    }
+
+    foreach (const ScriptReportTracerPrivate::Event &event, d->events) {
+        QJsonObject object;
+        object.insert(QLatin1String("name"), event.name);
+        object.insert(QLatin1String("cat"), event.category);
+        object.insert(QLatin1String("ph"), QLatin1String("X"));
+        object.insert(QLatin1String("ts"), event.start / 1000.0);
+        object.insert(QLatin1String("dur"), event.duration / 1000.0);
+        object.insert(QLatin1String("pid"), pid);
+        object.insert(QLatin1String("tid"), event.thread);
+        if (!event.arguments.isEmpty()) {
+            object.insert(QLatin1String("args"), event.arguments);
+        }
+        traceEvents.append(object);
+    }
+    locker.unlock();
+
+    QJsonObject trace;
+    trace.insert(QLatin1String("traceEvents"), traceEvents);
+    trace.insert(QLatin1String("displayTimeUnit"), QLatin1String("ms"));
+    return QJsonDocument(trace).toJson(QJsonDocument::Compact);
+}
+
+/*!
+    \fn bool ScriptReportTracer::writeTrace(const QString &fileName)
+    Write the recorded spans to the file \a fileName in the format returned by toJson(). Returns
+    true if the file was written.
+*/
+bool ScriptReportTracer::writeTrace(const QString &fileName) {
+    QSaveFile file(fileName);
+    if (!file.open(QIODevice::WriteOnly)) {
+        return false;
+    }
+    file.write(toJson());
+    return file.commit();
+}
+
+/*!
+    \class ScriptReportTraceSpan
+    \brief Class for record a span of time in the ScriptReportTracer.
+
+    A ScriptReportTraceSpan takes the time when it is created and, if the tracing is enabled,
+    records a span in the ScriptReportTracer when it is destroyed. When the tracing is disabled
+    it only checks a flag, so it can be used in code that is run many times.
+
+    The category and the name given as \c{const char*} must be literal strings, they are not
+    copied.
+*/
+
+/*!
+    \fn ScriptReportTraceSpan::ScriptReportTraceSpan(const char *category, const char *name)
+    Starts a span with the name \a name in the category \a category.
+*/
+ScriptReportTraceSpan::ScriptReportTraceSpan(const char *category, const char *name) :
+        m_category(category),
+        m_name(name),
+        m_start(ScriptReportTracer::isEnabled() ? ScriptReportTracer::timestamp() : -1)
+{
+}
+
+/*!
+    \fn ScriptReportTraceSpan::ScriptReportTraceSpan(const char *category, const QString &name)
+    Starts a span with the name \a name in the category \a category.
+*/
+ScriptReportTraceSpan::ScriptReportTraceSpan(const char *category, const QString &name) :
+        m_category(category),
+        m_name(0),
+        m_start(ScriptReportTracer::isEnabled() ? ScriptReportTracer::timestamp() : -1)
+{
+    if (m_start >= 0) {
+        m_nameString = name;
+    }
+}
+
+/*!
+    \fn ScriptReportTraceSpan::~ScriptReportTraceSpan()
+    Ends the span and records it.
+*/
+ScriptReportTraceSpan::~ScriptReportTraceSpan() {
+    if (m_start < 0) {
+        return;
+    }
+    const qint64 end = ScriptReportTracer::timestamp();
+    ScriptReportTracer::addEvent(QString::fromLatin1(m_category),
+                                 m_name ? QString::fromLatin1(m_name) : m_nameString,
+                                 m_start, end - m_start, m_arguments);
+}
+
+/*!
+    \fn bool ScriptReportTraceSpan::isEnabled() const
+    Returns true if the span will be recorded, it can be used to avoid compute the arguments of
+    the span when the tracing is disabled.
+*/
+bool ScriptReportTraceSpan::isEnabled() const {
+    return m_start >= 0;
+}
+
+/*!
+    \fn void ScriptReportTraceSpan::setArgument(const QString &name, const QJsonValue &value)
+    Set the argument \a name of the span to \a value.
+*/
+void ScriptReportTraceSpan::setArgument(const QString &name, const QJsonValue &value) {
+    if (m_start >= 0) {
+        m_arguments.insert(name, value);
+    }
+}
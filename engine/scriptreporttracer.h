@@ -0,0 +1,67 @@
+/*
+ * Copyright 2010 and beyond, Juan Luis Paz
+ *
+ * This file is part of Script Report.
+ *
+ * Script Report is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Script Report is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with Script Report.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef SCRIPTREPORTTRACER_H
+#define SCRIPTREPORTTRACER_H
+
+#include "scriptreportengine_global.h"
+
+#include <QJsonObject>
+#include <QString>
+
+class SCRIPTREPORTENGINE_EXPORT ScriptReportTracer
+{
+public:
+    static bool isEnabled();
+    static void setEnabled(bool enabled);
+    static void clear();
+
+    static qint64 timestamp();
+    static void addEvent(const QString &category, const QString &name, qint64 start, qint64 duration, const QJsonObject &arguments = QJsonObject());
+    static void setThreadName(const QString &name);
+
+    static int eventCount();
+    static QByteArray toJson();
+    static bool writeTrace(const QString &fileName);
+
+private:
+    ScriptReportTracer();
+};
+
+class SCRIPTREPORTENGINE_EXPORT ScriptReportTraceSpan
+{
+public:
+    ScriptReportTraceSpan(const char *category, const char *name);
+    ScriptReportTraceSpan(const char *category, const QString &name);
+    ~ScriptReportTraceSpan();
+
+    bool isEnabled() const;
+    void setArgument(const QString &name, const QJsonValue &value);
+
+private:
+    Q_DISABLE_COPY(ScriptReportTraceSpan)
+
+    const char *m_category;
+    const char *m_name;
+    QString m_nameString;
+    qint64 m_start;
+    QJsonObject m_arguments;
+};
+
+#endif // SCRIPTREPORTTRACER_H
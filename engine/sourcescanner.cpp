@@ -0,0 +1,290 @@
+/*
+ * Copyright 2010 and beyond, Juan Luis Paz
+ *
+ * This file is part of Script Report.
+ *
+ * Script Report is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Script Report is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with Script Report.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "sourcescanner.h"
+
+#include <QAtomicInt>
+#include <QtAlgorithms>
+
+#if defined(Q_PROCESSOR_X86) && (defined(Q_CC_GNU) || defined(Q_CC_MSVC))
+#   define SOURCESCANNER_X86
+#   include <immintrin.h>
+#   if defined(Q_CC_MSVC)
+#       include <intrin.h>
+#   endif
+#endif
+
+#if defined(SOURCESCANNER_X86) && defined(Q_CC_GNU)
+#   define SOURCESCANNER_TARGET_SSE2 __attribute__((target("sse2")))
+#   define SOURCESCANNER_TARGET_AVX2 __attribute__((target("avx2")))
+#else
+#   define SOURCESCANNER_TARGET_SSE2
+#   define SOURCESCANNER_TARGET_AVX2
+#endif
+
+/*!
+    \class SourceScanner
+    \brief Class for find the delimiters in the source of a Script Report.
+
+    The SourceScanner class search the next character that belongs to a small set of characters,
+    it is used by the SourceTransformer to find the script delimiters (like <!--, ${, ?{, --> or })
+    and the characters that must be escaped in the html text.
+
+    When the processor supports it the characters are compared 16 (SSE2) or 32 (AVX2) at a time,
+    otherwise they are compared one by one. The instruction set is chosen at runtime, and can be
+    changed with setInstructionSet().
+*/
+
+/*
+ * Statics
+ */
+
+typedef const ushort *(*ScanFunction)(const ushort *begin, const ushort *end, const ushort *characters);
+
+static const ushort *scanScalar(const ushort *begin, const ushort *end, const ushort *characters) {
+    const ushort c1 = characters[0];
+    const ushort c2 = characters[1];
+    const ushort c3 = characters[2];
+    const ushort c4 = characters[3];
+
+    for (const ushort *p = begin; p < end; p++) {
+        const ushort u = *p;
+        if (u == c1 || u == c2 || u == c3 || u == c4) {
+            return p;
+        }
+    }
+    return end;
+}
+
+#if defined(SOURCESCANNER_X86)
+
+SOURCESCANNER_TARGET_SSE2
+static inline uint matchSse2(const ushort *p, const __m128i *c) {
+    const __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i *>(p));
+    const __m128i m1 = _mm_or_si128(_mm_cmpeq_epi16(v, c[0]), _mm_cmpeq_epi16(v, c[1]));
+    const __m128i m2 = _mm_or_si128(_mm_cmpeq_epi16(v, c[2]), _mm_cmpeq_epi16(v, c[3]));
+    // Two bits for each character
+    return uint(_mm_movemask_epi8(_mm_or_si128(m1, m2)));
+}
+
+SOURCESCANNER_TARGET_SSE2
+static const ushort *scanSse2(const ushort *begin, const ushort *end, const ushort *characters) {
+    __m128i c[4];
+    for (int i = 0; i < 4; i++) {
+        c[i] = _mm_set1_epi16(short(characters[i]));
+    }
+
+    const ushort *p = begin;
+    for (; end - p >= 16; p += 16) {
+        const uint m1 = matchSse2(p, c);
+        if (m1) {
+            return p + qCountTrailingZeroBits(m1) / 2;
+        }
+        const uint m2 = matchSse2(p + 8, c);
+        if (m2) {
+            return p + 8 + qCountTrailingZeroBits(m2) / 2;
+        }
+    }
+    if (end - p >= 8) {
+        const uint m = matchSse2(p, c);
+        if (m) {
+            return p + qCountTrailingZeroBits(m) / 2;
+        }
+        p += 8;
+    }
+    return scanScalar(p, end, characters);
+}
+
+SOURCESCANNER_TARGET_AVX2
+static inline uint matchAvx2(const ushort *p, const __m256i *c) {
+    const __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(p));
+    const __m256i m1 = _mm256_or_si256(_mm256_cmpeq_epi16(v, c[0]), _mm256_cmpeq_epi16(v, c[1]));
+    const __m256i m2 = _mm256_or_si256(_mm256_cmpeq_epi16(v, c[2]), _mm256_cmpeq_epi16(v, c[3]));
+    // Two bits for each character
+    return uint(_mm256_movemask_epi8(_mm256_or_si256(m1, m2)));
+}
+
+SOURCESCANNER_TARGET_AVX2
+static const ushort *scanAvx2(const ushort *begin, const ushort *end, const ushort *characters) {
+    __m256i c[4];
+    for (int i = 0; i < 4; i++) {
+        c[i] = _mm256_set1_epi16(short(characters[i]));
+    }
+
+    const ushort *p = begin;
+    for (; end - p >= 32; p += 32) {
+        const uint m1 = matchAvx2(p, c);
+        if (m1) {
+            return p + qCountTrailingZeroBits(m1) / 2;
+        }
+        const uint m2 = matchAvx2(p + 16, c);
+        if (m2) {
+            return p + 16 + qCountTrailingZeroBits(m2) / 2;
+        }
+    }
+    if (end - p >= 16) {
+        const uint m = matchAvx2(p, c);
+        if (m) {
+            return p + qCountTrailingZeroBits(m) / 2;
+        }
+        p += 16;
+    }
+    // Less than 16 characters left, clear the upper half of the AVX registers before run SSE2 code
+    _mm256_zeroupper();
+    return scanSse2(p, end, characters);
+}
+
+#endif // SOURCESCANNER_X86
+
+static SourceScanner::InstructionSet detectInstructionSet() {
+#if defined(SOURCESCANNER_X86) && defined(Q_CC_GNU)
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2")) {
+        return SourceScanner::Avx2;
+    }
+    if (__builtin_cpu_supports("sse2")) {
+        return SourceScanner::Sse2;
+    }
+#elif defined(SOURCESCANNER_X86) && defined(Q_CC_MSVC)
+    int info[4];
+    __cpuid(info, 0);
+    const int maximumId = info[0];
+    __cpuid(info, 1);
+    const bool sse2 = (info[3] & (1 << 26)) != 0;
+    const bool osxsave = (info[2] & (1 << 27)) != 0;
+    const bool avx = (info[2] & (1 << 28)) != 0;
+    // The operating system must save the AVX registers
+    if (maximumId >= 7 && osxsave && avx && (_xgetbv(0) & 6) == 6) {
+        __cpuidex(info, 7, 0);
+        if (info[1] & (1 << 5)) {
+            return SourceScanner::Avx2;
+        }
+    }
+    if (sse2) {
+        return SourceScanner::Sse2;
+    }
+#endif
+    return SourceScanner::Scalar;
+}
+
+static SourceScanner::InstructionSet supported() {
+    static const SourceScanner::InstructionSet instructionSet = detectInstructionSet();
+    return instructionSet;
+}
+
+static QAtomicInt &selected() {
+    static QAtomicInt instructionSet(supported());
+    return instructionSet;
+}
+
+static int scan(const QChar *data, int from, int size, const ushort *characters) {
+    if (from >= size) {
+        return size;
+    }
+
+    const ushort *begin = reinterpret_cast<const ushort *>(data);
+    const ushort *end = begin + size;
+    ScanFunction function;
+    switch (selected().load()) {
+#if defined(SOURCESCANNER_X86)
+    case SourceScanner::Avx2:
+        function = scanAvx2;
+        break;
+    case SourceScanner::Sse2:
+        function = scanSse2;
+        break;
+#endif
+    default:
+        function = scanScalar;
+    }
+    return int(function(begin + from, end, characters) - begin);
+}
+
+/*
+ * Class
+ */
+
+/*!
+    \fn int SourceScanner::indexOf(const QChar *data, int from, int size, const QChar &c)
+    Returns the index of the first occurrence of \a c in the \a size characters of \a data,
+    searching forward from index \a from. Returns \a size if \a c is not found.
+*/
+int SourceScanner::indexOf(const QChar *data, int from, int size, const QChar &c) {
+    const ushort characters[4] = { c.unicode(), c.unicode(), c.unicode(), c.unicode() };
+    return scan(data, from, size, characters);
+}
+
+/*!
+    \fn int SourceScanner::indexOfAny(const QChar *data, int from, int size, const QChar &c1, const QChar &c2)
+    Returns the index of the first occurrence of \a c1 or \a c2 in the \a size characters of
+    \a data, searching forward from index \a from. Returns \a size if none of them is found.
+*/
+int SourceScanner::indexOfAny(const QChar *data, int from, int size, const QChar &c1, const QChar &c2) {
+    const ushort characters[4] = { c1.unicode(), c2.unicode(), c2.unicode(), c2.unicode() };
+    return scan(data, from, size, characters);
+}
+
+/*!
+    \fn int SourceScanner::indexOfAny(const QChar *data, int from, int size, const QChar &c1, const QChar &c2, const QChar &c3)
+    Returns the index of the first occurrence of \a c1, \a c2 or \a c3 in the \a size characters
+    of \a data, searching forward from index \a from. Returns \a size if none of them is found.
+*/
+int SourceScanner::indexOfAny(const QChar *data, int from, int size, const QChar &c1, const QChar &c2,
+                              const QChar &c3) {
+    const ushort characters[4] = { c1.unicode(), c2.unicode(), c3.unicode(), c3.unicode() };
+    return scan(data, from, size, characters);
+}
+
+/*!
+    \fn int SourceScanner::indexOfAny(const QChar *data, int from, int size, const QChar &c1, const QChar &c2, const QChar &c3, const QChar &c4)
+    Returns the index of the first occurrence of \a c1, \a c2, \a c3 or \a c4 in the \a size
+    characters of \a data, searching forward from index \a from. Returns \a size if none of them
+    is found.
+*/
+int SourceScanner::indexOfAny(const QChar *data, int from, int size, const QChar &c1, const QChar &c2,
+                              const QChar &c3, const QChar &c4) {
+    const ushort characters[4] = { c1.unicode(), c2.unicode(), c3.unicode(), c4.unicode() };
+    return scan(data, from, size, characters);
+}
+
+/*!
+    \fn SourceScanner::InstructionSet SourceScanner::instructionSet()
+    Get the instruction set used for compare the characters.
+*/
+SourceScanner::InstructionSet SourceScanner::instructionSet() {
+    return InstructionSet(selected().load());
+}
+
+/*!
+    \fn void SourceScanner::setInstructionSet(InstructionSet instructionSet)
+    Set the instruction set used for compare the characters to \a instructionSet, if it is not
+    supported by the processor the best supported one is used. Is useful for compare the
+    speed of the instruction sets.
+*/
+void SourceScanner::setInstructionSet(InstructionSet instructionSet) {
+    selected().store(qMin(instructionSet, supported()));
+}
+
+/*!
+    \fn SourceScanner::InstructionSet SourceScanner::supportedInstructionSet()
+    Get the best instruction set supported by the processor.
+*/
+SourceScanner::InstructionSet SourceScanner::supportedInstructionSet() {
+    return supported();
+}
@@ -0,0 +1,51 @@
+/*
+ * Copyright 2010 and beyond, Juan Luis Paz
+ *
+ * This file is part of Script Report.
+ *
+ * Script Report is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Script Report is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with Script Report.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef SOURCESCANNER_H
+#define SOURCESCANNER_H
+
+#include <QChar>
+
+#include "scriptreportengine_global.h"
+
+class SCRIPTREPORTENGINE_EXPORT SourceScanner
+{
+public:
+    enum InstructionSet {
+        Scalar,
+        Sse2,
+        Avx2
+    };
+
+    static int indexOf(const QChar *data, int from, int size, const QChar &c);
+    static int indexOfAny(const QChar *data, int from, int size, const QChar &c1, const QChar &c2);
+    static int indexOfAny(const QChar *data, int from, int size, const QChar &c1, const QChar &c2,
+                          const QChar &c3);
+    static int indexOfAny(const QChar *data, int from, int size, const QChar &c1, const QChar &c2,
+                          const QChar &c3, const QChar &c4);
+
+    static InstructionSet instructionSet();
+    static void setInstructionSet(InstructionSet instructionSet);
+    static InstructionSet supportedInstructionSet();
+
+private:
+    SourceScanner();
+};
+
+#endif // SOURCESCANNER_H
@@ -18,25 +18,38 @@
  */
 
 #include "sourcetransformer.h"
+#include "sourcescanner.h"
+#include "scriptreporttracer.h"
 
 class SourceTransformerPrivate {
 public:
     SourceTransformerPrivate(QTextStream *inputStream, QTextStream *outputStream) :
-            in(inputStream), out(outputStream) {}
+            in(inputStream), out(outputStream), data(0), size(0), position(0) {}
 
     bool transform();
 
+    QChar at(int index) const;
+    int find(int from, const QChar &c) const;
+    int find(int from, const QChar &c1, const QChar &c2) const;
+    int findHtmlSpecial(int from) const;
+
     void consume();
+    void consumeTo(int index);
     void prepare();
     void writeAndConsume();
+    void writeRunAndConsume(int end);
     void writeHtmlAndConsume();
+    void writeHtmlRunAndConsume();
     void writeStartHtml();
     void writeEndHtml();
     void write(const QChar &c);
     void write(const QChar &c1, const QChar &c2);
     void write(const QString &s);
 
-    void writeHtmlChar(const QChar &c);
+    void writeHtml(const QChar *s, int length);
+
+    void updateInputPosition();
+    void updateOutputPosition();
 
     void readHtml();
     void readScript(bool writeEnd);
@@ -59,6 +72,32 @@ public:
     int outLine;
     int outColumn;
 
+    // The whole input is read in one block, next is always data[position]
+    QString source;
+    const QChar *data;
+    int size;
+    int position;
+    // The line and column counters are updated only when they are needed
+    int inCounted;
+    int outCounted;
+    QString output;
+};
+
+/*
+ * Statics
+ */
+
+// The character written after the backslash for the characters that must be escaped in a
+// javascript string, indexed by the character code
+static const char htmlEscapes[128] = {
+    0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   'n', 0,   0,   'r', 0,   0,
+    0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,
+    0,   0,   '"', 0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,
+    0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,
+    0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,
+    0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   '\\',0,   0,   0,
+    0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,
+    0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0
 };
 
 /*!
@@ -126,9 +165,25 @@ void SourceTransformer::setOutputStream(QTextStream *outputStream) {
 
     Read the Script Report from the input stream, transform it, and write the result in the
     output stream.
+
+    The input stream is read completely in one block before the transformation, and the
+    result is written to the output stream in one operation when the transformation ends.
 */
 bool SourceTransformer::transform() {
-    return d->transform();
+    ScriptReportTraceSpan span("transform", "SourceTransformer::transform");
+    bool result = d->transform();
+    span.setArgument(QString::fromLatin1("inputSize"), d->size);
+    return result;
+}
+
+/*!
+    \fn int SourceTransformer::version()
+    Returns the version of the transformation, it changes each time the generated javascript
+    changes for the same input.
+    \sa ScriptReportCache
+*/
+int SourceTransformer::version() {
+    return 1;
 }
 
 /*
@@ -149,37 +204,78 @@ bool SourceTransformerPrivate::transform() {
         return false;
     }
 
+    source = in->readAll();
+    // The stream based transformer stopped at the first null character
+    int end = source.indexOf(QChar());
+    if (end >= 0) {
+        source.truncate(end);
+    }
+    data = source.constData();
+    size = source.size();
+    position = 0;
+    inCounted = 0;
+    outCounted = 0;
+    output.clear();
+    output.reserve(size + size / 8 + first.size());
+
     write(first);
 
-    *in >> next;
+    next = at(0);
     if (next.isNull()) {
+        *out << output;
+        out->flush();
+        output.clear();
+        source.clear();
         return true;
     }
     consume();
     if (next.isNull()) {
         writeStartHtml();
-        writeHtmlChar(current);
+        writeHtml(&current, 1);
         writeEndHtml();
-        out->flush();
-        return true;
+    } else {
+        readHtml();
     }
-    readHtml();
+
+    *out << output;
     out->flush();
+    output.clear();
+    source.clear();
 
     return true;
 }
 
-void SourceTransformerPrivate::consume() {
-    const QChar n = QChar::fromLatin1('\n');
+QChar SourceTransformerPrivate::at(int index) const {
+    if (index < size) {
+        return data[index];
+    }
+    return QChar();
+}
+
+int SourceTransformerPrivate::find(int from, const QChar &c) const {
+    return SourceScanner::indexOf(data, from, size, c);
+}
+
+int SourceTransformerPrivate::find(int from, const QChar &c1, const QChar &c2) const {
+    return SourceScanner::indexOfAny(data, from, size, c1, c2);
+}
 
+int SourceTransformerPrivate::findHtmlSpecial(int from) const {
+    // The characters that can start a script in the html: <!--, ${ and ?{
+    return SourceScanner::indexOfAny(data, from, size, QChar::fromLatin1('<'), QChar::fromLatin1('$'),
+                                     QChar::fromLatin1('?'));
+}
+
+void SourceTransformerPrivate::consume() {
     current = next;
-    *in >> next;
-    if (current == n) {
-        inLine++;
-        inColumn = 0;
-    } else {
-        inColumn++;
-    }
+    position++;
+    next = at(position);
+}
+
+void SourceTransformerPrivate::consumeTo(int index) {
+    position = index + 1;
+    current = at(index);
+    next = at(position);
 }
 
 void SourceTransformerPrivate::prepare() {
@@ -192,12 +288,26 @@ void SourceTransformerPrivate::writeAndConsume() {
     consume();
 }
 
+void SourceTransformerPrivate::writeRunAndConsume(int end) {
+    const int start = position - 1;
+    output.append(data + start, end - start);
+    consumeTo(end);
+}
+
 void SourceTransformerPrivate::writeHtmlAndConsume() {
     writeStartHtml();
-    writeHtmlChar(current);
+    writeHtml(&current, 1);
     consume();
 }
 
+void SourceTransformerPrivate::writeHtmlRunAndConsume() {
+    const int start = position - 1;
+    const int end = findHtmlSpecial(position);
+    writeStartHtml();
+    writeHtml(data + start, end - start);
+    consumeTo(end);
+}
+
 void SourceTransformerPrivate::writeStartHtml() {
     const QString start = QString::fromLatin1("_(\"");
     if (!startHtmlWrited) {
@@ -216,15 +326,7 @@ void SourceTransformerPrivate::writeEndHtml() {
 }
 
 void SourceTransformerPrivate::write(const QChar &c) {
-    const QChar n = QChar::fromLatin1('\n');
-
-    *out << c;
-    if (c == n) {
-        outLine++;
-        outColumn = 0;
-    } else {
-        outColumn++;
-    }
+    output.append(c);
 }
 
 void SourceTransformerPrivate::write(const QChar &c1, const QChar &c2) {
@@ -233,32 +335,57 @@ void SourceTransformerPrivate::write(const QChar &c1, const QChar &c2) {
 }
 
 void SourceTransformerPrivate::write(const QString &s) {
-    for (int i = 0; i < s.size(); i++) {
-        write(s[i]);
+    output.append(s);
+}
+
+void SourceTransformerPrivate::writeHtml(const QChar *s, int length) {
+    const QChar cr = QChar::fromLatin1('\r');
+    const QChar lf = QChar::fromLatin1('\n');
+    const QChar quote = QChar::fromLatin1('"');
+    const QChar backslash = QChar::fromLatin1('\\');
+
+    // Copy the runs without characters to escape in one operation
+    int start = 0;
+    for (;;) {
+        const int i = SourceScanner::indexOfAny(s, start, length, cr, lf, quote, backslash);
+        output.append(s + start, i - start);
+        if (i >= length) {
+            break;
+        }
+        output.append(backslash);
+        output.append(QChar::fromLatin1(htmlEscapes[s[i].unicode()]));
+        start = i + 1;
     }
 }
 
-void SourceTransformerPrivate::writeHtmlChar(const QChar &c) {
-    const QChar r = QChar::fromLatin1('\r');
-    const QChar n = QChar::fromLatin1('\n');
-    const QChar q = QChar::fromLatin1('"');
-    const QChar s = QChar::fromLatin1('\\');
-
-    const QString r_ = QString::fromLatin1("\\r");
-    const QString n_ = QString::fromLatin1("\\n");
-    const QString q_ = QString::fromLatin1("\\\"");
-    const QString s_ = QString::fromLatin1("\\\\");
-
-    if (c == r) {
-        write(r_);
-    } else if (c == n) {
-        write(n_);
-    } else if (c == q) {
-        write(q_);
-    } else if (c == s) {
-        write(s_);
-    } else {
-        write(c);
+void SourceTransformerPrivate::updateInputPosition() {
+    // The input position counts the characters consumed, including the current
+    const int end = qMin(position, size);
+    for (; inCounted < end; inCounted++) {
+        if (data[inCounted].unicode() == '\n') {
+            inLine++;
+            inColumn = 0;
+        } else {
+            inColumn++;
+        }
+    }
+    if (inCounted < position) {
+        // null characters consumed past the end of the input
+        inColumn += position - inCounted;
+        inCounted = position;
+    }
+}
+
+void SourceTransformerPrivate::updateOutputPosition() {
+    const QChar *o = output.constData();
+    const int end = output.size();
+    for (; outCounted < end; outCounted++) {
+        if (o[outCounted].unicode() == '\n') {
+            outLine++;
+            outColumn = 0;
+        } else {
+            outColumn++;
+        }
     }
 }
 
@@ -304,7 +431,7 @@ void SourceTransformerPrivate::readHtml() {
                 continue;
             }
         } else if (current != s1) {
-            writeHtmlAndConsume();
+            writeHtmlRunAndConsume();
             continue;
         }
 
@@ -371,7 +498,7 @@ void SourceTransformerPrivate::readScript(bool writeEnd) {
     ajust();
     while (!current.isNull()) {
         if (current != e1) {
-            writeAndConsume();
+            writeRunAndConsume(find(position, e1));
             continue;
         }
 
@@ -402,7 +529,7 @@ void SourceTransformerPrivate::readInLineScript() {
     ajust();
     while (!current.isNull()) {
         if (current != ae1) {
-            writeAndConsume();
+            writeRunAndConsume(find(position, ae1));
             continue;
         }
 
@@ -643,7 +770,7 @@ void SourceTransformerPrivate::readChangeContext() {
 
     while (!current.isNull()) {
         if (current != e1) {
-            consume();
+            consumeTo(find(position, e1));
             continue;
         }
 
@@ -671,7 +798,7 @@ void SourceTransformerPrivate::readHtmlComment() {
     prepare();
     while (!current.isNull()) {
         if (current != e1) {
-            consume();
+            consumeTo(find(position, e1));
             continue;
         }
 
@@ -722,7 +849,7 @@ void SourceTransformerPrivate::readConditional() {
         }
 
         if (current != e1) {
-            writeAndConsume();
+            writeRunAndConsume(find(position, a1, e1));
             continue;
         }
 
@@ -759,7 +886,7 @@ void SourceTransformerPrivate::readConditionalText() {
     while (!current.isNull()) {
 
         if (current != e1) {
-            consume();
+            consumeTo(find(position, e1));
             continue;
         }
 
@@ -811,7 +938,7 @@ void SourceTransformerPrivate::readInlineConditional() {
         }
 
         if (current != e1) {
-            writeAndConsume();
+            writeRunAndConsume(find(position, a1, e1));
             continue;
         }
 
@@ -834,7 +961,7 @@ void SourceTransformerPrivate::readInlineConditionalText() {
     while (!current.isNull()) {
 
         if (current != e1) {
-            writeAndConsume();
+            writeRunAndConsume(find(position, e1));
             continue;
         }
 
@@ -849,17 +976,23 @@ void SourceTransformerPrivate::ajust() {
     const QChar n = QChar::fromLatin1('\n');
     const QChar sp = QChar::fromLatin1(' ');
 
+    updateInputPosition();
+    updateOutputPosition();
+
+    int lines = inLine - outLine;
     if (current == n) {
-        while (outLine < inLine - 1) {
-            write(n);
-        }
-    } else {
-        while (outLine < inLine) {
-            write(n);
-        }
+        lines--;
+    }
+    if (lines > 0) {
+        output.append(QString(lines, n));
+        outLine += lines;
+        outColumn = 0;
     }
 
-    while (outColumn < inColumn - 1) {
-        write(sp);
+    int columns = inColumn - 1 - outColumn;
+    if (columns > 0) {
+        output.append(QString(columns, sp));
+        outColumn += columns;
     }
+    outCounted = output.size();
 }
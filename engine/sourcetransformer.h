@@ -35,6 +35,8 @@ public:
 
     bool transform();
 
+    static int version();
+
     QTextStream *inputStream() const;
     void setInputStream(QTextStream *inputStream);
     QTextStream *outputStream() const;
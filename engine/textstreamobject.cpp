@@ -65,11 +65,22 @@ TextStreamObject::~TextStreamObject() {
     delete d;
 }
 
-//void TextStreamObject::reset() {
-//    d->streamText.clear();
-//    QTextStream *s = new QTextStream(&d->streamText, d->streamMode);
-//    setStream(s, true);
-//}
+/*!
+    \fn void TextStreamObject::reset()
+    Clear the text used by the default stream, the default stream is created again for start
+    at the beginning of the text. A stream set with setStream() is not changed.
+*/
+void TextStreamObject::reset() {
+    d->streamText.clear();
+    if (d->stream && d->stream->string() == &d->streamText) {
+        if (d->deleteStream) {
+            delete d->stream;
+        }
+        d->stream = 0;
+        d->deleteStream = false;
+    }
+    emit changed();
+}
 
 /*!
     \fn QTextStream* TextStreamObject::stream() const
@@ -92,11 +103,12 @@ void TextStreamObject::setStream(QTextStream* textStream, bool forDelete) {
     if (d->stream == textStream) {
         return;
     }
-    if (!d->stream && d->deleteStream) {
+    if (d->stream && d->deleteStream) {
         delete d->stream;
     }
     d->stream = textStream;
     d->deleteStream = forDelete;
+    emit changed();
 }
 
 /*!
@@ -113,8 +125,28 @@ QString TextStreamObject::text() const {
 */
 void TextStreamObject::setText(QString text) {
     d->streamText = text;
+    emit changed();
+}
+
+/*!
+    \fn QString TextStreamObject::takeText()
+    Flush the default stream and return its text, the text is removed from this object but the
+    stream continues writing at the end. This is used for consume the text while it is written.
+*/
+QString TextStreamObject::takeText() {
+    if (d->stream && d->stream->string() == &d->streamText) {
+        d->stream->flush();
+    }
+    QString text = d->streamText;
+    d->streamText.clear();
+    return text;
 }
 
+/*!
+    \fn void TextStreamObject::changed()
+    This signal is emitted when the stream or the text of the default stream is changed.
+*/
+
 /*!
     \fn QString TextStreamObject::name() const
     Get the stream name.
@@ -34,18 +34,22 @@ public:
     TextStreamObject(QString name, QIODevice::OpenMode defaultStreamMode, QObject* parent = 0);
     ~TextStreamObject();
 
-//    void reset();
+    void reset();
 
     QTextStream* stream() const;
     void setStream(QTextStream* textStream, bool forDelete = false);
 
     QString text() const;
     void setText(QString text);
+    QString takeText();
 
     QString name() const;
     QIODevice::OpenMode defaultStreamMode() const;
     bool isDeleteStreamEmabled() const;
 
+signals:
+    void changed();
+
 private:
     TextStreamObjectPrivate *d;
 };
@@ -27,6 +27,8 @@
 #include <QtCore/QString>
 #include <QtCore/QMetaEnum>
 
+#include <ScriptReport/ScriptReportTracer>
+
 ScriptableI18N::ScriptableI18N(QObject *parent) :
     QObject(parent),
     cachedTranslationContext(0)
@@ -212,6 +214,12 @@ QString ScriptableI18N::translate (QString context, QString sourceText, QString
         return result;
     }
 
+    ScriptReportTraceSpan span("i18n", "translate");
+    if (span.isEnabled()) {
+        span.setArgument(QString::fromLatin1("context"), context);
+        span.setArgument(QString::fromLatin1("sourceText"), sourceText);
+    }
+
     if (!translators.isEmpty()) {
         QList<ScriptableTranslator*>::ConstIterator it;
         ScriptableTranslator *translationFile;
@@ -24,6 +24,12 @@ TARGET = sri18n
 TEMPLATE = lib
 DESTDIR = ../../compiled/script
 CONFIG += plugin
+win32 {
+    LIBS += -L../../compiled -lscriptreportengine$${VERSION_MAJOR}
+} else {
+    LIBS += -L../../compiled -lscriptreportengine
+}
+INCLUDEPATH += ../../includes
 HEADERS += scriptreporti18n.h \
     scriptabletranslator.h \
     scriptablei18n.h \
@@ -0,0 +1,230 @@
+/*
+ * Copyright 2010 and beyond, Juan Luis Paz
+ *
+ * This file is part of Script Report.
+ *
+ * Script Report is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Script Report is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with Script Report.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "scriptableasyncquery.h"
+
+#include <QtScript/QScriptEngine>
+#include <QtScript/QScriptString>
+#include <QtSql/QSql>
+
+#include <ScriptReport/ScriptReportTracer>
+
+#include "scriptableerror.h"
+#include "sqlqueryprefetcher.h"
+
+void ScriptableAsyncQuery::throwError() const {
+    if (m_autoThrow) {
+        if (m_error.isValid()) {
+            context()->throwError(m_error.text());
+        }
+    }
+}
+
+// Moves to the next block of rows, returns false after the last one; then the thread is finished and
+// the error of the query, if any, is kept
+bool ScriptableAsyncQuery::takeBlock() {
+    if (!m_prefetcher) {
+        return false;
+    }
+    const int columns = fieldNames().size();
+    SqlQueryPrefetcher::Block block = m_prefetcher->takeBlock();
+    m_values = block.values;
+    m_row = 0;
+    m_rowCount = columns > 0 ? m_values.size() / columns : 0;
+    if (block.isEnd) {
+        m_error = block.error;
+        delete m_prefetcher;
+        m_prefetcher = 0;
+        return false;
+    }
+    return true;
+}
+
+// Returns the index of the field, the same than QSqlRecord::indexOf() but the names are looked up in
+// a hash first
+int ScriptableAsyncQuery::fieldIndex(const QString &field) {
+    if (m_fieldIndexes.isEmpty()) {
+        const QStringList names = fieldNames();
+        for (int i = names.size() - 1; i >= 0; i--) {
+            m_fieldIndexes.insert(names.at(i), i);
+        }
+    }
+    QHash<QString, int>::ConstIterator it = m_fieldIndexes.constFind(field);
+    if (it != m_fieldIndexes.constEnd()) {
+        return it.value();
+    }
+    for (int i = 0; i < m_fieldNames.size(); i++) {
+        if (m_fieldNames.at(i).compare(field, Qt::CaseInsensitive) == 0) {
+            m_fieldIndexes.insert(field, i);
+            return i;
+        }
+    }
+    return -1;
+}
+
+QScriptValue ScriptableAsyncQuery::fetch(int count, bool asObjects) {
+    QScriptEngine *eng = engine();
+    QScriptValue rows = eng->newArray();
+    ScriptReportTraceSpan span("sql", "fetchRows");
+
+    const QStringList names = fieldNames();
+    const int columns = names.size();
+    QVector<QScriptString> handles;
+    if (asObjects) {
+        handles.reserve(columns);
+        for (int i = 0; i < columns; i++) {
+            handles.append(eng->toStringHandle(names.at(i)));
+        }
+    }
+
+    quint32 row = 0;
+    while ((count < 0 || row < quint32(count)) && next()) {
+        QScriptValue values = asObjects ? eng->newObject() : eng->newArray(columns);
+        const int offset = m_row * columns;
+        for (int i = 0; i < columns; i++) {
+            QScriptValue value = eng->toScriptValue(m_values.at(offset + i));
+            if (asObjects) {
+                values.setProperty(handles.at(i), value);
+            } else {
+                values.setProperty(quint32(i), value);
+            }
+        }
+        rows.setProperty(row, values);
+        row++;
+    }
+    span.setArgument(QString::fromLatin1("rows"), int(row));
+    return rows;
+}
+
+ScriptableAsyncQuery::ScriptableAsyncQuery(SqlQueryPrefetcher *prefetcher, bool autoThrow, QObject *parent) :
+    QObject(parent), QScriptable(), m_prefetcher(prefetcher), m_autoThrow(autoThrow),
+    m_hasFieldNames(false), m_row(-1), m_rowCount(0), m_at(QSql::BeforeFirstRow)
+{
+}
+
+ScriptableAsyncQuery::~ScriptableAsyncQuery() {
+    delete m_prefetcher;
+}
+
+bool ScriptableAsyncQuery::isActive() const {
+    return m_at != QSql::AfterLastRow;
+}
+
+int ScriptableAsyncQuery::at() const {
+    return m_at;
+}
+
+// Returns the names of the fields of the result, waits until the query is executed
+QStringList ScriptableAsyncQuery::fieldNames() {
+    if (!m_hasFieldNames && m_prefetcher) {
+        m_fieldNames = m_prefetcher->fieldNames();
+        m_hasFieldNames = true;
+    }
+    return m_fieldNames;
+}
+
+ScriptableError* ScriptableAsyncQuery::lastError() const {
+    QSqlError error = m_error;
+    if (error.isValid()) {
+        return new ScriptableError(error, this->engine());
+    } else {
+        return 0;
+    }
+}
+
+bool ScriptableAsyncQuery::isNull(const QString& field) {
+    return isNull(fieldIndex(field));
+}
+
+bool ScriptableAsyncQuery::isNull(int field) const {
+    if (m_row < 0 || m_row >= m_rowCount || field < 0 || field >= m_fieldNames.size()) {
+        return true;
+    }
+    return m_values.at(m_row * m_fieldNames.size() + field).isNull();
+}
+
+QVariant ScriptableAsyncQuery::value(const QString& field) {
+    int index = fieldIndex(field);
+    if (index < 0 || m_row < 0 || m_row >= m_rowCount) {
+        if (m_autoThrow) {
+            context()->throwError(tr("Invalid field of name: '%1'").arg(field));
+        }
+        return QVariant();
+    }
+    return m_values.at(m_row * m_fieldNames.size() + index);
+}
+
+QVariant ScriptableAsyncQuery::value(int i) const {
+    if (i < 0 || i >= m_fieldNames.size() || m_row < 0 || m_row >= m_rowCount) {
+        if (m_autoThrow) {
+            context()->throwError(tr("Invalid field of index: '%1'").arg(i));
+        }
+        return QVariant();
+    }
+    return m_values.at(m_row * m_fieldNames.size() + i);
+}
+
+bool ScriptableAsyncQuery::next() {
+    if (m_at == QSql::AfterLastRow) {
+        return false;
+    }
+    m_row++;
+    while (m_row >= m_rowCount) {
+        if (!takeBlock()) {
+            m_values.clear();
+            m_row = -1;
+            m_rowCount = 0;
+            m_at = QSql::AfterLastRow;
+            throwError();
+            return false;
+        }
+    }
+    m_at++;
+    return true;
+}
+
+QScriptValue ScriptableAsyncQuery::fetchRows(int count, bool asObjects) {
+    if (count < 0) {
+        context()->throwError(tr("The number of rows can not be negative: %1").arg(count));
+        return QScriptValue();
+    }
+    return fetch(count, asObjects);
+}
+
+QScriptValue ScriptableAsyncQuery::fetchAll(bool asObjects) {
+    return fetch(-1, asObjects);
+}
+
+// Stops the query, the rest of the rows are discarded
+void ScriptableAsyncQuery::cancel() {
+    delete m_prefetcher;
+    m_prefetcher = 0;
+    m_values.clear();
+    m_row = -1;
+    m_rowCount = 0;
+    m_at = QSql::AfterLastRow;
+}
+
+bool ScriptableAsyncQuery::autoThrow() const {
+    return m_autoThrow;
+}
+
+void ScriptableAsyncQuery::setAutoThrow(bool autoThrow) {
+    m_autoThrow = autoThrow;
+}
@@ -0,0 +1,89 @@
+/*
+ * Copyright 2010 and beyond, Juan Luis Paz
+ *
+ * This file is part of Script Report.
+ *
+ * Script Report is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Script Report is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with Script Report.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef SCRIPTABLEASYNCQUERY_H
+#define SCRIPTABLEASYNCQUERY_H
+
+#include <QtCore/QObject>
+#include <QtCore/QVariant>
+#include <QtCore/QVector>
+#include <QtCore/QMetaType>
+#include <QtCore/QHash>
+#include <QtCore/QStringList>
+#include <QtScript/QScriptable>
+#include <QtScript/QScriptValue>
+#include <QtSql/QSqlError>
+
+class ScriptableError;
+class SqlQueryPrefetcher;
+
+class ScriptableAsyncQuery : public QObject, public QScriptable
+{
+    Q_OBJECT
+    Q_PROPERTY(bool isActive READ isActive)
+    Q_PROPERTY(int at READ at)
+    Q_PROPERTY(QStringList fieldNames READ fieldNames)
+    Q_PROPERTY(ScriptableError* lastError READ lastError)
+    Q_PROPERTY(bool autoThrow READ autoThrow WRITE setAutoThrow)
+
+public:
+    ScriptableAsyncQuery(SqlQueryPrefetcher *prefetcher, bool autoThrow, QObject *parent = 0);
+    ~ScriptableAsyncQuery();
+
+    bool isActive() const;
+    int at() const;
+    QStringList fieldNames();
+    ScriptableError* lastError() const;
+
+    Q_INVOKABLE bool isNull(const QString& field);
+    Q_INVOKABLE bool isNull(int field) const;
+    Q_INVOKABLE QVariant value(const QString& field);
+    Q_INVOKABLE QVariant value(int i) const;
+
+    Q_INVOKABLE bool next();
+    Q_INVOKABLE QScriptValue fetchRows(int count, bool asObjects = false);
+    Q_INVOKABLE QScriptValue fetchAll(bool asObjects = false);
+    Q_INVOKABLE void cancel();
+
+    bool autoThrow() const;
+    void setAutoThrow(bool autoThrow);
+
+private:
+    inline void throwError() const;
+    bool takeBlock();
+    int fieldIndex(const QString &field);
+    QScriptValue fetch(int count, bool asObjects);
+
+private:
+    SqlQueryPrefetcher *m_prefetcher;
+    bool m_autoThrow;
+    QStringList m_fieldNames;
+    QHash<QString, int> m_fieldIndexes;
+    bool m_hasFieldNames;
+    // The block with the current row, m_row is its index in the block
+    QVector<QVariant> m_values;
+    int m_row;
+    int m_rowCount;
+    int m_at;
+    QSqlError m_error;
+};
+
+Q_DECLARE_METATYPE(ScriptableAsyncQuery*)
+
+#endif // SCRIPTABLEASYNCQUERY_H
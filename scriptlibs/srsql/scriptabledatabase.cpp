@@ -19,15 +19,26 @@
 
 #include "scriptabledatabase.h"
 
+#include <QtCore/QJsonArray>
+#include <QtCore/QJsonDocument>
+#include <QtCore/QJsonObject>
+#include <QtCore/QMapIterator>
+#include <QtCore/QVector>
 #include <QtScript/QScriptEngine>
+#include <QtScript/QScriptString>
 #include <QtSql/QSqlDatabase>
 #include <QtSql/QSqlError>
 #include <QtSql/QSqlQuery>
 #include <QtSql/QSqlRecord>
 
+#include <ScriptReport/ScriptReportTracer>
+
+#include "scriptableasyncquery.h"
 #include "scriptableerror.h"
 #include "scriptablequery.h"
 #include "scriptablerecord.h"
+#include "sqlqueryprefetcher.h"
+#include "sqlresultcache.h"
 
 void ScriptableDatabase::throwError() const {
     if (m_autoThrow) {
@@ -38,8 +49,32 @@ void ScriptableDatabase::throwError() const {
     }
 }
 
+// The cache only releases the wrapper of the queries removed from it, they are deleted by the
+// garbage collector when the script doesn't use them any more. The workers of the job runner don't
+// have an event loop, so deleteLater() wouldn't delete them.
+void ScriptableDatabase::evictPrepared() {
+    while (m_preparedOrder.size() > m_preparedCacheSize) {
+        m_prepared.remove(m_preparedOrder.takeLast());
+    }
+}
+
+// Returns the key of the query in the SqlResultCache, the database is identified by its connection
+// parameters, not by the connection name, so the reports share the results of the same database.
+// Without a query returns the prefix of the keys of all the queries of the database
+QString ScriptableDatabase::cacheKey(const QString &query) const {
+    const QChar separator(0);
+    QString result = m_db->driverName() + separator + m_db->hostName() + separator
+            + QString::number(m_db->port()) + separator + m_db->databaseName() + separator
+            + m_db->userName() + separator + m_db->connectOptions() + separator;
+    if (!query.isEmpty()) {
+        result += query + separator;
+    }
+    return result;
+}
+
 ScriptableDatabase::ScriptableDatabase(QSqlDatabase &database, bool readonly, bool autoThrow, QObject *parent) :
-    QObject(parent), QScriptable(), m_readonly(readonly), m_autoThrow(autoThrow)
+    QObject(parent), QScriptable(), m_readonly(readonly), m_autoThrow(autoThrow),
+    m_preparedCacheSize(32), m_preparedHits(0), m_preparedMisses(0)
 {
     m_db = new QSqlDatabase(database);
 }
@@ -58,7 +93,28 @@ bool ScriptableDatabase::isReadOnly() const {
     return m_readonly;
 }
 
+// Binds values to the prepared query, values is a list with the positional values or a map with the
+// named values, the names can be written without the colon
+void ScriptableDatabase::bindValues(QSqlQuery &query, const QVariant &values) {
+    if (values.type() == QVariant::List) {
+        foreach (const QVariant &value, values.toList()) {
+            query.addBindValue(value);
+        }
+    } else if (values.type() == QVariant::Map) {
+        QMapIterator<QString, QVariant> i(values.toMap());
+        while (i.hasNext()) {
+            i.next();
+            if (i.key().startsWith(QLatin1Char(':'))) {
+                query.bindValue(i.key(), i.value());
+            } else {
+                query.bindValue(QLatin1Char(':') + i.key(), i.value());
+            }
+        }
+    }
+}
+
 bool ScriptableDatabase::open() {
+    clearPrepared();
     bool result = m_db->open();
     throwError();
     return result;
@@ -71,6 +127,7 @@ bool ScriptableDatabase::open(const QString &user, const QString &password) {
         }
         return false;
     }
+    clearPrepared();
     bool result = m_db->open(user, password);
     throwError();
     return result;
@@ -83,6 +140,7 @@ void ScriptableDatabase::close() {
         }
         return;
     }
+    clearPrepared();
     m_db->close();
     throwError();
 }
@@ -138,6 +196,8 @@ ScriptableRecord* ScriptableDatabase::record(const QString& tablename) {
 }
 
 ScriptableQuery* ScriptableDatabase::exec(const QString& query) {
+    ScriptReportTraceSpan span("sql", "exec");
+    span.setArgument(QString::fromLatin1("query"), query);
     QSqlQuery q = m_db->exec(query);
     if (m_autoThrow) {
         QSqlError error = m_db->lastError();
@@ -152,12 +212,158 @@ ScriptableQuery* ScriptableDatabase::exec(const QString& query) {
 }
 
 ScriptableQuery* ScriptableDatabase::query(const QString& query) {
+    ScriptReportTraceSpan span("sql", "exec");
+    span.setArgument(QString::fromLatin1("query"), query);
     QSqlQuery q(query, *m_db);
     // this must be the parent of the ScriptableQuery for prevent a message from qt
     // when the database is remove in ScriptableSql
     return new ScriptableQuery(q, m_autoThrow, this);
 }
 
+// Returns the query prepared with the SQL text query, it is reused while it is in the cache. A
+// reused query is finished, its previous result is released, and its values must be bound again.
+// The cache keeps the only wrapper of each query and returns it every time, so the query is not
+// deleted while it is in the cache.
+QScriptValue ScriptableDatabase::prepared(const QString& query) {
+    QHash<QString, QScriptValue>::Iterator it = m_prepared.find(query);
+    if (it != m_prepared.end()) {
+        ScriptableQuery *cached = qobject_cast<ScriptableQuery*>(it.value().toQObject());
+        if (cached) {
+            m_preparedHits++;
+            if (m_preparedOrder.first() != query) {
+                m_preparedOrder.removeOne(query);
+                m_preparedOrder.prepend(query);
+            }
+            cached->setAutoThrow(m_autoThrow);
+            cached->finish();
+            return it.value();
+        }
+        m_prepared.erase(it);
+        m_preparedOrder.removeOne(query);
+    }
+
+    m_preparedMisses++;
+    ScriptReportTraceSpan span("sql", "prepare");
+    span.setArgument(QString::fromLatin1("query"), query);
+    QSqlQuery q(*m_db);
+    if (!q.prepare(query)) {
+        if (m_autoThrow) {
+            context()->throwError(q.lastError().text());
+        }
+        // A failed query is not cached, its error is available in lastError
+        return qScriptValueFromValue(engine(), new ScriptableQuery(q, m_autoThrow, this));
+    }
+
+    QScriptValue result = qScriptValueFromValue(engine(), new ScriptableQuery(q, m_autoThrow, this));
+    m_prepared.insert(query, result);
+    m_preparedOrder.prepend(query);
+    evictPrepared();
+    return result;
+}
+
+void ScriptableDatabase::clearPrepared() {
+    m_preparedOrder.clear();
+    m_prepared.clear();
+}
+
+// Returns the rows of the query as a javascript array, like ScriptableQuery::fetchAll(). binds is an
+// array with the positional values or an object with the named values of the query. The rows are
+// taken from the cache shared by all the reports when the same query with the same values was
+// executed in the same database less than ttlSeconds ago; with a negative ttlSeconds they are kept
+// until they are invalidated or removed for make room for others
+QScriptValue ScriptableDatabase::cachedQuery(const QString& query, const QScriptValue &binds, int ttlSeconds, bool asObjects) {
+    ScriptReportTraceSpan span("sql", "cachedQuery");
+    span.setArgument(QString::fromLatin1("query"), query);
+
+    QVariant boundValues = binds.toVariant();
+    QByteArray valuesKey;
+    if (boundValues.type() == QVariant::List) {
+        valuesKey = QJsonDocument(QJsonArray::fromVariantList(boundValues.toList())).toJson(QJsonDocument::Compact);
+    } else if (boundValues.type() == QVariant::Map) {
+        valuesKey = QJsonDocument(QJsonObject::fromVariantMap(boundValues.toMap())).toJson(QJsonDocument::Compact);
+    }
+    QString key = cacheKey(query) + QString::fromUtf8(valuesKey);
+
+    SqlResultCache::ResultPointer cached = SqlResultCache::find(key);
+    span.setArgument(QString::fromLatin1("hit"), !cached.isNull());
+    if (!cached) {
+        QSqlQuery q(*m_db);
+        q.setForwardOnly(true);
+        bool ok = q.prepare(query);
+        if (ok) {
+            bindValues(q, boundValues);
+            ok = q.exec();
+        }
+        if (!ok) {
+            if (m_autoThrow) {
+                context()->throwError(q.lastError().text());
+            }
+            return engine()->newArray();
+        }
+
+        SqlResultCache::Result *result = new SqlResultCache::Result;
+        const QSqlRecord record = q.record();
+        const int columns = record.count();
+        for (int i = 0; i < columns; i++) {
+            result->fieldNames.append(record.fieldName(i));
+        }
+        while (q.next()) {
+            for (int i = 0; i < columns; i++) {
+                result->values.append(q.value(i));
+            }
+        }
+        result->values.squeeze();
+        cached = SqlResultCache::ResultPointer(result);
+        if (ttlSeconds != 0 && q.isSelect()) {
+            SqlResultCache::insert(key, cached, ttlSeconds);
+        }
+    }
+
+    QScriptEngine *eng = engine();
+    const int columns = cached->columnCount();
+    const int rowCount = cached->rowCount();
+    QVector<QScriptString> names;
+    if (asObjects) {
+        names.reserve(columns);
+        for (int i = 0; i < columns; i++) {
+            names.append(eng->toStringHandle(cached->fieldNames.at(i)));
+        }
+    }
+
+    QScriptValue rows = eng->newArray(rowCount);
+    for (int row = 0; row < rowCount; row++) {
+        QScriptValue values = asObjects ? eng->newObject() : eng->newArray(columns);
+        for (int i = 0; i < columns; i++) {
+            QScriptValue value = eng->toScriptValue(cached->value(row, i));
+            if (asObjects) {
+                values.setProperty(names.at(i), value);
+            } else {
+                values.setProperty(quint32(i), value);
+            }
+        }
+        rows.setProperty(quint32(row), values);
+    }
+    span.setArgument(QString::fromLatin1("rows"), rowCount);
+    return rows;
+}
+
+// Removes the results of the query from the cache of cachedQuery(), whatever its values are, or
+// all the results of this database if there is no query. Returns the number of results removed
+int ScriptableDatabase::invalidateCachedQuery(const QString& query) {
+    return SqlResultCache::invalidate(cacheKey(query));
+}
+
+// Returns a query that is executed in other thread with its own connection to the database, the rows
+// are read in blocks of blockSize rows while the script uses the previous ones. The connection has
+// the parameters of this one, the changes made in an uncommitted transaction are not visible to it
+ScriptableAsyncQuery* ScriptableDatabase::queryAsync(const QString& query, const QScriptValue &binds, int blockSize) {
+    SqlQueryPrefetcher *prefetcher = new SqlQueryPrefetcher(*m_db, query, binds.toVariant(), blockSize);
+    prefetcher->start();
+    // this must be the parent of the ScriptableAsyncQuery for stop the thread before the database
+    // is removed in ScriptableSql
+    return new ScriptableAsyncQuery(prefetcher, m_autoThrow, this);
+}
+
 bool ScriptableDatabase::transaction() {
     bool result = m_db->transaction();
     throwError();
@@ -279,6 +485,27 @@ void ScriptableDatabase::setAutoThrow(bool autoThrow) {
     m_autoThrow = autoThrow;
 }
 
+int ScriptableDatabase::preparedCacheSize() const {
+    return m_preparedCacheSize;
+}
+
+void ScriptableDatabase::setPreparedCacheSize(int size) {
+    m_preparedCacheSize = qMax(0, size);
+    evictPrepared();
+}
+
+int ScriptableDatabase::preparedCount() const {
+    return m_prepared.size();
+}
+
+int ScriptableDatabase::preparedHits() const {
+    return m_preparedHits;
+}
+
+int ScriptableDatabase::preparedMisses() const {
+    return m_preparedMisses;
+}
+
 QString ScriptableDatabase::toString() {
     return tr("Database name: %1").arg(m_db->databaseName());
 }
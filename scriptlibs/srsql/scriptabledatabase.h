@@ -23,10 +23,15 @@
 #include <QtCore/QObject>
 #include <QtCore/QMetaType>
 #include <QtCore/QStringList>
+#include <QtCore/QVariant>
+#include <QtCore/QHash>
 #include <QtScript/QScriptable>
+#include <QtScript/QScriptValue>
 
 class QSqlDatabase;
+class QSqlQuery;
 
+class ScriptableAsyncQuery;
 class ScriptableError;
 class ScriptableQuery;
 class ScriptableRecord;
@@ -47,6 +52,10 @@ class ScriptableDatabase : public QObject, public QScriptable
     Q_PROPERTY(QString connectOptions READ connectOptions WRITE setConnectOptions)
     Q_PROPERTY(QString connectionName READ connectionName)
     Q_PROPERTY(bool autoThrow READ autoThrow WRITE setAutoThrow)
+    Q_PROPERTY(int preparedCacheSize READ preparedCacheSize WRITE setPreparedCacheSize)
+    Q_PROPERTY(int preparedCount READ preparedCount)
+    Q_PROPERTY(int preparedHits READ preparedHits)
+    Q_PROPERTY(int preparedMisses READ preparedMisses)
 
 public:
     ScriptableDatabase(QSqlDatabase &database, bool readonly, bool autoThrow, QObject *parent = 0);
@@ -54,6 +63,7 @@ public:
 
     QSqlDatabase *db() const;
     bool isReadOnly() const;
+    static void bindValues(QSqlQuery &query, const QVariant &values);
 
     Q_INVOKABLE bool open();
     Q_INVOKABLE bool open(const QString &user, const QString &password);
@@ -68,6 +78,11 @@ public:
     Q_INVOKABLE ScriptableRecord* record(const QString& tablename);
     Q_INVOKABLE ScriptableQuery* exec(const QString& query = QString());
     Q_INVOKABLE ScriptableQuery* query(const QString& query = QString());
+    Q_INVOKABLE QScriptValue prepared(const QString& query);
+    Q_INVOKABLE void clearPrepared();
+    Q_INVOKABLE QScriptValue cachedQuery(const QString& query, const QScriptValue &binds = QScriptValue(), int ttlSeconds = 300, bool asObjects = false);
+    Q_INVOKABLE int invalidateCachedQuery(const QString& query = QString());
+    Q_INVOKABLE ScriptableAsyncQuery* queryAsync(const QString& query, const QScriptValue &binds = QScriptValue(), int blockSize = 1000);
 
     Q_INVOKABLE bool transaction();
     Q_INVOKABLE bool commit();
@@ -93,15 +108,30 @@ public:
     bool autoThrow() const;
     void setAutoThrow(bool autoThrow);
 
+    int preparedCacheSize() const;
+    void setPreparedCacheSize(int size);
+    int preparedCount() const;
+    int preparedHits() const;
+    int preparedMisses() const;
+
     Q_INVOKABLE QString toString();
 
 private:
     inline void throwError() const;
+    void evictPrepared();
+    QString cacheKey(const QString &query = QString()) const;
 
 private:
     QSqlDatabase* m_db;
     bool m_readonly;
     bool m_autoThrow;
+    // The wrappers of the prepared queries by their SQL, the most recently used first in
+    // m_preparedOrder
+    QHash<QString, QScriptValue> m_prepared;
+    QStringList m_preparedOrder;
+    int m_preparedCacheSize;
+    int m_preparedHits;
+    int m_preparedMisses;
 };
 
 Q_DECLARE_METATYPE(ScriptableDatabase*)
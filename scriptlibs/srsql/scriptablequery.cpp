@@ -23,7 +23,13 @@
 #include <QtSql/QSqlError>
 #include <QtSql/QSqlRecord>
 
+#include <QtCore/QDateTime>
+#include <QtCore/QLocale>
+#include <QtCore/QVector>
 #include <QtScript/QScriptEngine>
+#include <QtScript/QScriptString>
+
+#include <ScriptReport/ScriptReportTracer>
 
 #include "scriptableerror.h"
 #include "scriptablerecord.h"
@@ -37,13 +43,310 @@ void ScriptableQuery::throwError() const {
     }
 }
 
+// Records the rows fetched with next() as one span, from the first call until the last row or
+// the next execution of the query; the time spent in the driver is an argument of the span
+void ScriptableQuery::traceFetch() {
+    if (m_fetchStart < 0) {
+        return;
+    }
+    QJsonObject arguments;
+    arguments.insert(QLatin1String("query"), m_query->lastQuery());
+    arguments.insert(QLatin1String("rows"), m_fetchRows);
+    arguments.insert(QLatin1String("fetchTime"), m_fetchTime / 1000000.0);
+    ScriptReportTracer::addEvent(QString::fromLatin1("sql"), QString::fromLatin1("next"),
+                                 m_fetchStart, ScriptReportTracer::timestamp() - m_fetchStart,
+                                 arguments);
+    m_fetchStart = -1;
+    m_fetchTime = 0;
+    m_fetchRows = 0;
+}
+
+// Converts up to count rows, or all the rows if count is negative, from the current position to a
+// javascript array in one call. Each row is an array of the values, or an object with the field
+// names as properties if asObjects is true; the property names are created once for all the rows
+QScriptValue ScriptableQuery::fetch(int count, bool asObjects) {
+    QScriptEngine *eng = engine();
+    QScriptValue rows = eng->newArray();
+    if (!m_query->isActive() || !m_query->isSelect()) {
+        throwError();
+        return rows;
+    }
+
+    traceFetch();
+    ScriptReportTraceSpan span("sql", "fetchRows");
+
+    const QSqlRecord record = m_query->record();
+    const int columns = record.count();
+    QVector<QScriptString> names;
+    if (asObjects) {
+        names.reserve(columns);
+        for (int i = 0; i < columns; i++) {
+            names.append(eng->toStringHandle(record.fieldName(i)));
+        }
+    }
+
+    quint32 row = 0;
+    while ((count < 0 || row < quint32(count)) && m_query->next()) {
+        QScriptValue values = asObjects ? eng->newObject() : eng->newArray(columns);
+        for (int i = 0; i < columns; i++) {
+            QScriptValue value = eng->toScriptValue(m_query->value(i));
+            if (asObjects) {
+                values.setProperty(names.at(i), value);
+            } else {
+                values.setProperty(quint32(i), value);
+            }
+        }
+        rows.setProperty(row, values);
+        row++;
+    }
+    span.setArgument(QString::fromLatin1("rows"), int(row));
+    throwError();
+    return rows;
+}
+
+// A part of a row template of renderRows(), a literal text followed by a field, if field is not -1
+struct RowTemplatePart {
+    enum Format {
+        Raw,
+        Escape,
+        Number,
+        Date,
+        Time,
+        DateTime
+    };
+
+    RowTemplatePart() : field(-1), format(Raw), decimals(-1) {}
+
+    QString text;
+    int field;
+    Format format;
+    int decimals;
+    QString pattern;
+};
+
+static QString formatValue(const QVariant &value, const RowTemplatePart &part, const QLocale &locale) {
+    if (value.isNull()) {
+        return QString();
+    }
+    switch (part.format) {
+    case RowTemplatePart::Escape:
+        return value.toString().toHtmlEscaped();
+    case RowTemplatePart::Number:
+        if (part.decimals >= 0) {
+            return locale.toString(value.toDouble(), 'f', part.decimals);
+        }
+        switch (value.type()) {
+        case QVariant::Int:
+        case QVariant::UInt:
+        case QVariant::LongLong:
+        case QVariant::ULongLong:
+            return locale.toString(value.toLongLong());
+        default:
+            return locale.toString(value.toDouble());
+        }
+    case RowTemplatePart::Date:
+        if (part.pattern.isEmpty()) {
+            return locale.toString(value.toDate(), QLocale::ShortFormat);
+        }
+        return locale.toString(value.toDate(), part.pattern);
+    case RowTemplatePart::Time:
+        if (part.pattern.isEmpty()) {
+            return locale.toString(value.toTime(), QLocale::ShortFormat);
+        }
+        return locale.toString(value.toTime(), part.pattern);
+    case RowTemplatePart::DateTime:
+        if (part.pattern.isEmpty()) {
+            return locale.toString(value.toDateTime(), QLocale::ShortFormat);
+        }
+        return locale.toString(value.toDateTime(), part.pattern);
+    default:
+        return value.toString();
+    }
+}
+
+// Parses a row template, the placeholders are {field} or {field|format}, where field is a name or
+// an index, and format is raw, escape, number, number:DECIMALS, date, time or datetime, with an
+// optional :PATTERN. {{ and }} are literal braces. Returns false and the error message if it fails.
+bool ScriptableQuery::parseRowTemplate(const QString &rowTemplate, QList<RowTemplatePart> &parts, QString &errorMessage) const {
+    RowTemplatePart part;
+    const int size = rowTemplate.size();
+    int i = 0;
+    while (i < size) {
+        const QChar c = rowTemplate.at(i);
+        if ((c == QLatin1Char('{') || c == QLatin1Char('}')) && i + 1 < size && rowTemplate.at(i + 1) == c) {
+            part.text.append(c);
+            i += 2;
+            continue;
+        }
+        if (c != QLatin1Char('{')) {
+            part.text.append(c);
+            i++;
+            continue;
+        }
+
+        const int end = rowTemplate.indexOf(QLatin1Char('}'), i + 1);
+        if (end < 0) {
+            errorMessage = tr("Missing '}' in the row template at %1").arg(i);
+            return false;
+        }
+        const QString placeholder = rowTemplate.mid(i + 1, end - i - 1);
+        i = end + 1;
+
+        QString fieldName = placeholder;
+        QString format;
+        const int bar = placeholder.indexOf(QLatin1Char('|'));
+        if (bar >= 0) {
+            fieldName = placeholder.left(bar).trimmed();
+            format = placeholder.mid(bar + 1).trimmed();
+        } else {
+            fieldName = fieldName.trimmed();
+        }
+
+        bool isIndex = false;
+        part.field = fieldName.toInt(&isIndex);
+        if (!isIndex) {
+            part.field = fieldIndex(fieldName);
+        }
+        if (part.field < 0 || part.field >= m_query->record().count()) {
+            errorMessage = tr("Invalid field of name: '%1'").arg(fieldName);
+            return false;
+        }
+
+        QString argument;
+        const int colon = format.indexOf(QLatin1Char(':'));
+        if (colon >= 0) {
+            argument = format.mid(colon + 1);
+            format = format.left(colon);
+        }
+        if (format.isEmpty() || format == QLatin1String("raw")) {
+            part.format = RowTemplatePart::Raw;
+        } else if (format == QLatin1String("escape")) {
+            part.format = RowTemplatePart::Escape;
+        } else if (format == QLatin1String("number")) {
+            part.format = RowTemplatePart::Number;
+            if (!argument.isEmpty()) {
+                bool ok = false;
+                part.decimals = argument.toInt(&ok);
+                if (!ok || part.decimals < 0) {
+                    errorMessage = tr("Invalid number of decimals: '%1'").arg(argument);
+                    return false;
+                }
+            }
+        } else if (format == QLatin1String("date")) {
+            part.format = RowTemplatePart::Date;
+            part.pattern = argument;
+        } else if (format == QLatin1String("time")) {
+            part.format = RowTemplatePart::Time;
+            part.pattern = argument;
+        } else if (format == QLatin1String("datetime")) {
+            part.format = RowTemplatePart::DateTime;
+            part.pattern = argument;
+        } else {
+            errorMessage = tr("Invalid format: '%1'").arg(format);
+            return false;
+        }
+
+        parts.append(part);
+        part = RowTemplatePart();
+    }
+    if (!part.text.isEmpty()) {
+        parts.append(part);
+    }
+    return true;
+}
+
+// Writes up to count rows, or all the rows if count is negative, from the current position with
+// the row template. The html is written with the writer function in blocks, or appended to output
+// if the writer is not a function. Returns the number of rows, or -1 if the template is invalid.
+int ScriptableQuery::render(const QString &rowTemplate, int count, QScriptValue writer, QString &output) {
+    if (!m_query->isActive() || !m_query->isSelect()) {
+        throwError();
+        return 0;
+    }
+
+    QList<RowTemplatePart> parts;
+    QString errorMessage;
+    if (!parseRowTemplate(rowTemplate, parts, errorMessage)) {
+        context()->throwError(errorMessage);
+        return -1;
+    }
+
+    traceFetch();
+    ScriptReportTraceSpan span("sql", "renderRows");
+
+    const int blockSize = 64 * 1024;
+    const bool isWritten = writer.isFunction();
+    const QLocale locale;
+    if (isWritten) {
+        output.reserve(blockSize + rowTemplate.size() * 2);
+    }
+
+    int rows = 0;
+    while ((count < 0 || rows < count) && m_query->next()) {
+        foreach (const RowTemplatePart &part, parts) {
+            output.append(part.text);
+            if (part.field >= 0) {
+                output.append(formatValue(m_query->value(part.field), part, locale));
+            }
+        }
+        rows++;
+        if (isWritten && output.size() >= blockSize) {
+            writer.call(QScriptValue(), QScriptValueList() << QScriptValue(output));
+            output.resize(0);
+            if (engine()->hasUncaughtException()) {
+                return rows;
+            }
+        }
+    }
+    if (isWritten && !output.isEmpty()) {
+        writer.call(QScriptValue(), QScriptValueList() << QScriptValue(output));
+        output.clear();
+    }
+    span.setArgument(QString::fromLatin1("rows"), rows);
+    throwError();
+    return rows;
+}
+
+// Returns the index of the field with name field in the current result set, or -1. The names are
+// looked up with QSqlRecord::indexOf the first time, it ignores the case and the table prefix
+int ScriptableQuery::fieldIndex(const QString &field) const {
+    QHash<QString, int>::ConstIterator it = m_fieldIndexes.constFind(field);
+    if (it != m_fieldIndexes.constEnd()) {
+        return it.value();
+    }
+    if (m_fieldIndexes.isEmpty()) {
+        const QSqlRecord record = m_query->record();
+        for (int i = record.count() - 1; i >= 0; i--) {
+            m_fieldIndexes.insert(record.fieldName(i), i);
+        }
+        it = m_fieldIndexes.constFind(field);
+        if (it != m_fieldIndexes.constEnd()) {
+            return it.value();
+        }
+    }
+    int index = m_query->record().indexOf(field);
+    m_fieldIndexes.insert(field, index);
+    return index;
+}
+
+// Called when the query is executed, prepared or moved to other result set
+void ScriptableQuery::resetResultCache() {
+    m_fieldIndexes.clear();
+    m_record = 0;
+    m_recordValue = QScriptValue();
+    m_recordAt = QSql::BeforeFirstRow;
+}
+
 ScriptableQuery::ScriptableQuery(QSqlQuery &query, bool autoThrow, QObject *parent) :
-    QObject(parent), QScriptable(), m_autoThrow(autoThrow)
+    QObject(parent), QScriptable(), m_autoThrow(autoThrow),
+    m_fetchStart(-1), m_fetchTime(0), m_fetchRows(0),
+    m_recordAt(QSql::BeforeFirstRow)
 {
     m_query = new QSqlQuery(query);
 }
 
 ScriptableQuery::~ScriptableQuery() {
+    traceFetch();
     delete m_query;
 }
 
@@ -56,6 +359,10 @@ bool ScriptableQuery::isActive() const {
 }
 
 bool ScriptableQuery::isNull(const QString& field) const {
+    int index = fieldIndex(field);
+    if (index >= 0 && m_query->isValid()) {
+        return m_query->isNull(index);
+    }
     return m_query->record().isNull(field);
 }
 
@@ -100,25 +407,50 @@ void ScriptableQuery::setForwardOnly(bool forward) {
     m_query->setForwardOnly(forward);
 }
 
-ScriptableRecord* ScriptableQuery::record() const {
-    QSqlRecord record = m_query->record();
-    return new ScriptableRecord(record, m_autoThrow, engine());
+// The record is created once for each result set, only its values are updated when the query
+// is moved to other row: it is a live view of the current row, next() overwrites the values read
+// before, so a script must copy them to keep them. The same wrapper is returned each time, the
+// record is deleted when the wrapper is collected after the query moves to other result set.
+QScriptValue ScriptableQuery::record() const {
+    if (!m_record) {
+        QSqlRecord record = m_query->record();
+        m_record = new ScriptableRecord(record, m_autoThrow, engine());
+        m_recordValue = qScriptValueFromValue(engine(), m_record.data());
+        m_recordAt = m_query->at();
+    } else if (m_recordAt != m_query->at()) {
+        if (m_query->isValid()) {
+            for (int i = m_record->count() - 1; i >= 0; i--) {
+                m_record->setValue(i, m_query->value(i));
+            }
+        } else {
+            m_record->clearValues();
+        }
+        m_recordAt = m_query->at();
+    }
+    m_record->setAutoThrow(m_autoThrow);
+    return m_recordValue;
 }
 
 bool ScriptableQuery::exec(const QString& query) {
+    traceFetch();
+    resetResultCache();
+    ScriptReportTraceSpan span("sql", "exec");
+    span.setArgument(QString::fromLatin1("query"), query);
     bool result = m_query->exec(query);
     throwError();
     return result;
 }
 
 QVariant ScriptableQuery::value(const QString& field) const {
-    QVariant result = m_query->record().value(field);
+    int index = fieldIndex(field);
+    QVariant result;
+    if (index >= 0 && m_query->isValid()) {
+        result = m_query->value(index);
+    } else {
+        result = m_query->record().value(field);
+    }
     throwError();
     if (m_autoThrow) {
-        QSqlError error = m_query->lastError();
-        if (error.isValid()) {
-            context()->throwError(error.text());
-        }
         if (!result.isValid()) {
             context()->throwError(tr("Invalid field of name: '%1'").arg(field));
         }
@@ -130,10 +462,6 @@ QVariant ScriptableQuery::value(int i) const {
     QVariant result = m_query->value(i);
     throwError();
     if (m_autoThrow) {
-        QSqlError error = m_query->lastError();
-        if (error.isValid()) {
-            context()->throwError(error.text());
-        }
         if (!result.isValid()) {
             context()->throwError(tr("Invalid field of index: '%1'").arg(i));
         }
@@ -148,11 +476,56 @@ bool ScriptableQuery::seek(int i, bool relative) {
 }
 
 bool ScriptableQuery::next() {
+    const bool isTraced = ScriptReportTracer::isEnabled();
+    qint64 start = 0;
+    if (isTraced) {
+        start = ScriptReportTracer::timestamp();
+        if (m_fetchStart < 0) {
+            m_fetchStart = start;
+        }
+    }
     bool result = m_query->next();
+    if (isTraced) {
+        m_fetchTime += ScriptReportTracer::timestamp() - start;
+        if (result) {
+            m_fetchRows++;
+        } else {
+            traceFetch();
+        }
+    }
     throwError();
     return result;
 }
 
+QScriptValue ScriptableQuery::fetchRows(int count, bool asObjects) {
+    if (count < 0) {
+        context()->throwError(tr("The number of rows can not be negative: %1").arg(count));
+        return QScriptValue();
+    }
+    return fetch(count, asObjects);
+}
+
+QScriptValue ScriptableQuery::fetchAll(bool asObjects) {
+    return fetch(-1, asObjects);
+}
+
+// The rows are written in the current section, with the _ function of the report
+int ScriptableQuery::renderRows(const QString &rowTemplate, int count) {
+    QString output;
+    QScriptValue writer = engine()->globalObject().property(QString::fromLatin1("_"));
+    if (!writer.isFunction()) {
+        context()->throwError(tr("renderRows() can only be used in a script report, use formatRows()"));
+        return 0;
+    }
+    return render(rowTemplate, count, writer, output);
+}
+
+QString ScriptableQuery::formatRows(const QString &rowTemplate, int count) {
+    QString output;
+    render(rowTemplate, count, QScriptValue(), output);
+    return output;
+}
+
 bool ScriptableQuery::previous() {
     bool result = m_query->previous();
     throwError();
@@ -172,11 +545,19 @@ bool ScriptableQuery::last() {
 }
 
 void ScriptableQuery::clear() {
+    traceFetch();
+    resetResultCache();
     m_query->clear();
     throwError();
 }
 
 bool ScriptableQuery::exec() {
+    traceFetch();
+    resetResultCache();
+    ScriptReportTraceSpan span("sql", "exec");
+    if (span.isEnabled()) {
+        span.setArgument(QString::fromLatin1("query"), m_query->lastQuery());
+    }
     bool result = m_query->exec();
     throwError();
     return result;
@@ -193,6 +574,12 @@ bool ScriptableQuery::execBatch(QString mode) {
         return false;
     }
 
+    traceFetch();
+    resetResultCache();
+    ScriptReportTraceSpan span("sql", "execBatch");
+    if (span.isEnabled()) {
+        span.setArgument(QString::fromLatin1("query"), m_query->lastQuery());
+    }
     bool result = m_query->execBatch(executionMode);
     throwError();
     return result;
@@ -200,6 +587,7 @@ bool ScriptableQuery::execBatch(QString mode) {
 
 
 bool ScriptableQuery::prepare(const QString& query) {
+    resetResultCache();
     bool result = m_query->prepare(query);
     throwError();
     return result;
@@ -249,11 +637,13 @@ QVariant ScriptableQuery::lastInsertId() const {
 }
 
 void ScriptableQuery::finish() {
+    traceFetch();
     m_query->finish();
     throwError();
 }
 
 bool ScriptableQuery::nextResult() {
+    resetResultCache();
     bool result = m_query->nextResult();
     throwError();
     return result;
@@ -23,12 +23,16 @@
 #include <QtCore/QObject>
 #include <QtCore/QVariant>
 #include <QtCore/QMetaType>
+#include <QtCore/QHash>
+#include <QtCore/QPointer>
 #include <QtScript/QScriptable>
+#include <QtScript/QScriptValue>
 
 class QSqlQuery;
 
 class ScriptableError;
 class ScriptableRecord;
+struct RowTemplatePart;
 
 class ScriptableQuery : public QObject, public QScriptable
 {
@@ -64,7 +68,7 @@ public:
     bool isForwardOnly() const;
     void setForwardOnly(bool forward);
 
-    Q_INVOKABLE ScriptableRecord* record() const;
+    Q_INVOKABLE QScriptValue record() const;
     Q_INVOKABLE bool exec(const QString& query);
     Q_INVOKABLE QVariant value(const QString& field) const;
     Q_INVOKABLE QVariant value(int i) const;
@@ -74,6 +78,10 @@ public:
 
     Q_INVOKABLE bool seek(int i, bool relative = false);
     Q_INVOKABLE bool next();
+    Q_INVOKABLE QScriptValue fetchRows(int count, bool asObjects = false);
+    Q_INVOKABLE QScriptValue fetchAll(bool asObjects = false);
+    Q_INVOKABLE int renderRows(const QString &rowTemplate, int count = -1);
+    Q_INVOKABLE QString formatRows(const QString &rowTemplate, int count = -1);
     Q_INVOKABLE bool previous();
     Q_INVOKABLE bool first();
     Q_INVOKABLE bool last();
@@ -104,10 +112,24 @@ public:
 
 private:
     inline void throwError() const;
+    void traceFetch();
+    QScriptValue fetch(int count, bool asObjects);
+    bool parseRowTemplate(const QString &rowTemplate, QList<RowTemplatePart> &parts, QString &errorMessage) const;
+    int render(const QString &rowTemplate, int count, QScriptValue writer, QString &output);
+    int fieldIndex(const QString &field) const;
+    void resetResultCache();
 
 private:
     QSqlQuery *m_query;
     bool m_autoThrow;
+    qint64 m_fetchStart;
+    qint64 m_fetchTime;
+    int m_fetchRows;
+    // The field indexes and the record of the current result set
+    mutable QHash<QString, int> m_fieldIndexes;
+    mutable QPointer<ScriptableRecord> m_record;
+    mutable QScriptValue m_recordValue;
+    mutable int m_recordAt;
 };
 
 Q_DECLARE_METATYPE(ScriptableQuery*)
@@ -108,3 +108,11 @@ bool ScriptableRecord::autoThrow() const {
 void ScriptableRecord::setAutoThrow(bool autoThrow) {
     m_autoThrow = autoThrow;
 }
+
+void ScriptableRecord::setValue(int i, const QVariant &value) {
+    m_record->setValue(i, value);
+}
+
+void ScriptableRecord::clearValues() {
+    m_record->clearValues();
+}
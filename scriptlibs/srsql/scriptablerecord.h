@@ -61,6 +61,9 @@ public:
     bool autoThrow() const;
     void setAutoThrow(bool autoThrow);
 
+    void setValue(int i, const QVariant &value);
+    void clearValues();
+
 private:
     QSqlRecord *m_record;
     bool m_autoThrow;
@@ -24,6 +24,8 @@
 #include <QtScript/QScriptEngine>
 
 #include "scriptabledatabase.h"
+#include "sqlconnectionpool.h"
+#include "sqlresultcache.h"
 
 const char*ScriptableSql::defaultConnection = "qt_sql_default_connection";
 
@@ -33,6 +35,7 @@ ScriptableSql::ScriptableSql(QObject *parent) :
 }
 
 ScriptableSql::~ScriptableSql() {
+    checkInPooled();
     QMapIterator<QString, ScriptableDatabase *> i(m_connections);
     while (i.hasNext()) {
         i.next();
@@ -61,6 +64,81 @@ void ScriptableSql::setAutoThrow(bool autoThrow) {
     m_autoThrow = autoThrow;
 }
 
+// The cache of the results of ScriptableDatabase::cachedQuery() is shared by all the reports in
+// the process, its size is in bytes
+int ScriptableSql::queryCacheMaximumSize() const {
+    return SqlResultCache::maximumSize();
+}
+
+void ScriptableSql::setQueryCacheMaximumSize(int size) {
+    SqlResultCache::setMaximumSize(size);
+}
+
+int ScriptableSql::queryCacheSize() const {
+    return SqlResultCache::size();
+}
+
+int ScriptableSql::queryCacheCount() const {
+    return SqlResultCache::count();
+}
+
+int ScriptableSql::queryCacheHits() const {
+    return SqlResultCache::hits();
+}
+
+int ScriptableSql::queryCacheMisses() const {
+    return SqlResultCache::misses();
+}
+
+void ScriptableSql::clearQueryCache() {
+    SqlResultCache::clear();
+}
+
+void ScriptableSql::resetQueryCacheCounters() {
+    SqlResultCache::resetCounters();
+}
+
+// The pool of connections for the threads other than the main thread is shared by all the reports in
+// the process, the idle timeout is in seconds
+int ScriptableSql::poolMaximumSize() const {
+    return SqlConnectionPool::maximumSize();
+}
+
+void ScriptableSql::setPoolMaximumSize(int size) {
+    SqlConnectionPool::setMaximumSize(size);
+}
+
+int ScriptableSql::poolIdleTimeout() const {
+    return SqlConnectionPool::idleTimeout();
+}
+
+void ScriptableSql::setPoolIdleTimeout(int seconds) {
+    SqlConnectionPool::setIdleTimeout(seconds);
+}
+
+int ScriptableSql::poolSize() const {
+    return SqlConnectionPool::size();
+}
+
+int ScriptableSql::poolIdleCount() const {
+    return SqlConnectionPool::idleCount();
+}
+
+// Returns the pooled connection used for connectionName to the pool, the ScriptableDatabase must be
+// deleted before because it keeps the connection in use
+void ScriptableSql::checkIn(const QString &connectionName) {
+    delete m_connections.take(connectionName);
+    SqlConnectionPool::checkIn(m_pooled.take(connectionName));
+}
+
+// Returns all the pooled connections, it is called when the engine is recycled for other report
+// because a pooled engine is not destroyed
+void ScriptableSql::checkInPooled() {
+    foreach (const QString &connectionName, m_pooled.keys()) {
+        checkIn(connectionName);
+    }
+}
+
 bool ScriptableSql::contains(const QString &connectionName) {
     return QSqlDatabase::contains(connectionName);
 }
@@ -70,6 +148,10 @@ bool ScriptableSql::isDriverAvailable(const QString &name) {
 }
 
 void ScriptableSql::removeDatabase(const QString &connectionName) {
+    if (m_pooled.contains(connectionName)) {
+        checkIn(connectionName);
+        return;
+    }
     ScriptableDatabase* old = m_connections.take(connectionName);
     if (old) {
         if (!old->isReadOnly()) {
@@ -135,6 +217,23 @@ ScriptableDatabase* ScriptableSql::database(const QString &connectionName, bool
         return result;
     }
 
+    if (SqlConnectionPool::isPooled(connectionName)) {
+        // The named connection belongs to other thread, this thread uses a clone of it
+        QString pooledName = SqlConnectionPool::checkOut(connectionName);
+        if (pooledName.isEmpty()) {
+            m_connections.remove(connectionName);
+            if (m_autoThrow) {
+                context()->throwError(tr("There is no connection '%1' available in the pool").arg(connectionName));
+            }
+            return 0;
+        }
+        QSqlDatabase db = QSqlDatabase::database(pooledName, open);
+        result = new ScriptableDatabase(db, true, m_autoThrow, this);
+        m_connections.insert(connectionName, result);
+        m_pooled.insert(connectionName, pooledName);
+        return result;
+    }
+
     QSqlDatabase db = QSqlDatabase::database(connectionName, open);
     result = new ScriptableDatabase(db, true, m_autoThrow, this);
     m_connections.insert(connectionName, result);
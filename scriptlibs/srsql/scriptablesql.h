@@ -34,6 +34,15 @@ class ScriptableSql : public QObject, public QScriptable
     Q_PROPERTY(QStringList connectionNames READ connectionNames)
     Q_PROPERTY(QStringList drivers READ drivers)
     Q_PROPERTY(bool autoThrow READ autoThrow WRITE setAutoThrow)
+    Q_PROPERTY(int queryCacheMaximumSize READ queryCacheMaximumSize WRITE setQueryCacheMaximumSize)
+    Q_PROPERTY(int queryCacheSize READ queryCacheSize)
+    Q_PROPERTY(int queryCacheCount READ queryCacheCount)
+    Q_PROPERTY(int queryCacheHits READ queryCacheHits)
+    Q_PROPERTY(int queryCacheMisses READ queryCacheMisses)
+    Q_PROPERTY(int poolMaximumSize READ poolMaximumSize WRITE setPoolMaximumSize)
+    Q_PROPERTY(int poolIdleTimeout READ poolIdleTimeout WRITE setPoolIdleTimeout)
+    Q_PROPERTY(int poolSize READ poolSize)
+    Q_PROPERTY(int poolIdleCount READ poolIdleCount)
 
 public:
     explicit ScriptableSql(QObject *parent = 0);
@@ -45,6 +54,22 @@ public:
     bool autoThrow() const;
     void setAutoThrow(bool autoThrow);
 
+    int queryCacheMaximumSize() const;
+    void setQueryCacheMaximumSize(int size);
+    int queryCacheSize() const;
+    int queryCacheCount() const;
+    int queryCacheHits() const;
+    int queryCacheMisses() const;
+    Q_INVOKABLE void clearQueryCache();
+    Q_INVOKABLE void resetQueryCacheCounters();
+
+    int poolMaximumSize() const;
+    void setPoolMaximumSize(int size);
+    int poolIdleTimeout() const;
+    void setPoolIdleTimeout(int seconds);
+    int poolSize() const;
+    int poolIdleCount() const;
+
     Q_INVOKABLE bool contains(const QString &connectionName = QLatin1String(defaultConnection));
     Q_INVOKABLE bool isDriverAvailable(const QString &name);
     Q_INVOKABLE void removeDatabase(const QString &connectionName);
@@ -53,9 +78,17 @@ public:
     Q_INVOKABLE ScriptableDatabase* cloneDatabase(const ScriptableDatabase &other, const QString &connectionName);
     Q_INVOKABLE ScriptableDatabase* database(const QString &connectionName = QLatin1String(defaultConnection), bool open = true);
 
+private slots:
+    void checkInPooled();
+
+private:
+    void checkIn(const QString &connectionName);
+
 private:
     static const char *defaultConnection;
     QMap<QString, ScriptableDatabase*> m_connections;
+    // The names of the connections checked out from the SqlConnectionPool by the requested names
+    QMap<QString, QString> m_pooled;
     bool m_autoThrow;
 };
 
@@ -21,7 +21,10 @@
 
 #include <QtScript/QScriptEngine>
 
+#include <ScriptReport/ScriptReport>
+
 #include "scriptablesql.h"
+#include "scriptableasyncquery.h"
 #include "scriptabledatabase.h"
 #include "scriptableerror.h"
 #include "scriptablequery.h"
@@ -55,6 +58,14 @@ static void queryFromScriptValue(const QScriptValue &object, ScriptableQuery* &o
     out = qobject_cast<ScriptableQuery*>(object.toQObject());
 }
 
+static QScriptValue asyncQueryToScriptValue(QScriptEngine *engine, ScriptableAsyncQuery* const &in) {
+    return engine->newQObject(in, QScriptEngine::ScriptOwnership, QScriptEngine::ExcludeChildObjects | QScriptEngine::ExcludeSuperClassContents | QScriptEngine::ExcludeDeleteLater);
+}
+
+static void asyncQueryFromScriptValue(const QScriptValue &object, ScriptableAsyncQuery* &out) {
+    out = qobject_cast<ScriptableAsyncQuery*>(object.toQObject());
+}
+
 static QScriptValue recordToScriptValue(QScriptEngine *engine, ScriptableRecord* const &in) {
     return engine->newQObject(in, QScriptEngine::ScriptOwnership, QScriptEngine::ExcludeChildObjects | QScriptEngine::ExcludeSuperClassContents | QScriptEngine::ExcludeDeleteLater);
 }
@@ -81,6 +92,7 @@ void ScriptReportSql::initialize(const QString &key, QScriptEngine *engine) {
         qScriptRegisterMetaType(engine, databaseToScriptValue, databaseFromScriptValue);
         qScriptRegisterMetaType(engine, errorToScriptValue, errorFromScriptValue);
         qScriptRegisterMetaType(engine, queryToScriptValue, queryFromScriptValue);
+        qScriptRegisterMetaType(engine, asyncQueryToScriptValue, asyncQueryFromScriptValue);
         qScriptRegisterMetaType(engine, recordToScriptValue, recordFromScriptValue);
 
         QScriptValue sr = setupPackage(QString::fromLatin1("sr"), engine);
@@ -88,6 +100,8 @@ void ScriptReportSql::initialize(const QString &key, QScriptEngine *engine) {
         ScriptableSql *scriptableSql = new ScriptableSql(engine);
         QScriptValue sql = engine->newQObject(scriptableSql, QScriptEngine::QtOwnership, QScriptEngine::ExcludeChildObjects | QScriptEngine::ExcludeSuperClassContents | QScriptEngine::ExcludeDeleteLater);
         sr.setProperty(QString::fromLatin1("sql"), sql, QScriptValue::Undeletable);
+        // The connections checked out by a report are returned when its pooled engine is reused
+        ScriptReport::addRecycleHandler(engine, scriptableSql, "checkInPooled");
 
     }
 }
@@ -0,0 +1,239 @@
+/*
+ * Copyright 2010 and beyond, Juan Luis Paz
+ *
+ * This file is part of Script Report.
+ *
+ * Script Report is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Script Report is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with Script Report.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "sqlconnectionpool.h"
+
+#include <QtCore/QCoreApplication>
+#include <QtCore/QElapsedTimer>
+#include <QtCore/QList>
+#include <QtCore/QMutex>
+#include <QtCore/QMutexLocker>
+#include <QtCore/QThread>
+#include <QtCore/QThreadStorage>
+#include <QtCore/QWaitCondition>
+#include <QtSql/QSqlDatabase>
+
+struct SqlPooledConnection {
+    QString name;
+    QString templateName;
+    QThread *thread;
+    bool isIdle;
+    // Other thread needs its slot, it is removed by its own thread when it is not in use
+    bool isEvicted;
+    // The time in milliseconds of SqlConnectionPoolPrivate::clock when the connection was returned
+    qint64 idleSince;
+};
+
+class SqlConnectionPoolPrivate {
+public:
+    SqlConnectionPoolPrivate() :
+            maximumSize(8),
+            idleTimeout(60),
+            nextConnection(0)
+    {
+        clock.start();
+    }
+
+    void remove(int index);
+    void removeExpired(QThread *thread);
+    void removeThread(QThread *thread);
+
+    QMutex mutex;
+    QWaitCondition returned;
+    QList<SqlPooledConnection> connections;
+    QElapsedTimer clock;
+    int maximumSize;
+    int idleTimeout;
+    int nextConnection;
+};
+
+Q_GLOBAL_STATIC(SqlConnectionPoolPrivate, pool)
+
+// Removes the connections of its thread from the pool when the thread finishes
+class SqlConnectionPoolThreadGuard {
+public:
+    ~SqlConnectionPoolThreadGuard() {
+        SqlConnectionPoolPrivate *p = pool();
+        QMutexLocker locker(&p->mutex);
+        p->removeThread(QThread::currentThread());
+    }
+};
+
+static QThreadStorage<SqlConnectionPoolThreadGuard *> threadGuards;
+
+void SqlConnectionPoolPrivate::remove(int index) {
+    QSqlDatabase::removeDatabase(connections.takeAt(index).name);
+    returned.wakeAll();
+}
+
+// Removes the idle connections of the thread evicted by other thread or not used for idleTimeout
+// seconds. A connection can only be closed by its own thread.
+void SqlConnectionPoolPrivate::removeExpired(QThread *thread) {
+    qint64 limit = clock.elapsed() - qint64(idleTimeout) * 1000;
+    for (int i = connections.size() - 1; i >= 0; i--) {
+        const SqlPooledConnection &connection = connections.at(i);
+        if (connection.thread == thread && connection.isIdle
+                && (connection.isEvicted || (idleTimeout >= 0 && connection.idleSince <= limit))) {
+            remove(i);
+        }
+    }
+}
+
+void SqlConnectionPoolPrivate::removeThread(QThread *thread) {
+    for (int i = connections.size() - 1; i >= 0; i--) {
+        if (connections.at(i).thread == thread) {
+            remove(i);
+        }
+    }
+}
+
+int SqlConnectionPool::maximumSize() {
+    QMutexLocker locker(&pool()->mutex);
+    return pool()->maximumSize;
+}
+
+// Set the maximum number of clones of each template connection, 0 disables the pool
+void SqlConnectionPool::setMaximumSize(int maximumSize) {
+    QMutexLocker locker(&pool()->mutex);
+    pool()->maximumSize = qMax(0, maximumSize);
+    pool()->returned.wakeAll();
+}
+
+int SqlConnectionPool::idleTimeout() {
+    QMutexLocker locker(&pool()->mutex);
+    return pool()->idleTimeout;
+}
+
+// Set the seconds an idle connection is kept, a negative value keeps them until their thread finishes
+void SqlConnectionPool::setIdleTimeout(int seconds) {
+    QMutexLocker locker(&pool()->mutex);
+    pool()->idleTimeout = seconds;
+}
+
+int SqlConnectionPool::size() {
+    QMutexLocker locker(&pool()->mutex);
+    return pool()->connections.size();
+}
+
+int SqlConnectionPool::idleCount() {
+    QMutexLocker locker(&pool()->mutex);
+    int result = 0;
+    foreach (const SqlPooledConnection &connection, pool()->connections) {
+        if (connection.isIdle) {
+            result++;
+        }
+    }
+    return result;
+}
+
+// Returns true if the connection templateName must be checked out from the pool instead of being
+// used directly, that is in the threads other than the main thread. The pool requires Qt 5.13, the
+// previous versions can not clone a connection from other thread than the connection's one.
+bool SqlConnectionPool::isPooled(const QString &templateName) {
+#if QT_VERSION < 0x050d00
+    Q_UNUSED(templateName)
+    return false;
+#else
+    QCoreApplication *application = QCoreApplication::instance();
+    if (!application || QThread::currentThread() == application->thread()) {
+        return false;
+    }
+    return maximumSize() > 0 && QSqlDatabase::contains(templateName);
+#endif
+}
+
+// Returns the name of a clone of the connection templateName for the current thread, or an empty
+// string if none is available after WaitTimeout milliseconds. When the pool is full the oldest idle
+// clone of other thread is evicted, it is closed by its thread the next time it uses the pool or
+// when it finishes, and this thread waits for its slot
+QString SqlConnectionPool::checkOut(const QString &templateName) {
+    if (!threadGuards.hasLocalData()) {
+        threadGuards.setLocalData(new SqlConnectionPoolThreadGuard);
+    }
+
+    SqlConnectionPoolPrivate *p = pool();
+    QThread *thread = QThread::currentThread();
+    QElapsedTimer timer;
+    timer.start();
+
+    QMutexLocker locker(&p->mutex);
+    forever {
+        p->removeExpired(thread);
+
+        int count = 0;
+        int oldestIdle = -1;
+        bool isEvicting = false;
+        for (int i = 0; i < p->connections.size(); i++) {
+            SqlPooledConnection &connection = p->connections[i];
+            if (connection.templateName != templateName) {
+                continue;
+            }
+            if (connection.isIdle && connection.thread == thread) {
+                connection.isIdle = false;
+                return connection.name;
+            }
+            if (connection.isEvicted) {
+                isEvicting = true;
+            } else if (connection.isIdle && (oldestIdle < 0 || connection.idleSince < p->connections.at(oldestIdle).idleSince)) {
+                oldestIdle = i;
+            }
+            count++;
+        }
+
+        if (count >= p->maximumSize && oldestIdle >= 0 && !isEvicting) {
+            p->connections[oldestIdle].isEvicted = true;
+        }
+        if (count < p->maximumSize) {
+            SqlPooledConnection connection;
+            connection.name = QString::fromLatin1("%1_pool_%2").arg(templateName).arg(p->nextConnection++);
+            connection.templateName = templateName;
+            connection.thread = thread;
+            connection.isIdle = false;
+            connection.isEvicted = false;
+            connection.idleSince = 0;
+#if QT_VERSION >= 0x050d00
+            QSqlDatabase::cloneDatabase(templateName, connection.name);
+#endif
+            p->connections.append(connection);
+            return connection.name;
+        }
+
+        qint64 remaining = WaitTimeout - timer.elapsed();
+        if (remaining <= 0) {
+            return QString();
+        }
+        p->returned.wait(&p->mutex, ulong(remaining));
+    }
+}
+
+// Returns the connection to the pool, it must not be used until it is checked out again
+void SqlConnectionPool::checkIn(const QString &connectionName) {
+    SqlConnectionPoolPrivate *p = pool();
+    QMutexLocker locker(&p->mutex);
+    for (int i = 0; i < p->connections.size(); i++) {
+        SqlPooledConnection &connection = p->connections[i];
+        if (connection.name == connectionName) {
+            connection.isIdle = true;
+            connection.idleSince = p->clock.elapsed();
+            break;
+        }
+    }
+    p->removeExpired(QThread::currentThread());
+    p->returned.wakeAll();
+}
@@ -0,0 +1,54 @@
+/*
+ * Copyright 2010 and beyond, Juan Luis Paz
+ *
+ * This file is part of Script Report.
+ *
+ * Script Report is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Script Report is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with Script Report.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef SQLCONNECTIONPOOL_H
+#define SQLCONNECTIONPOOL_H
+
+#include <QtCore/QString>
+
+// Clones of the named connections for the threads other than the main thread, a QSqlDatabase can
+// only be used in the thread that created it. Each thread checks out a clone of the template
+// connection and returns it when it is done; the idle clones are reused by the same thread, and
+// closed after idleTimeout() seconds or when their thread finishes. There are at most maximumSize()
+// clones of each template, when all of them are in use checkOut() waits until one is returned.
+// A clone is only closed by its own thread. Cloning a connection from other thread requires Qt 5.13,
+// with the previous versions the connections are not pooled.
+class SqlConnectionPool
+{
+public:
+    enum {
+        WaitTimeout = 30000
+    };
+
+    static int maximumSize();
+    static void setMaximumSize(int maximumSize);
+    static int idleTimeout();
+    static void setIdleTimeout(int seconds);
+    static int size();
+    static int idleCount();
+
+    static bool isPooled(const QString &templateName);
+    static QString checkOut(const QString &templateName);
+    static void checkIn(const QString &connectionName);
+
+private:
+    SqlConnectionPool();
+};
+
+#endif // SQLCONNECTIONPOOL_H
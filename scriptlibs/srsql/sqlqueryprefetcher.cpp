@@ -0,0 +1,181 @@
+/*
+ * Copyright 2010 and beyond, Juan Luis Paz
+ *
+ * This file is part of Script Report.
+ *
+ * Script Report is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Script Report is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with Script Report.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "sqlqueryprefetcher.h"
+
+#include <QtCore/QAtomicInt>
+#include <QtCore/QMutexLocker>
+#include <QtSql/QSqlDatabase>
+#include <QtSql/QSqlQuery>
+#include <QtSql/QSqlRecord>
+
+#include <ScriptReport/ScriptReportTracer>
+
+#include "scriptabledatabase.h"
+
+// The number used in the name of the next connection of a prefetcher
+static QAtomicInt nextConnection;
+
+SqlQueryPrefetcher::SqlQueryPrefetcher(const QSqlDatabase &database, const QString &query, const QVariant &boundValues, int blockSize, QObject *parent) :
+    QThread(parent),
+    m_driverName(database.driverName()),
+    m_databaseName(database.databaseName()),
+    m_userName(database.userName()),
+    m_password(database.password()),
+    m_hostName(database.hostName()),
+    m_port(database.port()),
+    m_connectOptions(database.connectOptions()),
+    m_query(query),
+    m_boundValues(boundValues),
+    m_blockSize(qMax(1, blockSize)),
+    m_hasFieldNames(false),
+    m_isCancelled(false)
+{
+}
+
+SqlQueryPrefetcher::~SqlQueryPrefetcher() {
+    cancel();
+    wait();
+}
+
+// Returns the names of the fields of the result, waits until the query is executed
+QStringList SqlQueryPrefetcher::fieldNames() {
+    QMutexLocker locker(&m_mutex);
+    while (!m_hasFieldNames && m_queue.isEmpty()) {
+        m_notEmpty.wait(&m_mutex);
+    }
+    return m_fieldNames;
+}
+
+// Returns the next block of rows, waits until it is read from the database. It must not be called
+// after the last block
+SqlQueryPrefetcher::Block SqlQueryPrefetcher::takeBlock() {
+    QMutexLocker locker(&m_mutex);
+    if (m_queue.isEmpty()) {
+        ScriptReportTraceSpan span("sql", "prefetchWait");
+        while (m_queue.isEmpty()) {
+            m_notEmpty.wait(&m_mutex);
+        }
+    }
+    Block block = m_queue.dequeue();
+    m_notFull.wakeOne();
+    return block;
+}
+
+// Stops the reading of rows, the thread finishes after the row being read; the query can't be
+// interrupted while the database is executing it
+void SqlQueryPrefetcher::cancel() {
+    QMutexLocker locker(&m_mutex);
+    m_isCancelled = true;
+    m_queue.clear();
+    m_notFull.wakeOne();
+}
+
+void SqlQueryPrefetcher::run() {
+    const QString connectionName = QString::fromLatin1("srsql_prefetch_%1").arg(nextConnection.fetchAndAddRelaxed(1));
+    if (ScriptReportTracer::isEnabled()) {
+        ScriptReportTracer::setThreadName(connectionName);
+    }
+
+    Block end;
+    end.isEnd = true;
+    {
+        ScriptReportTraceSpan span("sql", "prefetch");
+        span.setArgument(QString::fromLatin1("query"), m_query);
+        int rows = 0;
+
+        QSqlDatabase db = QSqlDatabase::addDatabase(m_driverName, connectionName);
+        db.setDatabaseName(m_databaseName);
+        db.setUserName(m_userName);
+        db.setPassword(m_password);
+        db.setHostName(m_hostName);
+        db.setPort(m_port);
+        db.setConnectOptions(m_connectOptions);
+        if (!db.open()) {
+            end.error = db.lastError();
+        } else {
+            QSqlQuery q(db);
+            q.setForwardOnly(true);
+            bool ok = q.prepare(m_query);
+            if (ok) {
+                ScriptableDatabase::bindValues(q, m_boundValues);
+                ok = q.exec();
+            }
+            if (!ok) {
+                end.error = q.lastError();
+            } else {
+                const QSqlRecord record = q.record();
+                const int columns = record.count();
+                QStringList names;
+                for (int i = 0; i < columns; i++) {
+                    names.append(record.fieldName(i));
+                }
+                setFieldNames(names);
+
+                Block block;
+                block.values.reserve(m_blockSize * columns);
+                int blockRows = 0;
+                bool isCancelled = false;
+                while (!isCancelled && q.next()) {
+                    for (int i = 0; i < columns; i++) {
+                        block.values.append(q.value(i));
+                    }
+                    rows++;
+                    if (++blockRows == m_blockSize) {
+                        isCancelled = !enqueue(block);
+                        // The queued block shares the values, a new vector avoids the copy
+                        block.values = QVector<QVariant>();
+                        block.values.reserve(m_blockSize * columns);
+                        blockRows = 0;
+                    }
+                }
+                if (!isCancelled && blockRows > 0) {
+                    enqueue(block);
+                }
+                if (q.lastError().isValid()) {
+                    end.error = q.lastError();
+                }
+            }
+        }
+        span.setArgument(QString::fromLatin1("rows"), rows);
+    }
+    enqueue(end);
+    QSqlDatabase::removeDatabase(connectionName);
+}
+
+// Returns false if the prefetcher was cancelled, the block is discarded
+bool SqlQueryPrefetcher::enqueue(const Block &block) {
+    QMutexLocker locker(&m_mutex);
+    while (!m_isCancelled && m_queue.size() >= QueueCapacity) {
+        m_notFull.wait(&m_mutex);
+    }
+    if (m_isCancelled) {
+        return false;
+    }
+    m_queue.enqueue(block);
+    m_notEmpty.wakeOne();
+    return true;
+}
+
+void SqlQueryPrefetcher::setFieldNames(const QStringList &fieldNames) {
+    QMutexLocker locker(&m_mutex);
+    m_fieldNames = fieldNames;
+    m_hasFieldNames = true;
+    m_notEmpty.wakeOne();
+}
@@ -0,0 +1,91 @@
+/*
+ * Copyright 2010 and beyond, Juan Luis Paz
+ *
+ * This file is part of Script Report.
+ *
+ * Script Report is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Script Report is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with Script Report.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef SQLQUERYPREFETCHER_H
+#define SQLQUERYPREFETCHER_H
+
+#include <QtCore/QMutex>
+#include <QtCore/QQueue>
+#include <QtCore/QStringList>
+#include <QtCore/QThread>
+#include <QtCore/QVariant>
+#include <QtCore/QVector>
+#include <QtCore/QWaitCondition>
+#include <QtSql/QSqlError>
+
+class QSqlDatabase;
+
+// Executes a query in its own thread, with its own connection to the database, and sends the rows in
+// blocks through a queue of QueueCapacity blocks; the thread waits when the queue is full, so there
+// is a block being consumed and at most QueueCapacity blocks ready or being read from the database
+class SqlQueryPrefetcher : public QThread
+{
+public:
+    enum {
+        QueueCapacity = 2
+    };
+
+    // The values of the rows, one row after the other. The last block has no rows, only the error
+    // of the query, if any
+    struct Block {
+        Block() : isEnd(false) {}
+
+        QVector<QVariant> values;
+        bool isEnd;
+        QSqlError error;
+    };
+
+    SqlQueryPrefetcher(const QSqlDatabase &database, const QString &query, const QVariant &boundValues, int blockSize, QObject *parent = 0);
+    ~SqlQueryPrefetcher();
+
+    QStringList fieldNames();
+    Block takeBlock();
+    void cancel();
+
+protected:
+    void run();
+
+private:
+    bool enqueue(const Block &block);
+    void setFieldNames(const QStringList &fieldNames);
+
+    // The parameters of the connection, the QSqlDatabase can only be used in the thread that
+    // created it
+    QString m_driverName;
+    QString m_databaseName;
+    QString m_userName;
+    QString m_password;
+    QString m_hostName;
+    int m_port;
+    QString m_connectOptions;
+
+    QString m_query;
+    QVariant m_boundValues;
+    int m_blockSize;
+
+    QMutex m_mutex;
+    QWaitCondition m_notEmpty;
+    QWaitCondition m_notFull;
+    QQueue<Block> m_queue;
+    QStringList m_fieldNames;
+    bool m_hasFieldNames;
+    bool m_isCancelled;
+};
+
+#endif // SQLQUERYPREFETCHER_H
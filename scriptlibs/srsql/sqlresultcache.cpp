@@ -0,0 +1,170 @@
+/*
+ * Copyright 2010 and beyond, Juan Luis Paz
+ *
+ * This file is part of Script Report.
+ *
+ * Script Report is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Script Report is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with Script Report.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "sqlresultcache.h"
+
+#include <climits>
+
+#include <QtCore/QAtomicInt>
+#include <QtCore/QCache>
+#include <QtCore/QElapsedTimer>
+#include <QtCore/QMutex>
+#include <QtCore/QMutexLocker>
+
+struct SqlResultCacheEntry {
+    SqlResultCache::ResultPointer result;
+    // The time in milliseconds of SqlResultCachePrivate::clock when the entry expires, -1 if never
+    qint64 expires;
+};
+
+class SqlResultCachePrivate {
+public:
+    SqlResultCachePrivate() :
+            entries(16 * 1024 * 1024)
+    {
+        clock.start();
+    }
+
+    QMutex mutex;
+    // The cost of each entry is the estimation of its size in bytes, the least recently used
+    // entries are removed when the total is greater than the maximum size
+    QCache<QString, SqlResultCacheEntry> entries;
+    QElapsedTimer clock;
+
+    QAtomicInt hits;
+    QAtomicInt misses;
+};
+
+Q_GLOBAL_STATIC(SqlResultCachePrivate, cache)
+
+int SqlResultCache::Result::columnCount() const {
+    return fieldNames.size();
+}
+
+int SqlResultCache::Result::rowCount() const {
+    return fieldNames.isEmpty() ? 0 : values.size() / fieldNames.size();
+}
+
+const QVariant &SqlResultCache::Result::value(int row, int column) const {
+    return values.at(row * fieldNames.size() + column);
+}
+
+// An estimation of the memory used by the result, only the text and the binary data are counted
+// apart from the values themselves
+int SqlResultCache::Result::cost() const {
+    qint64 result = sizeof(Result) + qint64(values.size()) * sizeof(QVariant);
+    foreach (const QString &name, fieldNames) {
+        result += sizeof(QString) + name.size() * sizeof(QChar);
+    }
+    foreach (const QVariant &value, values) {
+        switch (value.type()) {
+        case QVariant::String:
+            result += sizeof(QString) + value.toString().size() * sizeof(QChar);
+            break;
+        case QVariant::ByteArray:
+            result += sizeof(QByteArray) + value.toByteArray().size();
+            break;
+        default:
+            break;
+        }
+    }
+    return int(qMin(result, qint64(INT_MAX)));
+}
+
+int SqlResultCache::maximumSize() {
+    QMutexLocker locker(&cache()->mutex);
+    return cache()->entries.maxCost();
+}
+
+void SqlResultCache::setMaximumSize(int maximumSize) {
+    QMutexLocker locker(&cache()->mutex);
+    cache()->entries.setMaxCost(qMax(0, maximumSize));
+}
+
+int SqlResultCache::size() {
+    QMutexLocker locker(&cache()->mutex);
+    return cache()->entries.totalCost();
+}
+
+int SqlResultCache::count() {
+    QMutexLocker locker(&cache()->mutex);
+    return cache()->entries.count();
+}
+
+// Returns the result stored with the key, or a null pointer if there is not one or it is expired
+SqlResultCache::ResultPointer SqlResultCache::find(const QString &key) {
+    SqlResultCachePrivate *c = cache();
+    QMutexLocker locker(&c->mutex);
+    SqlResultCacheEntry *entry = c->entries.object(key);
+    if (entry && entry->expires >= 0 && entry->expires <= c->clock.elapsed()) {
+        c->entries.remove(key);
+        entry = 0;
+    }
+    if (!entry) {
+        c->misses.ref();
+        return ResultPointer();
+    }
+    c->hits.ref();
+    return entry->result;
+}
+
+// Stores the result with the key for ttlSeconds, or until it is removed when ttlSeconds is negative.
+// Returns false if the result is greater than the maximum size
+bool SqlResultCache::insert(const QString &key, const ResultPointer &result, int ttlSeconds) {
+    SqlResultCachePrivate *c = cache();
+    SqlResultCacheEntry *entry = new SqlResultCacheEntry;
+    entry->result = result;
+    int cost = result->cost();
+
+    QMutexLocker locker(&c->mutex);
+    entry->expires = ttlSeconds < 0 ? -1 : c->clock.elapsed() + qint64(ttlSeconds) * 1000;
+    return c->entries.insert(key, entry, cost);
+}
+
+// Removes the results with a key that starts with prefix, returns the number of results removed
+int SqlResultCache::invalidate(const QString &prefix) {
+    SqlResultCachePrivate *c = cache();
+    QMutexLocker locker(&c->mutex);
+    int result = 0;
+    foreach (const QString &key, c->entries.keys()) {
+        if (key.startsWith(prefix)) {
+            c->entries.remove(key);
+            result++;
+        }
+    }
+    return result;
+}
+
+void SqlResultCache::clear() {
+    QMutexLocker locker(&cache()->mutex);
+    cache()->entries.clear();
+}
+
+int SqlResultCache::hits() {
+    return cache()->hits.load();
+}
+
+int SqlResultCache::misses() {
+    return cache()->misses.load();
+}
+
+void SqlResultCache::resetCounters() {
+    cache()->hits.store(0);
+    cache()->misses.store(0);
+}
@@ -0,0 +1,65 @@
+/*
+ * Copyright 2010 and beyond, Juan Luis Paz
+ *
+ * This file is part of Script Report.
+ *
+ * Script Report is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Script Report is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with Script Report.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef SQLRESULTCACHE_H
+#define SQLRESULTCACHE_H
+
+#include <QtCore/QSharedPointer>
+#include <QtCore/QString>
+#include <QtCore/QStringList>
+#include <QtCore/QVariant>
+#include <QtCore/QVector>
+
+// The result sets of the queries executed with ScriptableDatabase::cachedQuery(), shared by all the
+// reports in the process. The results are never modified once they are in the cache, so any number
+// of threads can read them at the same time
+class SqlResultCache
+{
+public:
+    // A result set, the values of the rows are stored one row after the other
+    struct Result {
+        QStringList fieldNames;
+        QVector<QVariant> values;
+
+        int columnCount() const;
+        int rowCount() const;
+        const QVariant &value(int row, int column) const;
+        int cost() const;
+    };
+    typedef QSharedPointer<const Result> ResultPointer;
+
+    static int maximumSize();
+    static void setMaximumSize(int maximumSize);
+    static int size();
+    static int count();
+
+    static ResultPointer find(const QString &key);
+    static bool insert(const QString &key, const ResultPointer &result, int ttlSeconds);
+    static int invalidate(const QString &prefix);
+    static void clear();
+
+    static int hits();
+    static int misses();
+    static void resetCounters();
+
+private:
+    SqlResultCache();
+};
+
+#endif // SQLRESULTCACHE_H
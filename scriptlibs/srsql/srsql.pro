@@ -25,16 +25,30 @@ TARGET = srsql
 TEMPLATE = lib
 DESTDIR = ../../compiled/script
 CONFIG += plugin
+win32 {
+    LIBS += -L../../compiled -lscriptreportengine$${VERSION_MAJOR}
+} else {
+    LIBS += -L../../compiled -lscriptreportengine
+}
+INCLUDEPATH += ../../includes
 SOURCES += scriptreportsql.cpp \
     scriptablesql.cpp \
+    scriptableasyncquery.cpp \
     scriptabledatabase.cpp \
     scriptableerror.cpp \
     scriptablequery.cpp \
-    scriptablerecord.cpp
+    scriptablerecord.cpp \
+    sqlconnectionpool.cpp \
+    sqlqueryprefetcher.cpp \
+    sqlresultcache.cpp
 HEADERS += scriptreportsql.h \
     scriptablesql.h \
+    scriptableasyncquery.h \
     scriptabledatabase.h \
     scriptableerror.h \
     scriptablequery.h \
-    scriptablerecord.h
+    scriptablerecord.h \
+    sqlconnectionpool.h \
+    sqlqueryprefetcher.h \
+    sqlresultcache.h
 
@@ -24,11 +24,15 @@ TEMPLATE = subdirs
 SUBDIRS = sub_engine \
           sub_editor \
           sub_scriptlibs \
-          sub_tools 
+          sub_tools \
+          sub_benchmarks
 
 sub_engine.subdir = engine
 sub_editor.subdir = editor
 sub_editor.depends = sub_engine
 sub_scriptlibs.subdir = scriptlibs
+sub_scriptlibs.depends = sub_engine
 sub_tools.subdir = tools
 sub_tools.depends = sub_engine
+sub_benchmarks.subdir = benchmarks
+sub_benchmarks.depends = sub_engine
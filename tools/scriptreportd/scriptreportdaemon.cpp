@@ -0,0 +1,507 @@
+/*
+ * Copyright 2010 and beyond, Juan Luis Paz
+ *
+ * This file is part of Script Report.
+ *
+ * Script Report is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Script Report is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with Script Report.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "scriptreportdaemon.h"
+
+#include <QtCore/QCoreApplication>
+#include <QtCore/QFile>
+#include <QtCore/QFutureWatcher>
+#include <QtCore/QJsonArray>
+#include <QtCore/QJsonDocument>
+#include <QtCore/QTextStream>
+#include <QtCore/QtEndian>
+
+#include <QtNetwork/QLocalServer>
+#include <QtNetwork/QLocalSocket>
+
+#include <ScriptReport/ScriptReportCache>
+#include <ScriptReport/ScriptReportJobRunner>
+#include <ScriptReport/ScriptReportTracer>
+
+#include "startupshell.h"
+
+// The biggest request accepted, a bigger length is considered a corrupted stream
+static const quint32 maximumRequestSize = 64 * 1024 * 1024;
+
+ScriptReportDaemon::ScriptReportDaemon(QObject *parent) :
+    QObject(parent),
+    m_socketName(QString::fromLatin1(APP_NAME)),
+    m_jobs(0),
+    m_pipeline(false),
+    m_printError(false),
+    m_err(0),
+    m_out(0),
+    m_server(0),
+    m_startupShell(0),
+    m_runner(0)
+{
+}
+
+ScriptReportDaemon::~ScriptReportDaemon() {
+    // Wait for the jobs before the watchers are destroyed
+    delete m_runner;
+    delete m_out;
+    delete m_err;
+}
+
+void ScriptReportDaemon::printHelp() {
+    QString message = QString::fromLatin1(
+            "Welcome to Script Report Daemon, version %1\n"
+            "\n"
+            "Usage:\n"
+            "    %2 [options] [SOCKET]\n"
+            "    %2 -q REQUEST [SOCKET]\n"
+            "\n"
+            "Description:\n"
+            "    %2 keep script engines ready to render reports to PDF, and listen for\n"
+            "    render requests in the local socket with name SOCKET (by default %2).\n"
+            "    Each message, request or response, is a JSON object in UTF-8 preceded by\n"
+            "    its size in bytes as a 32 bits big endian integer. A request is like\n"
+            "        {\"id\": ID, \"report\": \"FILE\", \"arguments\": [...], \"output\": \"PDF\"}\n"
+            "    where the script can be sent in \"input\" instead of read from FILE, and the\n"
+            "    \"output\" is optional. The response contains the same \"id\", a \"status\"\n"
+            "    that is \"ok\" or \"error\", the \"error\" message, the \"elapsed\" time in\n"
+            "    milliseconds and the \"output\" file name or the PDF in base64 in \"pdf\" if\n"
+            "    the request doesn't have output. The request {\"command\": \"ping\"} only\n"
+            "    returns the status. With the -g option the request\n"
+            "        {\"command\": \"trace\", \"output\": \"FILE\"}\n"
+            "    writes the timeline recorded since the last one to FILE, in the Chrome\n"
+            "    trace event format. The requests of a connection can be answered in\n"
+            "    different order. Use absolute file names, the relative ones are relative\n"
+            "    to the daemon working directory. The reports are run out of the\n"
+            "    application thread, they cannot render widgets and their images are\n"
+            "    loaded as QImage instead of QPixmap.\n"
+            "\n"
+            "    The named database connections used by the reports are added in the\n"
+            "    startup SCRIPT of the -s option, like\n"
+            "        sr.sql.addDatabase(\"QPSQL\", \"sales\").databaseName = \"sales\";\n"
+            "    it is evaluated once in the application thread, with srsql and the\n"
+            "    EXTENSIONS imported, and each job uses its own clone of the connection\n"
+            "    with sr.sql.database(\"sales\"). Don't add connections in the init script.\n"
+            "\n"
+            "Options:\n"
+            "    -g , -trace , --trace\n"
+            "               record the timeline of the work of each thread, it is\n"
+            "               written with the trace command.\n"
+            "    -h , -help , --help\n"
+            "               display this help with the basic usage.\n"
+            "    -i SCRIPT, -init-script SCRIPT, --init-script SCRIPT\n"
+            "               evaluate the file SCRIPT once in each engine when it is\n"
+            "               created, its global variables are kept for all the reports\n"
+            "               of the engine.\n"
+            "    -j JOBS, -jobs JOBS, --jobs JOBS\n"
+            "               the number of parallel jobs, by default one for each\n"
+            "               processor core.\n"
+            "    -l , -pipeline , --pipeline\n"
+            "               write the pages of the PDF while the script report is run.\n"
+            "    -q REQUEST, -request REQUEST, --request REQUEST\n"
+            "               send the JSON REQUEST to a running daemon and write the\n"
+            "               response in the standard output.\n"
+            "    -r , -print-error , --print-error\n"
+            "               print the error in an extra page if it was happened.\n"
+            "    -s SCRIPT, -startup-script SCRIPT, --startup-script SCRIPT\n"
+            "               evaluate the file SCRIPT once when the daemon starts, its\n"
+            "               database connections are shared by all the jobs.\n"
+            "    -x EXTENSION, -extension EXTENSION, --extension EXTENSION\n"
+            "               import the EXTENSION in the engines when they are created.\n")
+        .arg(QString::fromLatin1(APP_VERSION))
+        .arg(QString::fromLatin1(APP_NAME));
+
+    *m_out << message;
+}
+
+bool ScriptReportDaemon::init(int &retunrCode) {
+    m_out = new QTextStream(stdout);
+    m_err = new QTextStream(stderr);
+
+    QStringList arguments = QCoreApplication::arguments();
+    QString arg;
+    QString request;
+    bool client = false;
+
+    for (int i = 1; i < arguments.length(); i++) {
+        arg = arguments[i];
+        if (arg.startsWith(QChar::fromLatin1('-'))) {
+            if (arg == QLatin1String("-help")
+                    || arg == QLatin1String("--help")
+                    || arg == QLatin1String("-h")) {
+                printHelp();
+                retunrCode = 0;
+                return true;
+            } else if (arg == QLatin1String("-pipeline")
+                    || arg == QLatin1String("--pipeline")
+                    || arg == QLatin1String("-l")) {
+                m_pipeline = true;
+            } else if (arg == QLatin1String("-print-error")
+                    || arg == QLatin1String("--print-error")
+                    || arg == QLatin1String("-r")) {
+                m_printError = true;
+            } else if (arg == QLatin1String("-trace")
+                    || arg == QLatin1String("--trace")
+                    || arg == QLatin1String("-g")) {
+                ScriptReportTracer::setEnabled(true);
+            } else if (arg == QLatin1String("-jobs")
+                    || arg == QLatin1String("--jobs")
+                    || arg == QLatin1String("-j")) {
+                i++;
+                bool ok = false;
+                if (i < arguments.length()) {
+                    m_jobs = arguments[i].toInt(&ok);
+                }
+                if (!ok || m_jobs < 1) {
+                    *m_err << QString::fromLatin1("The number of jobs must be a positive number.\n");
+                    retunrCode = 1;
+                    return true;
+                }
+            } else if (arg == QLatin1String("-extension")
+                    || arg == QLatin1String("--extension")
+                    || arg == QLatin1String("-x")) {
+                i++;
+                if (i >= arguments.length()) {
+                    *m_err << QString::fromLatin1("Missing the extension name.\n");
+                    retunrCode = 1;
+                    return true;
+                }
+                m_extensions.append(arguments[i]);
+            } else if (arg == QLatin1String("-init-script")
+                    || arg == QLatin1String("--init-script")
+                    || arg == QLatin1String("-i")) {
+                i++;
+                if (i >= arguments.length()) {
+                    *m_err << QString::fromLatin1("Missing the init script file name.\n");
+                    retunrCode = 1;
+                    return true;
+                }
+                m_initScriptFileName = arguments[i];
+            } else if (arg == QLatin1String("-startup-script")
+                    || arg == QLatin1String("--startup-script")
+                    || arg == QLatin1String("-s")) {
+                i++;
+                if (i >= arguments.length()) {
+                    *m_err << QString::fromLatin1("Missing the startup script file name.\n");
+                    retunrCode = 1;
+                    return true;
+                }
+                m_startupScriptFileName = arguments[i];
+            } else if (arg == QLatin1String("-request")
+                    || arg == QLatin1String("--request")
+                    || arg == QLatin1String("-q")) {
+                i++;
+                if (i >= arguments.length()) {
+                    *m_err << QString::fromLatin1("Missing the request.\n");
+                    retunrCode = 1;
+                    return true;
+                }
+                client = true;
+                request = arguments[i];
+            } else {
+                *m_err << QString::fromLatin1("Unrecognized option '%1'.\n").arg(arg);
+                printHelp();
+                retunrCode = 1;
+                return true;
+            }
+        } else if (i == arguments.length() - 1) {
+            m_socketName = arg;
+        } else {
+            *m_err << QString::fromLatin1("Unrecognized argument '%1'.\n").arg(arg);
+            printHelp();
+            retunrCode = 1;
+            return true;
+        }
+    }
+
+    if (client) {
+        retunrCode = sendRequest(request);
+        return true;
+    }
+
+    // The connections of the startup script are created in the application thread, the workers
+    // check out clones of them
+    if (!m_startupScriptFileName.isEmpty()) {
+        QFile startupScriptFile(m_startupScriptFileName);
+        if (!startupScriptFile.open(QIODevice::ReadOnly)) {
+            *m_err << QString::fromLatin1("Unable to read the file '%1'.\n").arg(m_startupScriptFileName);
+            retunrCode = 2;
+            return true;
+        }
+        QTextStream startupScript(&startupScriptFile);
+        QStringList extensions = m_extensions;
+        if (!extensions.contains(QLatin1String("srsql"))) {
+            extensions.prepend(QString::fromLatin1("srsql"));
+        }
+        m_startupShell = new StartupShell(m_out, m_err, this);
+        if (!m_startupShell->run(m_startupScriptFileName, startupScript.readAll(), extensions)) {
+            retunrCode = 2;
+            return true;
+        }
+    }
+
+    // The daemon runs the same reports many times, the transformed ones are kept on disk
+    ScriptReportCache::setEnabled(true);
+    m_runner = new ScriptReportJobRunner(m_jobs, m_extensions);
+    if (!m_initScriptFileName.isEmpty()) {
+        QFile initScriptFile(m_initScriptFileName);
+        if (!initScriptFile.open(QIODevice::ReadOnly)) {
+            *m_err << QString::fromLatin1("Unable to read the file '%1'.\n").arg(m_initScriptFileName);
+            retunrCode = 2;
+            return true;
+        }
+        QTextStream initScript(&initScriptFile);
+        m_runner->setInitScript(initScript.readAll());
+    }
+
+    // The socket file left by a previous instance that was killed is removed, but not the socket of
+    // a running instance
+    QLocalSocket probe;
+    probe.connectToServer(m_socketName);
+    if (probe.waitForConnected(1000)) {
+        probe.abort();
+        *m_err << QString::fromLatin1("Another daemon is listening in the socket '%1'.\n").arg(m_socketName);
+        retunrCode = 3;
+        return true;
+    }
+    if (probe.error() == QLocalSocket::ConnectionRefusedError) {
+        QLocalServer::removeServer(m_socketName);
+    }
+
+    m_server = new QLocalServer(this);
+    // Only the user that runs the daemon can connect to it
+    m_server->setSocketOptions(QLocalServer::UserAccessOption);
+    if (!m_server->listen(m_socketName)) {
+        *m_err << QString::fromLatin1("Unable to listen in the socket '%1': %2.\n")
+                  .arg(m_socketName, m_server->errorString());
+        retunrCode = 3;
+        return true;
+    }
+    connect(m_server, SIGNAL(newConnection()), this, SLOT(newConnection()));
+
+    *m_err << QString::fromLatin1("Listening in the socket '%1' with %2 jobs.\n")
+              .arg(m_server->fullServerName())
+              .arg(m_runner->maximumThreadCount());
+    m_err->flush();
+    return false;
+}
+
+void ScriptReportDaemon::writeMessage(QLocalSocket *socket, const QJsonObject &message) {
+    QByteArray json = QJsonDocument(message).toJson(QJsonDocument::Compact);
+    uchar size[4];
+    qToBigEndian<quint32>(json.size(), size);
+    socket->write(reinterpret_cast<const char*>(size), 4);
+    socket->write(json);
+}
+
+bool ScriptReportDaemon::readMessage(QByteArray &buffer, QJsonObject &message, bool &isValid) {
+    isValid = true;
+    if (buffer.size() < 4) {
+        return false;
+    }
+    quint32 size = qFromBigEndian<quint32>(reinterpret_cast<const uchar*>(buffer.constData()));
+    if (size > maximumRequestSize) {
+        isValid = false;
+        return false;
+    }
+    if (quint32(buffer.size()) - 4 < size) {
+        return false;
+    }
+
+    QJsonParseError parseError;
+    QJsonDocument document = QJsonDocument::fromJson(buffer.mid(4, size), &parseError);
+    buffer.remove(0, size + 4);
+    if (parseError.error != QJsonParseError::NoError || !document.isObject()) {
+        message = QJsonObject();
+        message.insert(QLatin1String("error"), parseError.error != QJsonParseError::NoError
+                       ? parseError.errorString()
+                       : QString::fromLatin1("The request is not a JSON object"));
+        isValid = false;
+        return true;
+    }
+    message = document.object();
+    return true;
+}
+
+void ScriptReportDaemon::newConnection() {
+    while (QLocalSocket *socket = m_server->nextPendingConnection()) {
+        m_buffers.insert(socket, QByteArray());
+        connect(socket, SIGNAL(readyRead()), this, SLOT(readRequests()));
+        connect(socket, SIGNAL(disconnected()), this, SLOT(connectionClosed()));
+    }
+}
+
+void ScriptReportDaemon::connectionClosed() {
+    QLocalSocket *socket = qobject_cast<QLocalSocket*>(sender());
+    if (!socket) {
+        return;
+    }
+    // The pending jobs keep a guarded pointer, their response is discarded
+    m_buffers.remove(socket);
+    socket->deleteLater();
+}
+
+void ScriptReportDaemon::readRequests() {
+    QLocalSocket *socket = qobject_cast<QLocalSocket*>(sender());
+    if (!socket || !m_buffers.contains(socket)) {
+        return;
+    }
+    QByteArray &buffer = m_buffers[socket];
+    buffer.append(socket->readAll());
+
+    QJsonObject request;
+    bool isValid;
+    while (readMessage(buffer, request, isValid)) {
+        if (isValid) {
+            processRequest(socket, request);
+        } else {
+            QJsonObject response;
+            response.insert(QLatin1String("status"), QLatin1String("error"));
+            response.insert(QLatin1String("error"), request.value(QLatin1String("error")));
+            writeMessage(socket, response);
+        }
+    }
+    if (!isValid) {
+        // The size is corrupted, the next messages can not be found
+        m_buffers.remove(socket);
+        socket->disconnectFromServer();
+    }
+}
+
+void ScriptReportDaemon::processRequest(QLocalSocket *socket, const QJsonObject &request) {
+    QJsonObject response;
+    response.insert(QLatin1String("id"), request.value(QLatin1String("id")));
+
+    QString command = request.value(QLatin1String("command")).toString(QString::fromLatin1("render"));
+    if (command == QLatin1String("ping")) {
+        response.insert(QLatin1String("status"), QLatin1String("ok"));
+        writeMessage(socket, response);
+        return;
+    } else if (command == QLatin1String("trace")) {
+        QString fileName = request.value(QLatin1String("output")).toString();
+        if (!ScriptReportTracer::isEnabled()) {
+            response.insert(QLatin1String("status"), QLatin1String("error"));
+            response.insert(QLatin1String("error"), QLatin1String("The tracing is not enabled"));
+        } else if (fileName.isEmpty() || !ScriptReportTracer::writeTrace(fileName)) {
+            response.insert(QLatin1String("status"), QLatin1String("error"));
+            response.insert(QLatin1String("error"), QString::fromLatin1("Unable to write the trace file '%1'").arg(fileName));
+        } else {
+            ScriptReportTracer::clear();
+            response.insert(QLatin1String("status"), QLatin1String("ok"));
+            response.insert(QLatin1String("output"), fileName);
+        }
+        writeMessage(socket, response);
+        return;
+    } else if (command != QLatin1String("render")) {
+        response.insert(QLatin1String("status"), QLatin1String("error"));
+        response.insert(QLatin1String("error"), QString::fromLatin1("Unknown command '%1'").arg(command));
+        writeMessage(socket, response);
+        return;
+    }
+
+    ScriptReportJob job;
+    job.reportName = request.value(QLatin1String("report")).toString();
+    QJsonValue input = request.value(QLatin1String("input"));
+    if (input.isString()) {
+        job.input = input.toString();
+    }
+    foreach (const QJsonValue &argument, request.value(QLatin1String("arguments")).toArray()) {
+        job.arguments.append(argument.toString());
+    }
+    job.outputFileName = request.value(QLatin1String("output")).toString();
+    job.previousScript = request.value(QLatin1String("previousScript")).toString();
+    job.isPrintErrorEnabled = request.value(QLatin1String("printError")).toBool(m_printError);
+    job.isPipelineEnabled = request.value(QLatin1String("pipeline")).toBool(m_pipeline);
+
+    if (job.reportName.isEmpty() && job.input.isNull()) {
+        response.insert(QLatin1String("status"), QLatin1String("error"));
+        response.insert(QLatin1String("error"), QString::fromLatin1("Missing the report file name."));
+        writeMessage(socket, response);
+        return;
+    }
+
+    QFutureWatcher<ScriptReportJobResult> *watcher = new QFutureWatcher<ScriptReportJobResult>(this);
+    PendingRequest pending;
+    pending.socket = socket;
+    pending.id = request.value(QLatin1String("id"));
+    m_pending.insert(watcher, pending);
+    connect(watcher, SIGNAL(finished()), this, SLOT(jobFinished()));
+    watcher->setFuture(m_runner->submit(job));
+}
+
+void ScriptReportDaemon::jobFinished() {
+    QFutureWatcher<ScriptReportJobResult> *watcher = static_cast<QFutureWatcher<ScriptReportJobResult>*>(sender());
+    PendingRequest pending = m_pending.take(watcher);
+    ScriptReportJobResult result = watcher->result();
+    watcher->deleteLater();
+
+    if (!pending.socket) {
+        return;
+    }
+
+    QJsonObject response;
+    response.insert(QLatin1String("id"), pending.id);
+    response.insert(QLatin1String("status"), result.hasError ? QLatin1String("error") : QLatin1String("ok"));
+    if (result.hasError) {
+        response.insert(QLatin1String("error"), result.errorMessage);
+    }
+    if (result.outputFileName.isEmpty()) {
+        response.insert(QLatin1String("pdf"), QString::fromLatin1(result.output.toBase64()));
+    } else {
+        response.insert(QLatin1String("output"), result.outputFileName);
+    }
+    if (!result.printOutput.isEmpty()) {
+        response.insert(QLatin1String("print"), result.printOutput);
+    }
+    response.insert(QLatin1String("elapsed"), double(result.elapsedTime));
+    writeMessage(pending.socket, response);
+}
+
+int ScriptReportDaemon::sendRequest(QString request) {
+    QJsonParseError parseError;
+    QJsonDocument document = QJsonDocument::fromJson(request.toUtf8(), &parseError);
+    if (parseError.error != QJsonParseError::NoError || !document.isObject()) {
+        *m_err << QString::fromLatin1("Invalid request: %1.\n").arg(parseError.errorString());
+        return 1;
+    }
+
+    QLocalSocket socket;
+    socket.connectToServer(m_socketName);
+    if (!socket.waitForConnected()) {
+        *m_err << QString::fromLatin1("Unable to connect to the socket '%1': %2.\n")
+                  .arg(m_socketName, socket.errorString());
+        return 3;
+    }
+    writeMessage(&socket, document.object());
+
+    QByteArray buffer;
+    QJsonObject response;
+    bool isValid = true;
+    while (!readMessage(buffer, response, isValid) && isValid) {
+        if (!socket.waitForReadyRead(-1)) {
+            *m_err << QString::fromLatin1("The connection was closed: %1.\n").arg(socket.errorString());
+            return 3;
+        }
+        buffer.append(socket.readAll());
+    }
+    if (!isValid) {
+        *m_err << QString::fromLatin1("Invalid response.\n");
+        return 3;
+    }
+
+    *m_out << QString::fromUtf8(QJsonDocument(response).toJson(QJsonDocument::Compact)) << '\n';
+    m_out->flush();
+    return response.value(QLatin1String("status")).toString() == QLatin1String("ok") ? 0 : 6;
+}
@@ -0,0 +1,85 @@
+/*
+ * Copyright 2010 and beyond, Juan Luis Paz
+ *
+ * This file is part of Script Report.
+ *
+ * Script Report is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Script Report is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with Script Report.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef SCRIPTREPORTDAEMON_H
+#define SCRIPTREPORTDAEMON_H
+
+#include <QtCore/QHash>
+#include <QtCore/QJsonObject>
+#include <QtCore/QObject>
+#include <QtCore/QPointer>
+#include <QtCore/QStringList>
+
+class QLocalServer;
+class QLocalSocket;
+class QTextStream;
+class QFutureWatcherBase;
+
+class ScriptReportJobRunner;
+class StartupShell;
+
+class ScriptReportDaemon : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit ScriptReportDaemon(QObject *parent = 0);
+    ~ScriptReportDaemon();
+
+    bool init(int &retunrCode);
+    void printHelp();
+
+    static void writeMessage(QLocalSocket *socket, const QJsonObject &message);
+    static bool readMessage(QByteArray &buffer, QJsonObject &message, bool &isValid);
+
+private slots:
+    void newConnection();
+    void readRequests();
+    void connectionClosed();
+    void jobFinished();
+
+private:
+    int sendRequest(QString request);
+    void processRequest(QLocalSocket *socket, const QJsonObject &request);
+
+private:
+    struct PendingRequest {
+        QPointer<QLocalSocket> socket;
+        QJsonValue id;
+    };
+
+    QString m_socketName;
+    QString m_initScriptFileName;
+    QString m_startupScriptFileName;
+    QStringList m_extensions;
+    int m_jobs;
+    bool m_pipeline;
+    bool m_printError;
+
+    QTextStream *m_err;
+    QTextStream *m_out;
+
+    QLocalServer *m_server;
+    StartupShell *m_startupShell;
+    ScriptReportJobRunner *m_runner;
+    QHash<QLocalSocket*, QByteArray> m_buffers;
+    QHash<QFutureWatcherBase*, PendingRequest> m_pending;
+};
+
+#endif // SCRIPTREPORTDAEMON_H
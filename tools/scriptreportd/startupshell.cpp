@@ -0,0 +1,87 @@
+/*
+ * Copyright 2010 and beyond, Juan Luis Paz
+ *
+ * This file is part of Script Report.
+ *
+ * Script Report is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Script Report is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with Script Report.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include "startupshell.h"
+
+#include <QtCore/QTextStream>
+#include <QtScript/QScriptEngine>
+
+StartupShell::StartupShell(QTextStream *out, QTextStream *err, QObject *parent) :
+    Shell(parent),
+    m_hasError(false),
+    m_out(out),
+    m_err(err)
+{
+}
+
+// Imports the extensions and evaluates the script, returns false if it fails
+bool StartupShell::run(const QString &fileName, const QString &script, const QStringList &extensions) {
+    QScriptEngine *eng = engine();
+    foreach (const QString &extension, extensions) {
+        QScriptValue result = eng->importExtension(extension);
+        if (eng->hasUncaughtException()) {
+            *m_err << QString::fromLatin1("Unable to import the extension '%1': %2.\n")
+                      .arg(extension, result.toString());
+            return false;
+        }
+    }
+
+    m_script = script;
+    m_hasError = false;
+    setFileName(fileName);
+    runBatch();
+    m_script = QString();
+    m_out->flush();
+    m_err->flush();
+    return !m_hasError && exitCode() == 0;
+}
+
+QString StartupShell::readCommand() {
+    return QString();
+}
+
+QString StartupShell::readAll(int &/*finalLineNumber*/) {
+    return m_script;
+}
+
+QString StartupShell::readSentence(int &/*finalLineNumber*/) {
+    return QString();
+}
+
+void StartupShell::printForReadCommand(const QScriptValue &message, bool last) {
+    printOut(message, last);
+}
+
+void StartupShell::printOut(const QScriptValue &message, bool last) {
+    *m_out << message.toString() << (last ? QChar::fromLatin1('\n') : QChar::fromLatin1(' '));
+}
+
+void StartupShell::printErr(const QScriptValue &error, bool last) {
+    *m_err << error.toString() << (last ? QChar::fromLatin1('\n') : QChar::fromLatin1(' '));
+    m_hasError = true;
+}
+
+void StartupShell::printUncaughtException(const QScriptValue &exception) {
+    *m_err << QString::fromLatin1("Uncaught exception in the startup script: %1. Line: %2\n")
+              .arg(exception.toString())
+              .arg(engine()->uncaughtExceptionLineNumber());
+    m_hasError = true;
+}
+
+void StartupShell::helpCommand() {
+}
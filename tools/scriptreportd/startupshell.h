@@ -0,0 +1,56 @@
+/*
+ * Copyright 2010 and beyond, Juan Luis Paz
+ *
+ * This file is part of Script Report.
+ *
+ * Script Report is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Script Report is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with Script Report.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef STARTUPSHELL_H
+#define STARTUPSHELL_H
+
+#include <QtCore/QStringList>
+
+#include <ScriptReport/Shell>
+
+class QTextStream;
+
+// Shell that evaluates the startup script of the daemon in the application thread, so the
+// objects it creates, like the named database connections, are shared by all the workers
+class StartupShell : public Shell
+{
+    Q_OBJECT
+
+public:
+    StartupShell(QTextStream *out, QTextStream *err, QObject *parent = 0);
+
+    bool run(const QString &fileName, const QString &script, const QStringList &extensions);
+
+    //overrides:
+    QString readCommand();
+    QString readAll(int &finalLineNumber);
+    QString readSentence(int &finalLineNumber);
+    void printForReadCommand(const QScriptValue &message, bool last = true);
+    void printOut(const QScriptValue &message, bool last = true);
+    void printErr(const QScriptValue &error, bool last = true);
+    void printUncaughtException(const QScriptValue &exception);
+    void helpCommand();
+
+private:
+    QString m_script;
+    bool m_hasError;
+    QTextStream *m_out;
+    QTextStream *m_err;
+};
+
+#endif // STARTUPSHELL_H
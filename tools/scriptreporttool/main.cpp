@@ -23,6 +23,13 @@
 
 int main(int argc, char *argv[])
 {
+    if (ScriptReportTool::isPdfOutput(argc, argv)) {
+        // The PDF output doesn't show any window, it can run without a display. QApplication
+        // is still used because reports can create widgets
+        if (qgetenv("QT_QPA_PLATFORM").isEmpty()) {
+            qputenv("QT_QPA_PLATFORM", "offscreen");
+        }
+    }
     QApplication a(argc, argv);
     ScriptReportTool *s = new ScriptReportTool(&a);
     int returnCode;
@@ -23,9 +23,18 @@
 #include <QtCore/QFile>
 #include <QtCore/QFileInfo>
 #include <QtCore/QDir>
+#include <QtCore/QElapsedTimer>
+#include <QtCore/QJsonArray>
+#include <QtCore/QJsonDocument>
+#include <QtCore/QJsonObject>
+#include <QtCore/QFuture>
+#include <QtCore/QQueue>
+#include <QtCore/QThread>
 #include <QtCore/QTimer>
 #include <QtCore/QTextStream>
 
+#include <QtGui/QPdfWriter>
+
 #include <QPrinter>
 #include <QPrintDialog>
 #include <QPrintPreviewDialog>
@@ -33,11 +42,19 @@
 #include <QtScript/QScriptEngine>
 
 #include <ScriptReport/ScriptReport>
+#include <ScriptReport/ScriptReportCache>
+#include <ScriptReport/ScriptReportJobRunner>
+#include <ScriptReport/ScriptReportProfiler>
+#include <ScriptReport/ScriptReportTracer>
 #include <ScriptReport/TextStreamObject>
 
 ScriptReportTool::ScriptReportTool(QObject *parent) :
     QObject(parent),
+    m_jobs(0),
+    m_stats(false),
     m_preview(false),
+    m_pdf(false),
+    m_pipeline(false),
     m_inFile(0),
     m_outFile(0),
     m_in(0),
@@ -69,6 +86,8 @@ void ScriptReportTool::printHelp() {
             "    %2 -c FILE -\n"
             "    %2 -c - OUTPUT\n"
             "    %2 -c - -\n"
+            "    %2 -o PDF [options] FILE [arguments]\n"
+            "    %2 -b MANIFEST [-j JOBS] [-x EXTENSION ...] [options]\n"
             "\n"
             "Description:\n"
             "    %2 run a script report, the script is read from the standar\n"
@@ -78,22 +97,60 @@ void ScriptReportTool::printHelp() {
             "    OUTPUT is missing the output file name is generated, if OUTPUT is - the\n"
             "    generated javascript write in the standard output.\n"
             "\n"
+            "    With the -b option the reports listed in the MANIFEST file are written to\n"
+            "    PDF files by JOBS parallel jobs that reuse their script engines. Each line\n"
+            "    of the MANIFEST is a JSON object like\n"
+            "        {\"report\": \"FILE\", \"arguments\": [...], \"output\": \"PDF\"}\n"
+            "    the relative paths are relative to the MANIFEST directory. For each line a\n"
+            "    JSON object with the status and the time in milliseconds of the job is\n"
+            "    written in the standard output. The EXTENSIONS are imported once in each\n"
+            "    engine, so the reports that import them reuse the engine. The reports are\n"
+            "    run out of the application thread, they cannot render widgets and their\n"
+            "    images are loaded as QImage instead of QPixmap.\n"
+            "\n"
             "Options:\n"
+            "    -b MANIFEST, -batch MANIFEST, --batch MANIFEST\n"
+            "               write to PDF files the reports listed in the MANIFEST file.\n"
             "    -c , -compile , --compile\n"
             "               compile the script report to javascript.\n"
             "    -e , -editing , --editing\n"
             "               enable the editing mode.\n"
             "    -d , -debugging , --debugging\n"
             "               enable the debugging mode.\n"
+            "    -g FILE, -trace FILE, --trace FILE\n"
+            "               write to FILE the timeline of the transformation, the script,\n"
+            "               the queries, the layout and the paint of each page, in the\n"
+            "               Chrome trace event format, it can be opened with\n"
+            "               chrome://tracing or Perfetto.\n"
+            "    -f FILE, -profile FILE, --profile FILE\n"
+            "               measure the time of the functions of the script report and\n"
+            "               write it to FILE in the collapsed stacks format of the flame\n"
+            "               graph tools.\n"
             "    -h , -help , --help\n"
             "               display this help with the basic usage.\n"
+            "    -j JOBS, -jobs JOBS, --jobs JOBS\n"
+            "               the number of parallel jobs of the batch mode, by default one\n"
+            "               for each processor core.\n"
+            "    -l , -pipeline , --pipeline\n"
+            "               write the pages of the PDF while the script report is run.\n"
+            "    -o PDF, -pdf PDF, --pdf PDF\n"
+            "               write the report to the PDF file instead of print it. The\n"
+            "               print dialog and the widgets are not used, if the environment\n"
+            "               variable QT_QPA_PLATFORM is not set the offscreen platform is\n"
+            "               used, so a display is not required.\n"
             "    -p , -preview , --preview\n"
             "               show the print preview.\n"
             "    -r , -print-error , --print-error\n"
             "               print the error if it was happened. If an error happened with\n"
             "               this option print the error in an extra page.\n"
             "    -s SCRIPT, -previous-script SCRIPT, --previous-script SCRIPT\n"
-            "               run the SCRIPT previously of run the script report.\n")
+            "               run the SCRIPT previously of run the script report.\n"
+            "    -t , -stats , --stats\n"
+            "               write the timings and sizes of the phases of the report as\n"
+            "               JSON in the standard error, in the batch mode they are added\n"
+            "               to the status of each job.\n"
+            "    -x EXTENSION, -extension EXTENSION, --extension EXTENSION\n"
+            "               import the EXTENSION in the engines of the batch mode.\n")
         .arg(QString::fromLatin1(APP_VERSION))
         .arg(QString::fromLatin1(APP_NAME));
 
@@ -136,6 +193,78 @@ bool ScriptReportTool::init(int &retunrCode) {
                     || arg == QLatin1String("--preview")
                     || arg == QLatin1String("-p")) {
                 m_preview = true;
+            } else if (arg == QLatin1String("-pdf")
+                    || arg == QLatin1String("--pdf")
+                    || arg == QLatin1String("-o")) {
+                i++;
+                if (i >= arguments.length()) {
+                    *m_err << QString::fromLatin1("Missing the PDF file name.\n");
+                    retunrCode = 1;
+                    return true;
+                }
+                m_pdf = true;
+                m_pdfFileName = arguments[i];
+            } else if (arg == QLatin1String("-pipeline")
+                    || arg == QLatin1String("--pipeline")
+                    || arg == QLatin1String("-l")) {
+                m_pipeline = true;
+            } else if (arg == QLatin1String("-batch")
+                    || arg == QLatin1String("--batch")
+                    || arg == QLatin1String("-b")) {
+                i++;
+                if (i >= arguments.length()) {
+                    *m_err << QString::fromLatin1("Missing the manifest file name.\n");
+                    retunrCode = 1;
+                    return true;
+                }
+                m_batchFileName = arguments[i];
+            } else if (arg == QLatin1String("-jobs")
+                    || arg == QLatin1String("--jobs")
+                    || arg == QLatin1String("-j")) {
+                i++;
+                bool ok = false;
+                if (i < arguments.length()) {
+                    m_jobs = arguments[i].toInt(&ok);
+                }
+                if (!ok || m_jobs < 1) {
+                    *m_err << QString::fromLatin1("The number of jobs must be a positive number.\n");
+                    retunrCode = 1;
+                    return true;
+                }
+            } else if (arg == QLatin1String("-extension")
+                    || arg == QLatin1String("--extension")
+                    || arg == QLatin1String("-x")) {
+                i++;
+                if (i >= arguments.length()) {
+                    *m_err << QString::fromLatin1("Missing the extension name.\n");
+                    retunrCode = 1;
+                    return true;
+                }
+                m_extensions.append(arguments[i]);
+            } else if (arg == QLatin1String("-profile")
+                    || arg == QLatin1String("--profile")
+                    || arg == QLatin1String("-f")) {
+                i++;
+                if (i >= arguments.length()) {
+                    *m_err << QString::fromLatin1("Missing the profile file name.\n");
+                    retunrCode = 1;
+                    return true;
+                }
+                m_profileFileName = arguments[i];
+            } else if (arg == QLatin1String("-trace")
+                    || arg == QLatin1String("--trace")
+                    || arg == QLatin1String("-g")) {
+                i++;
+                if (i >= arguments.length()) {
+                    *m_err << QString::fromLatin1("Missing the trace file name.\n");
+                    retunrCode = 1;
+                    return true;
+                }
+                m_traceFileName = arguments[i];
+            } else if (arg == QLatin1String("-stats")
+                    || arg == QLatin1String("--stats")
+                    || arg == QLatin1String("-t")) {
+                m_stats = true;
             } else if (arg == QLatin1String("-print-error")
                     || arg == QLatin1String("--print-error")
                     || arg == QLatin1String("-r")) {
@@ -161,6 +290,14 @@ bool ScriptReportTool::init(int &retunrCode) {
         }
     }
 
+    if (!m_traceFileName.isEmpty()) {
+        ScriptReportTracer::setEnabled(true);
+        connect(QCoreApplication::instance(), SIGNAL(aboutToQuit()), this, SLOT(writeTrace()));
+    }
+
+    // The reports being edited change on every run, caching them would only fill the directory
+    ScriptReportCache::setEnabled(!m_editing);
+
     if (compile && previousScript) {
         *m_err << QString::fromLatin1("The compile mode cannot has previous script.\n");
         retunrCode = 1;
@@ -173,6 +310,57 @@ bool ScriptReportTool::init(int &retunrCode) {
         return true;
     }
 
+    if (compile && m_pdf) {
+        *m_err << QString::fromLatin1("The compile mode cannot has PDF output.\n");
+        retunrCode = 1;
+        return true;
+    }
+
+    if (!m_batchFileName.isEmpty()) {
+        if (compile || m_preview || m_pdf || argumentScriptNamePosition > 0) {
+            *m_err << QString::fromLatin1("The batch mode cannot has compile mode, preview, PDF output or file name.\n");
+            retunrCode = 1;
+            return true;
+        }
+        if (m_editing || m_debugging || !m_profileFileName.isEmpty()) {
+            *m_err << QString::fromLatin1("The batch mode cannot has editing, debugging or profile setting.\n");
+            retunrCode = 1;
+            return true;
+        }
+        QTimer::singleShot(0, this, SLOT(runBatch()));
+        return false;
+    }
+
+    if (m_jobs > 0 || !m_extensions.isEmpty()) {
+        *m_err << QString::fromLatin1("The number of jobs and the extensions require the batch mode.\n");
+        retunrCode = 1;
+        return true;
+    }
+
+    if (m_pipeline && !m_pdf) {
+        *m_err << QString::fromLatin1("The pipeline mode requires the PDF output.\n");
+        retunrCode = 1;
+        return true;
+    }
+
+    if (m_pdf && m_preview) {
+        *m_err << QString::fromLatin1("The PDF output cannot has preview.\n");
+        retunrCode = 1;
+        return true;
+    }
+
+    if (compile && !m_profileFileName.isEmpty()) {
+        *m_err << QString::fromLatin1("The compile mode cannot has profile.\n");
+        retunrCode = 1;
+        return true;
+    }
+
+    if (compile && m_stats) {
+        *m_err << QString::fromLatin1("The compile mode cannot has stats.\n");
+        retunrCode = 1;
+        return true;
+    }
+
     if (compile && m_printError) {
         *m_err << QString::fromLatin1("The compile mode cannot has print error setting.\n");
         retunrCode = 1;
@@ -246,6 +434,8 @@ bool ScriptReportTool::init(int &retunrCode) {
 
     if (compile) {
         QTimer::singleShot(0, this, SLOT(compile()));
+    } else if (m_pdf) {
+        QTimer::singleShot(0, this, SLOT(runPdf()));
     } else if (m_preview) {
          QTimer::singleShot(0, this, SLOT(runPreview()));
     } else {
@@ -264,6 +454,7 @@ void ScriptReportTool::run() {
         sr.setPreviousScript(m_previousScript);
         sr.setEditing(m_editing);
         sr.setDebugging(m_debugging);
+        sr.setProfilingEnabled(!m_profileFileName.isEmpty());
         sr.printOutput()->setStream(m_out);
         sr.run();
         bool hasUncaughtException = sr.hasUncaughtException();
@@ -274,6 +465,8 @@ void ScriptReportTool::run() {
                 m_err->flush();
             }
             sr.print(&printer);
+            printStats(sr);
+            writeProfile(sr);
             if (hasUncaughtException) {
                 QCoreApplication::exit(6);
             }
@@ -287,12 +480,109 @@ void ScriptReportTool::run() {
     QCoreApplication::exit(0);
 }
 
+void ScriptReportTool::runPdf() {
+    QFile pdfFile(m_pdfFileName);
+    if (!pdfFile.open(QIODevice::WriteOnly)) {
+        *m_err << QString::fromLatin1("Unable to open the output file '%1'.\n").arg(m_pdfFileName);
+        m_err->flush();
+        QCoreApplication::exit(3);
+        return;
+    }
+
+    ScriptReport sr(m_in, m_fileName);
+    sr.setArguments(m_scriptArguments);
+    sr.setPreviousScript(m_previousScript);
+    sr.setEditing(m_editing);
+    sr.setDebugging(m_debugging);
+    sr.setProfilingEnabled(!m_profileFileName.isEmpty());
+    sr.printOutput()->setStream(m_out);
+
+    if (m_pipeline) {
+        // The report is run while the pages are written
+        sr.setPipelineEnabled(true);
+        sr.setPrintErrorEnabled(m_printError);
+        QPdfWriter writer(&pdfFile);
+        sr.render(&writer);
+        printStats(sr);
+        writeProfile(sr);
+        m_out->flush();
+        if (sr.hasUncaughtException()) {
+            *m_err << QString::fromLatin1("Error: %1\n").arg(sr.errorMessage());
+            m_err->flush();
+            QCoreApplication::exit(6);
+            return;
+        }
+        QCoreApplication::exit(0);
+        return;
+    }
+
+    sr.run();
+    bool hasUncaughtException = sr.hasUncaughtException();
+    if (!hasUncaughtException || m_printError) {
+        m_out->flush();
+        if (hasUncaughtException) {
+            *m_err << QString::fromLatin1("Error: %1\n").arg(sr.errorMessage());
+            m_err->flush();
+        }
+        QPdfWriter writer(&pdfFile);
+        sr.render(&writer);
+        printStats(sr);
+        writeProfile(sr);
+        if (hasUncaughtException) {
+            QCoreApplication::exit(6);
+            return;
+        }
+    } else {
+        *m_err << QString::fromLatin1("Error: %1\n").arg(sr.errorMessage());
+        m_out->flush();
+        m_err->flush();
+        QCoreApplication::exit(6);
+        return;
+    }
+    QCoreApplication::exit(0);
+}
+
+bool ScriptReportTool::isPdfOutput(int argc, char *argv[]) {
+    for (int i = 1; i < argc; i++) {
+        QString arg = QString::fromLocal8Bit(argv[i]);
+        if (arg == QLatin1String("-pdf")
+                || arg == QLatin1String("--pdf")
+                || arg == QLatin1String("-o")
+                || arg == QLatin1String("-batch")
+                || arg == QLatin1String("--batch")
+                || arg == QLatin1String("-b")) {
+            return true;
+        } else if (arg == QLatin1String("-previous-script")
+                || arg == QLatin1String("--previous-script")
+                || arg == QLatin1String("-s")
+                || arg == QLatin1String("-jobs")
+                || arg == QLatin1String("--jobs")
+                || arg == QLatin1String("-j")
+                || arg == QLatin1String("-extension")
+                || arg == QLatin1String("--extension")
+                || arg == QLatin1String("-x")
+                || arg == QLatin1String("-profile")
+                || arg == QLatin1String("--profile")
+                || arg == QLatin1String("-f")
+                || arg == QLatin1String("-trace")
+                || arg == QLatin1String("--trace")
+                || arg == QLatin1String("-g")) {
+            i++;
+        } else if (!arg.startsWith(QChar::fromLatin1('-')) || arg == QLatin1String("-")) {
+            // The script name, the remaining arguments are for the script
+            return false;
+        }
+    }
+    return false;
+}
+
 void ScriptReportTool::runPreview() {
     ScriptReport *sr = new ScriptReport(m_in, m_fileName);
     sr->setArguments(m_scriptArguments);
     sr->setPreviousScript(m_previousScript);
     sr->setEditing(m_editing);
     sr->setDebugging(m_debugging);
+    sr->setProfilingEnabled(!m_profileFileName.isEmpty());
     sr->printOutput()->setStream(m_out);
     sr->run();
     bool hasUncaughtException = sr->hasUncaughtException();
@@ -305,6 +595,8 @@ void ScriptReportTool::runPreview() {
         QPrintPreviewDialog *p = new QPrintPreviewDialog();
         connect(p, SIGNAL(paintRequested(QPrinter*)), sr, SLOT(print(QPrinter*)));
         p->exec();
+        printStats(*sr);
+        writeProfile(*sr);
         delete p;
         p = 0;
         delete sr;
@@ -321,6 +613,140 @@ void ScriptReportTool::runPreview() {
     QCoreApplication::exit(0);
 }
 
+void ScriptReportTool::printStats(const ScriptReport &sr) {
+    if (!m_stats) {
+        return;
+    }
+    *m_err << QString::fromUtf8(QJsonDocument(sr.stats().toJson()).toJson(QJsonDocument::Compact)) << '\n';
+    m_err->flush();
+}
+
+void ScriptReportTool::writeProfile(const ScriptReport &sr) {
+    if (!sr.profiler()) {
+        return;
+    }
+    if (!sr.profiler()->writeCollapsedStacks(m_profileFileName)) {
+        *m_err << QString::fromLatin1("Unable to write the profile file '%1'.\n").arg(m_profileFileName);
+        m_err->flush();
+    }
+}
+
+void ScriptReportTool::writeTrace() {
+    if (!ScriptReportTracer::writeTrace(m_traceFileName)) {
+        *m_err << QString::fromLatin1("Unable to write the trace file '%1'.\n").arg(m_traceFileName);
+        m_err->flush();
+    }
+}
+
+// A line of the manifest waiting to be reported, an invalid line has the error and no result
+struct PendingBatchLine {
+    int lineNumber;
+    QString error;
+    QFuture<ScriptReportJobResult> result;
+};
+
+void ScriptReportTool::runBatch() {
+    QFile manifestFile(m_batchFileName);
+    if (!manifestFile.open(QIODevice::ReadOnly)) {
+        *m_err << QString::fromLatin1("Unable to read the file '%1'.\n").arg(m_batchFileName);
+        m_err->flush();
+        QCoreApplication::exit(2);
+        return;
+    }
+    QFileInfo fileInfo(m_batchFileName);
+    QDir::setCurrent(fileInfo.absolutePath());
+
+    QElapsedTimer timer;
+    timer.start();
+
+    int jobs = m_jobs > 0 ? m_jobs : QThread::idealThreadCount();
+    ScriptReportJobRunner runner(jobs, m_extensions);
+
+    // The jobs are reported in the manifest order, only a few of them are queued ahead so a big
+    // manifest is not loaded at once. The invalid lines are queued too, so they are reported in order.
+    QQueue<PendingBatchLine> pending;
+    int maximumPending = qMax(jobs, 1) * 4;
+    int lineNumber = 0;
+    int jobCount = 0;
+    int errorCount = 0;
+
+    while (!manifestFile.atEnd() || !pending.isEmpty()) {
+        if (!manifestFile.atEnd() && pending.size() < maximumPending) {
+            QByteArray line = manifestFile.readLine().trimmed();
+            lineNumber++;
+            if (line.isEmpty()) {
+                continue;
+            }
+            jobCount++;
+
+            QJsonParseError parseError;
+            QJsonObject object = QJsonDocument::fromJson(line, &parseError).object();
+            ScriptReportJob job;
+            job.reportName = object.value(QLatin1String("report")).toString();
+            foreach (const QJsonValue &argument, object.value(QLatin1String("arguments")).toArray()) {
+                job.arguments.append(argument.toString());
+            }
+            job.outputFileName = object.value(QLatin1String("output")).toString();
+            job.previousScript = object.value(QLatin1String("previousScript")).toString(m_previousScript);
+            job.isPrintErrorEnabled = m_printError;
+            job.isPipelineEnabled = m_pipeline;
+
+            PendingBatchLine pendingLine;
+            pendingLine.lineNumber = lineNumber;
+            QString &error = pendingLine.error;
+            if (parseError.error != QJsonParseError::NoError) {
+                error = QString::fromLatin1("Invalid JSON: %1").arg(parseError.errorString());
+            } else if (job.reportName.isEmpty()) {
+                error = QString::fromLatin1("Missing the report file name.");
+            } else if (job.outputFileName.isEmpty()) {
+                error = QString::fromLatin1("Missing the PDF file name.");
+            }
+            if (error.isEmpty()) {
+                pendingLine.result = runner.submit(job);
+            }
+            pending.enqueue(pendingLine);
+            continue;
+        }
+
+        PendingBatchLine next = pending.dequeue();
+        if (!next.error.isEmpty()) {
+            QJsonObject status;
+            status.insert(QLatin1String("line"), next.lineNumber);
+            status.insert(QLatin1String("status"), QLatin1String("invalid"));
+            status.insert(QLatin1String("error"), next.error);
+            *m_out << QString::fromUtf8(QJsonDocument(status).toJson(QJsonDocument::Compact)) << '\n';
+            m_out->flush();
+            errorCount++;
+            continue;
+        }
+
+        ScriptReportJobResult result = next.result.result();
+        QJsonObject status;
+        status.insert(QLatin1String("line"), next.lineNumber);
+        status.insert(QLatin1String("report"), result.reportName);
+        status.insert(QLatin1String("output"), result.outputFileName);
+        status.insert(QLatin1String("status"), result.hasError ? QLatin1String("error") : QLatin1String("ok"));
+        if (result.hasError) {
+            status.insert(QLatin1String("error"), result.errorMessage);
+            errorCount++;
+        }
+        if (!result.printOutput.isEmpty()) {
+            status.insert(QLatin1String("print"), result.printOutput);
+        }
+        status.insert(QLatin1String("elapsed"), double(result.elapsedTime));
+        if (m_stats) {
+            status.insert(QLatin1String("stats"), result.stats.toJson());
+        }
+        *m_out << QString::fromUtf8(QJsonDocument(status).toJson(QJsonDocument::Compact)) << '\n';
+        m_out->flush();
+    }
+
+    *m_err << QString::fromLatin1("%1 jobs, %2 errors, %3 ms\n")
+              .arg(jobCount).arg(errorCount).arg(timer.elapsed());
+    m_err->flush();
+    QCoreApplication::exit(errorCount > 0 ? 6 : 0);
+}
+
 void ScriptReportTool::compile() {
     ScriptReport sr(m_in, m_fileName);
     sr.updateIntermediateCode();
@@ -40,17 +40,35 @@ public:
     bool init(int &retunrCode);
     void printHelp();
 
+    static bool isPdfOutput(int argc, char *argv[]);
+
 public slots:
     void run();
+    void runPdf();
     void runPreview();
+    void runBatch();
     void compile();
+    void writeTrace();
+
+private:
+    void printStats(const ScriptReport &sr);
+    void writeProfile(const ScriptReport &sr);
 
 private:
     QString m_fileName;
     QString m_previousScript;
     QStringList m_scriptArguments;
     QString m_compiledFileNane;
+    QString m_pdfFileName;
+    QString m_profileFileName;
+    QString m_traceFileName;
+    QString m_batchFileName;
+    QStringList m_extensions;
+    int m_jobs;
+    bool m_stats;
     bool m_preview;
+    bool m_pdf;
+    bool m_pipeline;
 
     QFile *m_inFile;
     QFile *m_outFile;
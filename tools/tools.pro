@@ -21,8 +21,10 @@ TEMPLATE = subdirs
 
 SUBDIRS = sub_srsh \
           sub_srshqg \
-          sub_scriptreporttool
+          sub_scriptreporttool \
+          sub_scriptreportd
 
 sub_srsh.subdir = srsh
 sub_srshqg.subdir = srshqg
 sub_scriptreporttool.subdir = scriptreporttool
+sub_scriptreportd.subdir = scriptreportd